@@ -0,0 +1,323 @@
+#include "bigram.h"
+
+/**
+ * @brief Gives the size of a varint.
+ *
+ * @param value The value.
+ * @return unsigned int The bytes of its varint.
+ */
+static unsigned int varint_size(u32_t value)
+{
+	unsigned int size = 1;
+	for (; value >= 0x80; value >>= 7)
+		size++;
+
+	return size;
+}
+
+/**
+ * @brief Writes a varint: 7 bits of the value in every byte, the lowest ones
+ * first, with the highest bit set in all the bytes but the last.
+ *
+ * @param out Where to write it.
+ * @param value The value.
+ * @return u8_t* The byte after the varint.
+ */
+static u8_t *put_varint(u8_t *out, u32_t value)
+{
+	for (; value >= 0x80; value >>= 7)
+		*out++ = (value & 0x7f) | 0x80;
+
+	*out++ = value;
+	return out;
+}
+
+/**
+ * @brief Reads a varint.
+ *
+ * @param in Where to read it, moved after the varint.
+ * @return u32_t The value.
+ */
+static u32_t get_varint(u8_t **in)
+{
+	u8_t *byte = *in;
+	u32_t value = 0;
+
+	for (unsigned int shift = 0;; shift += 7) {
+		value |= (u32_t)(*byte & 0x7f) << shift;
+		if (!(*byte++ & 0x80))
+			break;
+	}
+
+	*in = byte;
+	return value;
+}
+
+/**
+ * @brief Compares 2 numbers, for qsort.
+ *
+ * @param a The first number.
+ * @param b The second number.
+ * @return int The order, the smallest first.
+ */
+static int compare_numbers(const void *a, const void *b)
+{
+	u64_t x = *(const u64_t *)a, y = *(const u64_t *)b;
+
+	return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/**
+ * @brief Compares 2 successors, for qsort.
+ *
+ * @param a The first successor.
+ * @param b The second successor.
+ * @return int The order, the best first.
+ */
+static int compare_candidates(const void *a, const void *b)
+{
+	const b_candidate_t *x = (const b_candidate_t *)a;
+	const b_candidate_t *y = (const b_candidate_t *)b;
+
+	if (x->count != y->count)
+		return x->count < y->count ? 1 : -1;
+
+	if (x->freq != y->freq)
+		return x->freq < y->freq ? 1 : -1;
+
+	return strcmp(x->word, y->word);
+}
+
+/**
+ * @brief Encodes the successors of all the ids into a model.
+ *
+ * @param words_no The number of ids.
+ * @param firsts Where the successors of every id start in entries, and where
+ * the ones of the last id end.
+ * @param entries The successors, grouped by id and sorted within every
+ * group, as their id shifted by 8 bits, or their quantised count.
+ * @return b_model_t* The model, or NULL if there is no memory left.
+ */
+static b_model_t *encode_model(u32_t words_no, u64_t *firsts, u64_t *entries)
+{
+	u64_t size = 0;
+	for (u32_t prev = 0; prev < words_no; prev++) {
+		u32_t last = 0;
+		for (u64_t i = firsts[prev]; i < firsts[prev + 1]; i++) {
+			u32_t next = entries[i] >> 8;
+			size += varint_size(next - last) + 1;
+			last = next;
+		}
+	}
+
+	if (size > 0xffffffffUL)
+		return NULL;
+
+	b_model_t *model = (b_model_t *)calloc(1, sizeof(b_model_t));
+	if (!model)
+		return NULL;
+
+	model->starts = (u32_t *)malloc((words_no + 1UL) * sizeof(u32_t));
+	model->lists = (u8_t *)malloc(size + 1);
+	if (!model->starts || !model->lists) {
+		free_bigrams(model);
+		return NULL;
+	}
+
+	u8_t *out = model->lists;
+	for (u32_t prev = 0; prev < words_no; prev++) {
+		model->starts[prev] = out - model->lists;
+
+		u32_t last = 0;
+		for (u64_t i = firsts[prev]; i < firsts[prev + 1]; i++) {
+			u32_t next = entries[i] >> 8;
+			out = put_varint(out, next - last);
+			*out++ = entries[i] & 0xff;
+			last = next;
+		}
+	}
+
+	model->starts[words_no] = out - model->lists;
+	model->words_no = words_no;
+	model->pairs_no = firsts[words_no];
+	model->bytes = sizeof(b_model_t) + (words_no + 1UL) * sizeof(u32_t) +
+				   size;
+
+	return model;
+}
+
+b_model_t *build_bigrams(u64_t *pairs, u64_t pairs_no, u32_t words_no)
+{
+	u64_t *firsts = (u64_t *)calloc(words_no + 1UL, sizeof(u64_t));
+	if (!firsts)
+		return NULL;
+
+	qsort(pairs, pairs_no, sizeof(u64_t), compare_numbers);
+
+	/**
+	 * The repeated pairs are next to each other now, so every run becomes
+	 * one entry, written over the pairs already read
+	 */
+	u64_t entries_no = 0;
+	for (u64_t i = 0, j; i < pairs_no; i = j) {
+		for (j = i + 1; j < pairs_no && pairs[j] == pairs[i]; j++)
+			;
+
+		firsts[(pairs[i] >> 32) + 1]++;
+		pairs[entries_no++] = (pairs[i] & 0xffffffffUL) << 8 |
+							  b_quantise(j - i);
+	}
+
+	for (u32_t prev = 0; prev < words_no; prev++)
+		firsts[prev + 1] += firsts[prev];
+
+	b_model_t *model = encode_model(words_no, firsts, pairs);
+	free(firsts);
+	return model;
+}
+
+b_model_t *remap_bigrams(b_model_t *model, w_index_t *old, w_index_t *ids)
+{
+	u32_t *map = (u32_t *)malloc((model->words_no + 1UL) * sizeof(u32_t));
+	u64_t *firsts = (u64_t *)calloc(ids->words_no + 1UL, sizeof(u64_t));
+	u64_t *entries = (u64_t *)malloc((model->pairs_no + 1) * sizeof(u64_t));
+	b_model_t *moved = NULL;
+
+	if (!map || !firsts || !entries)
+		goto out;
+
+	for (u32_t id = 0; id < model->words_no; id++)
+		map[id] = w_find(ids, old->words + old->offsets[id]);
+
+	/**
+	 * The new ids are in another order, so the entries are grouped again by
+	 * their first word, with a counting sort: one pass counts the groups,
+	 * the other one fills them
+	 */
+	for (unsigned int pass = 0; pass < 2; pass++) {
+		for (u32_t prev = 0; prev < model->words_no; prev++) {
+			if (map[prev] == W_NO_ID)
+				continue;
+
+			u8_t *in = model->lists + model->starts[prev];
+			u8_t *end = model->lists + model->starts[prev + 1];
+			for (u32_t next = 0; in < end;) {
+				next += get_varint(&in);
+				u8_t count = *in++;
+				if (map[next] == W_NO_ID)
+					continue;
+
+				if (pass == 0)
+					firsts[map[prev] + 1]++;
+				else
+					entries[firsts[map[prev]]++] = (u64_t)map[next] << 8 |
+												   count;
+			}
+		}
+
+		if (pass == 0) {
+			for (u32_t prev = 0; prev < ids->words_no; prev++)
+				firsts[prev + 1] += firsts[prev];
+		} else {
+			for (u32_t prev = ids->words_no; prev > 0; prev--)
+				firsts[prev] = firsts[prev - 1];
+			firsts[0] = 0;
+		}
+	}
+
+	for (u32_t prev = 0; prev < ids->words_no; prev++)
+		qsort(entries + firsts[prev], firsts[prev + 1] - firsts[prev],
+			  sizeof(u64_t), compare_numbers);
+
+	moved = encode_model(ids->words_no, firsts, entries);
+
+out:
+	free(map);
+	free(firsts);
+	free(entries);
+	return moved;
+}
+
+void free_bigrams(b_model_t *model)
+{
+	if (!model)
+		return;
+
+	free(model->starts);
+	free(model->lists);
+	free(model);
+}
+
+u8_t b_quantise(u64_t count)
+{
+	if (count < 4)
+		return count;
+
+	unsigned int high = 2;
+	while (count >> (high + 1))
+		high++;
+
+	return high << 2 | (count >> (high - 2) & 3);
+}
+
+u64_t b_count(u8_t count)
+{
+	unsigned int high = count >> 2;
+	if (high < 2)
+		return count;
+
+	return (u64_t)(4 | (count & 3)) << (high - 2);
+}
+
+int b_predict(b_model_t *model, w_index_t *ids, u32_t prev, char *prefix,
+			  b_candidate_t **found, u32_t *found_no)
+{
+	*found = NULL;
+	*found_no = 0;
+
+	u8_t *in = model->lists + model->starts[prev];
+	u8_t *end = model->lists + model->starts[prev + 1];
+	if (in == end)
+		return 0;
+
+	/**
+	 * Every successor takes at least 2 bytes, its gap and its count
+	 */
+	b_candidate_t *candidates =
+		(b_candidate_t *)malloc((end - in) / 2 * sizeof(b_candidate_t));
+	if (!candidates)
+		return -1;
+
+	size_t len = strlen(prefix);
+	u32_t count = 0;
+	for (u32_t next = 0; in < end;) {
+		next += get_varint(&in);
+		u8_t quantised = *in++;
+
+		/**
+		 * A word without a live key has no uses, so its node isn't read
+		 */
+		if (ids->freqs[next] == 0)
+			continue;
+
+		char *word = ids->words + ids->offsets[next];
+		if (ids->lens[next] < len || memcmp(word, prefix, len) != 0)
+			continue;
+
+		candidates[count].id = next;
+		candidates[count].count = quantised;
+		candidates[count].freq = ids->freqs[next];
+		candidates[count].word = word;
+		count++;
+	}
+
+	if (count == 0) {
+		free(candidates);
+		return 0;
+	}
+
+	qsort(candidates, count, sizeof(b_candidate_t), compare_candidates);
+	*found = candidates;
+	*found_no = count;
+	return 0;
+}
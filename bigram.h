@@ -0,0 +1,86 @@
+#ifndef BIGRAM_H_
+#define BIGRAM_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "structs.h"
+#include "utils.h"
+#include "word_ids.h"
+
+/**
+ * The bigram model counts which words follow which, over the ids of the
+ * frozen vocabulary. The successors of every id are kept sorted, as the
+ * gaps between their ids, in varints of 7 bits, so a common pair takes 2 or
+ * 3 bytes, and every one has its count quantised to a byte: the place of
+ * its highest bit and the 2 bits after it, so the order of the counts is
+ * kept, within 25%. A prediction reads the successors of the previous word,
+ * keeps the ones that start with the prefix and ranks them by their count.
+ */
+
+/**
+ * @brief Builds a bigram model from the pairs of consecutive words of a
+ * text.
+ *
+ * @param pairs The pairs, as the id of the first word shifted by 32 bits,
+ * or the id of the second one. They are overwritten.
+ * @param pairs_no The number of pairs, with the repeated ones.
+ * @param words_no The number of ids of the frozen vocabulary.
+ * @return b_model_t* The model, or NULL if there is no memory left.
+ */
+b_model_t *build_bigrams(u64_t *pairs, u64_t pairs_no, u32_t words_no);
+
+/**
+ * @brief Moves a bigram model to the ids of a new freeze of the vocabulary.
+ * The pairs with a word that isn't frozen anymore are dropped.
+ *
+ * @param model The model, with the old ids. It is left as it was.
+ * @param old The old ids.
+ * @param ids The new ids.
+ * @return b_model_t* The new model, or NULL if there is no memory left.
+ */
+b_model_t *remap_bigrams(b_model_t *model, w_index_t *old, w_index_t *ids);
+
+/**
+ * @brief Frees a bigram model.
+ *
+ * @param model The model, it can be NULL.
+ */
+void free_bigrams(b_model_t *model);
+
+/**
+ * @brief Quantises the count of a pair to a byte.
+ *
+ * @param count The count, at least 1.
+ * @return u8_t The quantised count.
+ */
+u8_t b_quantise(u64_t count);
+
+/**
+ * @brief Gives back the count of a pair, from its quantised count. It is
+ * the smallest count with the same quantised count.
+ *
+ * @param count The quantised count.
+ * @return u64_t The count.
+ */
+u64_t b_count(u8_t count);
+
+/**
+ * @brief Finds the words that follow a word and start with a prefix, the
+ * most frequent pairs first, then the most used words, then in
+ * lexicographic order. The words without a live key are skipped.
+ *
+ * @param model The model.
+ * @param ids The ids the model was built for.
+ * @param prev The id of the previous word.
+ * @param prefix The prefix, "" for all the successors.
+ * @param found Where to store the words found, to be freed by the caller.
+ * @param found_no Where to store their number.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+int b_predict(b_model_t *model, w_index_t *ids, u32_t prev, char *prefix,
+			  b_candidate_t **found, u32_t *found_no);
+
+#endif  // BIGRAM_H_
@@ -0,0 +1,633 @@
+#include "commands.h"
+
+unsigned int parse_input(char *string)
+{
+	if (strncmp(string, "INSERT", 6) == 0)
+		return 1;
+
+	if (strncmp(string, "LOAD_ASYNC", 10) == 0)
+		return 25;
+
+	if (strncmp(string, "LOAD_STATUS", 11) == 0)
+		return 26;
+
+	if (strncmp(string, "LOAD", 4) == 0)
+		return 2;
+
+	if (strncmp(string, "REMOVE_BATCH", 12) == 0)
+		return 7;
+
+	if (strncmp(string, "REMOVE", 6) == 0)
+		return 3;
+
+	if (strncmp(string, "AUTOCORRECT", 11) == 0)
+		return 4;
+
+	if (strncmp(string, "AUTOCOMPLETE_FUZZY", 18) == 0)
+		return 10;
+
+	if (strncmp(string, "AUTOCOMPLETE", 12) == 0)
+		return 5;
+
+	if (strncmp(string, "EXIT", 4) == 0)
+		return EXIT_ID;
+
+	if (strncmp(string, "DECAY_EVERY", 11) == 0)
+		return 9;
+
+	if (strncmp(string, "DECAY", 5) == 0)
+		return 8;
+
+	if (strncmp(string, "CHECKPOINT", 10) == 0)
+		return 11;
+
+	if (strncmp(string, "SNAPSHOTS", 9) == 0)
+		return 12;
+
+	if (strncmp(string, "SWIPE", 5) == 0)
+		return 13;
+
+	if (strncmp(string, "MEMORY_LIMIT", 12) == 0)
+		return 14;
+
+	if (strncmp(string, "STATS", 5) == 0)
+		return 15;
+
+	if (strncmp(string, "TIERS", 5) == 0)
+		return 16;
+
+	if (strncmp(string, "USER", 4) == 0)
+		return 17;
+
+	if (strncmp(string, "MATCH", 5) == 0)
+		return 18;
+
+	if (strncmp(string, "INDEX", 5) == 0)
+		return 19;
+
+	if (strncmp(string, "SUFFIX", 6) == 0)
+		return 20;
+
+	if (strncmp(string, "INFIX", 5) == 0)
+		return 21;
+
+	if (strncmp(string, "FREEZE", 6) == 0)
+		return 22;
+
+	if (strncmp(string, "RANGE", 5) == 0)
+		return 23;
+
+	if (strncmp(string, "DUMP", 4) == 0)
+		return 24;
+
+	if (strncmp(string, "BIGRAMS", 7) == 0)
+		return 27;
+
+	if (strncmp(string, "PREDICT", 7) == 0)
+		return 28;
+
+	if (strncmp(string, "EXPLAIN", 7) == 0)
+		return 29;
+
+	return 0;
+}
+
+void report(mk_err_t err, FILE *stream)
+{
+	if (err != MK_OK && stream)
+		fprintf(stream, "%s\n", mk_strerror(err));
+}
+
+void print_words(mk_err_t err, char *words, unsigned int misses, FILE *out,
+				 FILE *stream)
+{
+	if (err == MK_ENOTFOUND) {
+		for (unsigned int i = 0; i < misses; i++)
+			fprintf(out, "No words found\n");
+		return;
+	}
+
+	if (err != MK_OK) {
+		report(err, stream);
+		return;
+	}
+
+	fprintf(out, "%s", words);
+}
+
+int read_number(FILE *in, unsigned long max, unsigned long *value)
+{
+	char token[MAX_STR];
+	if (fscanf(in, "%99s", token) != 1 || !isdigit((unsigned char)token[0]))
+		return -1;
+
+	/**
+	 * strtoul takes a sign, and it wraps "-1" to the biggest value, so the
+	 * token must start with a digit
+	 */
+	char *end;
+	errno = 0;
+	unsigned long number = strtoul(token, &end, 10);
+	if (*end != '\0' || errno == ERANGE || number > max)
+		return -1;
+
+	*value = number;
+	return 0;
+}
+
+int grow_result(char **result, size_t *result_len, size_t needed)
+{
+	char *bigger = (char *)realloc(*result, needed);
+	if (!bigger)
+		return -1;
+
+	*result = bigger;
+	*result_len = needed;
+	return 0;
+}
+
+void print_stats(mk_trie_t *trie, FILE *out)
+{
+	mk_stats_t stats;
+	mk_stats(trie, &stats);
+
+	fprintf(out, "keys: %lu\n", stats.keys);
+	fprintf(out, "nodes: %lu\n", stats.nodes);
+	if (stats.mem_limit)
+		fprintf(out, "memory: %lu / %lu bytes\n", stats.mem_used,
+				stats.mem_limit);
+	else
+		fprintf(out, "memory: %lu bytes, no limit\n", stats.mem_used);
+
+	if (stats.tiered)
+		fprintf(out, "tiers: %lu base nodes, %lu delta nodes, %lu merges\n",
+				stats.base_nodes, stats.delta_nodes, stats.merges);
+
+	if (stats.users)
+		fprintf(out, "users: %lu, %lu bytes\n", stats.users,
+				stats.users_bytes);
+
+	if (stats.indexed)
+		fprintf(out, "index: %lu nodes, %lu suffixes, %lu bytes\n",
+				stats.index_nodes, stats.index_posts, stats.index_bytes);
+
+	if (stats.frozen_words)
+		fprintf(out, "frozen: %lu words, %lu bytes\n", stats.frozen_words,
+				stats.frozen_bytes);
+
+	if (stats.bigrams)
+		fprintf(out, "bigrams: %lu pairs, %lu bytes\n", stats.bigrams,
+				stats.bigrams_bytes);
+
+	for (unsigned int i = 0; i < MK_STRATEGIES; i++) {
+		if (stats.plan_runs[i])
+			fprintf(out, "planner: %s, %lu searches, %lu nodes\n",
+					mk_strategy_name(i), stats.plan_runs[i],
+					stats.plan_visited[i]);
+	}
+
+	fprintf(out, "evicted: %lu\n", stats.evicted);
+	if (stats.recent_no == 0)
+		return;
+
+	fprintf(out, "recently evicted:");
+	for (unsigned int i = 0; i < stats.recent_no; i++)
+		fprintf(out, " %s", stats.recent[i]);
+	fprintf(out, "\n");
+}
+
+void print_load_status(mk_trie_t *trie, FILE *out)
+{
+	mk_load_status_t status;
+	mk_load_status(trie, &status);
+
+	if (!status.started) {
+		fprintf(out, "load: none\n");
+		return;
+	}
+
+	fprintf(out, "load: %s", status.running ? "running" :
+			(status.err == MK_OK ? "done" : mk_strerror(status.err)));
+	fprintf(out, ", %lu words", status.words);
+	if (status.size)
+		fprintf(out, ", %lu / %lu bytes (%.1f%%)", status.bytes, status.size,
+				100.0 * status.bytes / status.size);
+	else
+		fprintf(out, ", %lu bytes", status.bytes);
+
+	double seconds = status.seconds > 0 ? status.seconds : 1e-9;
+	fprintf(out, ", %.2f s, %.0f words/s, %.2f MiB/s\n", status.seconds,
+			status.words / seconds, status.bytes / seconds / (1024 * 1024));
+}
+
+void print_plan(mk_plan_t *plan, FILE *out)
+{
+	fprintf(out, "plan:");
+	for (unsigned int i = 0; i < plan->steps_no; i++) {
+		fprintf(out, "%s %s %lu nodes", i ? "," : "", plan->strategies[i],
+				plan->visited[i]);
+		if (plan->tasks[i])
+			fprintf(out, " on %u tasks", plan->tasks[i]);
+	}
+	fprintf(out, "%s\n", plan->steps_no ? "" : " none");
+}
+
+int print_match(const char *word, void *out)
+{
+	fprintf((FILE *)out, "%s\n", word);
+	return 0;
+}
+
+int print_key(const char *word, unsigned long freq, void *out)
+{
+	(void)freq;
+	fprintf((FILE *)out, "%s\n", word);
+	return 0;
+}
+
+int print_key_uses(const char *word, unsigned long freq, void *out)
+{
+	fprintf((FILE *)out, "%s %lu\n", word, freq);
+	return 0;
+}
+
+mk_err_t stream_range(mk_trie_t *trie, char *from, char *to,
+					  unsigned long limit,
+					  int (*found)(const char *word, unsigned long freq,
+								   void *arg),
+					  FILE *out)
+{
+	mk_cursor_t cursor;
+	unsigned long given = 0, count;
+
+	mk_err_t ret = mk_cursor_init(&cursor, from, to);
+	while (ret == MK_OK && (limit == 0 || given < limit)) {
+		unsigned long n = CURSOR_BATCH;
+		if (limit != 0 && limit - given < n)
+			n = limit - given;
+
+		ret = mk_cursor_fetch(trie, &cursor, n, found, out, &count);
+		given += count;
+	}
+
+	if (ret == MK_ENOTFOUND && given > 0)
+		ret = MK_OK;
+
+	return ret;
+}
+
+mk_err_t run_user_command(mk_trie_t *trie, FILE *in, FILE *out, FILE *err,
+						  char **result, size_t *result_len)
+{
+	char input[MAX_IN], string[MAX_STR];
+	unsigned long user, k;
+	size_t needed;
+	mk_err_t ret = MK_EINVAL;
+
+	if (read_number(in, ULONG_MAX, &user) < 0 ||
+		fscanf(in, "%19s", input) != 1) {
+		report(ret, err);
+		return ret;
+	}
+
+	if (strcmp(input, "DROP") == 0) {
+		mk_user_drop(trie, user);
+		return MK_OK;
+	}
+
+	switch (parse_input(input)) {
+	case 1:
+		if (fscanf(in, "%99s", string) == 1)
+			ret = mk_user_insert(trie, user, string);
+
+		report(ret, err);
+		break;
+	case 3:
+		if (fscanf(in, "%99s", string) == 1)
+			ret = mk_user_remove(trie, user, string);
+
+		report(ret, err);
+		break;
+	case 4:
+		if (fscanf(in, "%99s", string) != 1 ||
+			read_number(in, UINT_MAX, &k) < 0) {
+			report(ret, err);
+			break;
+		}
+
+		ret = mk_user_autocorrect(trie, user, string, k, *result,
+								  *result_len, &needed);
+		if (ret == MK_ERANGE) {
+			if (grow_result(result, result_len, needed) < 0)
+				ret = MK_ENOMEM;
+			else
+				ret = mk_user_autocorrect(trie, user, string, k, *result,
+										  *result_len, &needed);
+		}
+
+		print_words(ret, *result, 1, out, err);
+		break;
+	case 5:
+		if (fscanf(in, "%99s", string) != 1 ||
+			read_number(in, UINT_MAX, &k) < 0) {
+			report(ret, err);
+			break;
+		}
+
+		ret = mk_user_autocomplete(trie, user, string, k, *result,
+								   *result_len);
+		print_words(ret, *result, k == 0 ? 3 : 1, out, err);
+		break;
+	default:
+		report(ret, err);
+		break;
+	}
+
+	return ret;
+}
+
+unsigned int run_command(mk_trie_t *trie, FILE *in, FILE *out, FILE *err,
+						 char **result, size_t *result_len,
+						 mk_err_t *status)
+{
+	char input[MAX_IN], string[MAX_STR], bound[MAX_STR];
+	double points[2 * SWIPE_MAX_PTS];
+	mk_plan_t plan;
+	unsigned long k, n, points_no, period, bytes, limit;
+	size_t needed;
+	mk_err_t ret = MK_OK;
+
+	*status = MK_OK;
+	if (fscanf(in, "%19s", input) != 1)
+		return EXIT_ID;
+
+	/**
+	 * The arguments are read with a limit, because they may come from the
+	 * network
+	 */
+	unsigned int id = parse_input(input);
+	switch (id) {
+	case 1:
+		if (fscanf(in, "%99s", string) != 1)
+			ret = MK_EINVAL;
+		else
+			ret = mk_insert(trie, string);
+
+		report(ret, err);
+		break;
+	case 2:
+		if (fscanf(in, "%99s", string) != 1)
+			ret = MK_EINVAL;
+		else
+			ret = mk_load(trie, string);
+
+		report(ret, err);
+		break;
+	case 3:
+		if (fscanf(in, "%99s", string) != 1)
+			ret = MK_EINVAL;
+		else
+			ret = mk_remove(trie, string);
+
+		report(ret, err);
+		break;
+	case 4:
+		if (fscanf(in, "%99s", string) != 1 ||
+			read_number(in, UINT_MAX, &k) < 0) {
+			ret = MK_EINVAL;
+			report(ret, err);
+			break;
+		}
+
+		ret = mk_autocorrect(trie, string, k, *result, *result_len,
+							 &needed);
+		if (ret == MK_ERANGE) {
+			if (grow_result(result, result_len, needed) < 0)
+				ret = MK_ENOMEM;
+			else
+				ret = mk_autocorrect(trie, string, k, *result, *result_len,
+									 &needed);
+		}
+
+		print_words(ret, *result, 1, out, err);
+		break;
+	case 5:
+		if (fscanf(in, "%99s", string) != 1 ||
+			read_number(in, UINT_MAX, &k) < 0) {
+			ret = MK_EINVAL;
+			report(ret, err);
+			break;
+		}
+
+		ret = mk_autocomplete(trie, string, k, *result, *result_len);
+
+		/**
+		 * Mode 0 prints 3 words, so it misses 3 times
+		 */
+		print_words(ret, *result, k == 0 ? 3 : 1, out, err);
+		break;
+	case EXIT_ID:
+		break;
+	case 7:
+		if (fscanf(in, "%99s", string) != 1)
+			ret = MK_EINVAL;
+		else
+			ret = mk_remove_batch(trie, string);
+
+		report(ret, err);
+		break;
+	case 8:
+		ret = mk_decay(trie);
+		report(ret, err);
+		break;
+	case 9:
+		if (read_number(in, ULONG_MAX, &period) < 0)
+			ret = MK_EINVAL;
+		else
+			ret = mk_set_decay_period(trie, period);
+
+		report(ret, err);
+		break;
+	case 10:
+		if (fscanf(in, "%99s", string) != 1 ||
+			read_number(in, UINT_MAX, &k) < 0 ||
+			read_number(in, MK_RESULTS_MAX, &n) < 0) {
+			ret = MK_EINVAL;
+			report(ret, err);
+			break;
+		}
+
+		ret = mk_autocomplete_fuzzy(trie, string, k, n, *result,
+									*result_len, &needed);
+		if (ret == MK_ERANGE) {
+			if (grow_result(result, result_len, needed) < 0)
+				ret = MK_ENOMEM;
+			else
+				ret = mk_autocomplete_fuzzy(trie, string, k, n, *result,
+											*result_len, &needed);
+		}
+
+		print_words(ret, *result, 1, out, err);
+		break;
+	case 11:
+		ret = mk_checkpoint(trie);
+		report(ret, err);
+		break;
+	case 12:
+		ret = mk_enable_snapshots(trie);
+		report(ret, err);
+		break;
+	case 13:
+		if (read_number(in, MK_RESULTS_MAX, &n) < 0 ||
+			read_number(in, SWIPE_MAX_PTS, &points_no) < 0 ||
+			points_no == 0) {
+			ret = MK_EINVAL;
+			report(ret, err);
+			break;
+		}
+
+		for (unsigned int i = 0; i < 2 * points_no && ret == MK_OK; i++) {
+			if (fscanf(in, "%lf", &points[i]) != 1)
+				ret = MK_EINVAL;
+		}
+
+		if (ret != MK_OK) {
+			report(ret, err);
+			break;
+		}
+
+		ret = mk_swipe(trie, points, points_no, n, *result, *result_len,
+					   &needed);
+		if (ret == MK_ERANGE) {
+			if (grow_result(result, result_len, needed) < 0)
+				ret = MK_ENOMEM;
+			else
+				ret = mk_swipe(trie, points, points_no, n, *result,
+							   *result_len, &needed);
+		}
+
+		print_words(ret, *result, 1, out, err);
+		break;
+	case 14:
+		if (read_number(in, ULONG_MAX, &bytes) < 0)
+			ret = MK_EINVAL;
+		else
+			ret = mk_set_mem_limit(trie, bytes);
+
+		report(ret, err);
+		break;
+	case 15:
+		print_stats(trie, out);
+		break;
+	case 16:
+		if (read_number(in, ULONG_MAX, &bytes) < 0)
+			ret = MK_EINVAL;
+		else
+			ret = mk_enable_tiers(trie, bytes);
+
+		report(ret, err);
+		break;
+	case 17:
+		ret = run_user_command(trie, in, out, err, result, result_len);
+		break;
+	case 18:
+		if (fscanf(in, "%99s", string) != 1 ||
+			read_number(in, ULONG_MAX, &limit) < 0)
+			ret = MK_EINVAL;
+		else
+			ret = mk_match(trie, string, limit, print_match, out, NULL);
+
+		/**
+		 * The words are already printed, only a miss is left to print
+		 */
+		if (ret != MK_OK)
+			print_words(ret, NULL, 1, out, err);
+		break;
+	case 19:
+		ret = mk_enable_index(trie);
+		report(ret, err);
+		break;
+	case 20:
+	case 21:
+		if (fscanf(in, "%99s", string) != 1 ||
+			read_number(in, ULONG_MAX, &limit) < 0)
+			ret = MK_EINVAL;
+		else if (id == 20)
+			ret = mk_find_suffix(trie, string, limit, print_match, out, NULL);
+		else
+			ret = mk_find_infix(trie, string, limit, print_match, out, NULL);
+
+		if (ret != MK_OK)
+			print_words(ret, NULL, 1, out, err);
+		break;
+	case 22:
+		ret = mk_freeze_words(trie);
+		report(ret, err);
+		break;
+	case 23:
+		if (fscanf(in, "%99s %99s %19s", string, bound, input) != 3 ||
+			strcmp(input, "LIMIT") != 0 ||
+			read_number(in, ULONG_MAX, &limit) < 0)
+			ret = MK_EINVAL;
+		else
+			ret = stream_range(trie, string, bound, limit, print_key, out);
+
+		if (ret != MK_OK)
+			print_words(ret, NULL, 1, out, err);
+		break;
+	case 24:
+		ret = stream_range(trie, NULL, NULL, 0, print_key_uses, out);
+		if (ret != MK_OK)
+			print_words(ret, NULL, 1, out, err);
+		break;
+	case 25:
+		if (fscanf(in, "%99s", string) != 1)
+			ret = MK_EINVAL;
+		else
+			ret = mk_load_async(trie, string);
+
+		report(ret, err);
+		break;
+	case 26:
+		print_load_status(trie, out);
+		break;
+	case 27:
+		if (fscanf(in, "%99s", string) != 1)
+			ret = MK_EINVAL;
+		else
+			ret = mk_load_bigrams(trie, string);
+
+		report(ret, err);
+		break;
+	case 29:
+		if (fscanf(in, "%99s", string) != 1 ||
+			read_number(in, UINT_MAX, &k) < 0) {
+			ret = MK_EINVAL;
+			report(ret, err);
+			break;
+		}
+
+		ret = mk_explain_autocomplete(trie, string, k, *result, *result_len,
+									  &plan);
+		print_words(ret, *result, k == 0 ? 3 : 1, out, err);
+		if (ret == MK_OK || ret == MK_ENOTFOUND)
+			print_plan(&plan, out);
+		break;
+	case 28:
+		if (fscanf(in, "%99s %99s", string, bound) != 2 ||
+			read_number(in, ULONG_MAX, &limit) < 0)
+			ret = MK_EINVAL;
+		else
+			ret = mk_predict(trie, string, bound, limit, print_key, out,
+							 NULL);
+
+		if (ret != MK_OK)
+			print_words(ret, NULL, 1, out, err);
+		break;
+	default:
+		break;
+	}
+
+	*status = ret == MK_ENOTFOUND ? MK_OK : ret;
+	return id;
+}
@@ -0,0 +1,206 @@
+#ifndef COMMANDS_H_
+#define COMMANDS_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+
+#include "libmk.h"
+#include "utils.h"
+
+/**
+ * The commands of the magic keyboard, shared by the interactive program and
+ * by the server. A command is a name followed by its arguments, separated by
+ * whitespace:
+ *
+ *	INSERT <word>			LOAD <file>
+ *	REMOVE <word>			REMOVE_BATCH <file>
+ *	AUTOCORRECT <word> <k>		AUTOCOMPLETE <prefix> <mode>
+ *	AUTOCOMPLETE_FUZZY <prefix> <k> <n>
+ *	DECAY				DECAY_EVERY <period>
+ *	CHECKPOINT			SNAPSHOTS
+ *	SWIPE <n> <points> <x1> <y1> ... <xp> <yp>
+ *	MEMORY_LIMIT <bytes>		STATS
+ *	TIERS <merge bytes>		EXIT
+ *	USER <id> INSERT <word>		USER <id> REMOVE <word>
+ *	USER <id> AUTOCORRECT <word> <k>	USER <id> AUTOCOMPLETE <prefix> <mode>
+ *	USER <id> DROP			MATCH <pattern> <limit>
+ *	INDEX				SUFFIX <suffix> <limit>
+ *	INFIX <infix> <limit>		FREEZE
+ *	RANGE <from> <to> LIMIT <n>	DUMP
+ *	LOAD_ASYNC <file>		LOAD_STATUS
+ *	BIGRAMS <file>			PREDICT <prev> <prefix> <n>
+ *	EXPLAIN <prefix> <mode>
+ */
+
+/**
+ * @brief Associates an unique id to some specific strings. If the string
+ * hasn't an associated id, it gives back 0, meaning that it is an
+ * unrecognized command / invalid command. The longer commands are checked
+ * first, because some of them start with the name of another one.
+ *
+ * @param string The string we want to associate and id.
+ * @return unsigned int The id associated, or 0 in case the string isn't in
+ * the list.
+ */
+unsigned int parse_input(char *string);
+
+/**
+ * @brief Prints the error of a command, if there is one.
+ *
+ * @param err The result of the command.
+ * @param stream Where the error is printed, or NULL to not print it.
+ */
+void report(mk_err_t err, FILE *stream);
+
+/**
+ * @brief Prints the words returned by a query, or the message for an empty
+ * result.
+ *
+ * @param err The result of the query.
+ * @param words The words, each one followed by '\n'.
+ * @param misses How many times the message is printed for an empty result.
+ * @param out Where the words are printed.
+ * @param stream Where the errors are printed, or NULL.
+ */
+void print_words(mk_err_t err, char *words, unsigned int misses, FILE *out,
+				 FILE *stream);
+
+/**
+ * @brief Reads a number argument. It must be written in decimal, without a
+ * sign, and it can't be bigger than max, because the commands may come
+ * from the network.
+ *
+ * @param in The stream the argument is read from.
+ * @param max The biggest value allowed.
+ * @param value Where to store the number.
+ * @return int Returns 0 on success, or -1 if the argument is missing or it
+ * isn't a number up to max.
+ */
+int read_number(FILE *in, unsigned long max, unsigned long *value);
+
+/**
+ * @brief Makes the result buffer big enough for a query that didn't fit.
+ *
+ * @param result The address of the buffer.
+ * @param result_len The address of the size of the buffer.
+ * @param needed The size the query needs.
+ * @return int Returns 0 on success, or -1 if there is no memory left. The
+ * old buffer is kept in that case.
+ */
+int grow_result(char **result, size_t *result_len, size_t needed);
+
+/**
+ * @brief Prints the size of the dictionary, its memory, and the evictions.
+ *
+ * @param trie The handle of the dictionary.
+ * @param out Where the numbers are printed.
+ */
+void print_stats(mk_trie_t *trie, FILE *out);
+
+/**
+ * @brief Prints the progress of the last background load, for LOAD_STATUS.
+ *
+ * @param trie The handle of the dictionary.
+ * @param out The stream where the progress is printed.
+ */
+void print_load_status(mk_trie_t *trie, FILE *out);
+
+/**
+ * @brief Prints how EXPLAIN found its words: every strategy that ran, with
+ * the nodes it visited, and its tasks if it ran on the workers.
+ *
+ * @param plan The strategies.
+ * @param out The stream where they are printed.
+ */
+void print_plan(mk_plan_t *plan, FILE *out);
+
+/**
+ * @brief Prints a word found by MATCH, SUFFIX or INFIX, as soon as it is
+ * found.
+ *
+ * @param word The word.
+ * @param out The stream where the word is printed.
+ * @return int Returns 0, to go on with the search.
+ */
+int print_match(const char *word, void *out);
+
+/**
+ * @brief Prints a word given by RANGE or by PREDICT.
+ *
+ * @param word The word.
+ * @param freq The number of uses of the word, or the count of its pair,
+ * not printed.
+ * @param out The stream where the word is printed.
+ * @return int Returns 0, to go on with the listing.
+ */
+int print_key(const char *word, unsigned long freq, void *out);
+
+/**
+ * @brief Prints a word given by DUMP, with its number of uses.
+ *
+ * @param word The word.
+ * @param freq The number of uses of the word.
+ * @param out The stream where the word is printed.
+ * @return int Returns 0, to go on with the listing.
+ */
+int print_key_uses(const char *word, unsigned long freq, void *out);
+
+/**
+ * @brief Lists the words of a range, in lexicographic order, a batch of
+ * CURSOR_BATCH words at a time, so the listing takes the same memory for
+ * any number of words, and the updates only wait for the current batch.
+ *
+ * @param trie The handle of the dictionary.
+ * @param from The first word of the range, included, NULL for the first
+ * word of the dictionary.
+ * @param to The end of the range, excluded, NULL for no end.
+ * @param limit The maximum number of words, 0 for all of them.
+ * @param found The function that prints a word.
+ * @param out The stream where the words are printed.
+ * @return mk_err_t MK_OK, MK_ENOTFOUND, or the error of mk_cursor_init or
+ * mk_cursor_fetch.
+ */
+mk_err_t stream_range(mk_trie_t *trie, char *from, char *to,
+					  unsigned long limit,
+					  int (*found)(const char *word, unsigned long freq,
+								   void *arg),
+					  FILE *out);
+
+/**
+ * @brief Reads and runs the rest of a USER command, on the view of a user.
+ *
+ * @param trie The handle of the dictionary.
+ * @param in The stream the command is read from, after USER.
+ * @param out Where the results are printed.
+ * @param err Where the errors are printed, or NULL to only return them.
+ * @param result A buffer for the results of the queries, grown when needed.
+ * @param result_len The size of the buffer.
+ * @return mk_err_t The result of the command.
+ */
+mk_err_t run_user_command(mk_trie_t *trie, FILE *in, FILE *out, FILE *err,
+						  char **result, size_t *result_len);
+
+/**
+ * @brief Reads a command and its arguments, and runs it. The results are
+ * printed like the interactive program always did, and an update prints
+ * nothing when it succeeds.
+ *
+ * @param trie The handle of the dictionary.
+ * @param in The stream the command is read from.
+ * @param out Where the results are printed.
+ * @param err Where the errors are printed, or NULL to only return them.
+ * @param result A buffer for the results of the queries, grown when needed.
+ * @param result_len The size of the buffer.
+ * @param status Where to store the result of the command. An empty query
+ * still counts as MK_OK, because its message is a result.
+ * @return unsigned int The id of the command, 0 if it isn't known, or the id
+ * of EXIT at the end of the stream.
+ */
+unsigned int run_command(mk_trie_t *trie, FILE *in, FILE *out, FILE *err,
+						 char **result, size_t *result_len,
+						 mk_err_t *status);
+
+#endif  // COMMANDS_H_
@@ -0,0 +1,71 @@
+#include "cursor.h"
+
+void cursor_seek(i_cursor_t *cursor, g_node_t *root, char *key)
+{
+	cursor->path[0] = root;
+	cursor->depth = 0;
+	cursor->done = 0;
+
+	/**
+	 * Every node on the path of the key has a smaller key of its own, and
+	 * its children before the next letter of the key hold smaller keys too,
+	 * so the walk resumes with the children after that letter
+	 */
+	for (size_t i = 0; key[i] != '\0'; i++) {
+		unsigned int idx = key[i] - 'a';
+		g_node_t *child = cursor->path[i]->children[idx];
+
+		cursor->next[i] = idx + 2;
+		if (!child) {
+			cursor->next[i] = idx + 1;
+			return;
+		}
+
+		cursor->buff[i] = key[i];
+		cursor->path[i + 1] = child;
+		cursor->depth = i + 1;
+	}
+
+	/**
+	 * The node of the key itself, whose own key is the first one to give
+	 */
+	cursor->next[cursor->depth] = 0;
+}
+
+g_node_t *cursor_next(i_cursor_t *cursor)
+{
+	while (!cursor->done) {
+		size_t depth = cursor->depth;
+		g_node_t *node = cursor->path[depth];
+
+		if (cursor->next[depth] == 0) {
+			cursor->next[depth] = 1;
+			if (((key_t *)node->data)->ending == END) {
+				cursor->buff[depth] = '\0';
+				return node;
+			}
+		}
+
+		/**
+		 * Go down to the next child with live keys, or back up when there
+		 * is none left
+		 */
+		unsigned int i = cursor->next[depth] - 1;
+		while (i < ALPH && !has_live_keys(node->children[i]))
+			i++;
+
+		if (i < ALPH) {
+			cursor->next[depth] = i + 2;
+			cursor->buff[depth] = i + 'a';
+			cursor->path[depth + 1] = node->children[i];
+			cursor->next[depth + 1] = 0;
+			cursor->depth = depth + 1;
+		} else if (depth == 0) {
+			cursor->done = 1;
+		} else {
+			cursor->depth = depth - 1;
+		}
+	}
+
+	return NULL;
+}
@@ -0,0 +1,41 @@
+#ifndef CURSOR_H_
+#define CURSOR_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "structs.h"
+#include "utils.h"
+#include "generic_tree.h"
+
+/**
+ * A cursor walks the keys of a trie in lexicographic order, one at a time.
+ * It keeps the path to the current node on an explicit stack, with the next
+ * child to visit for every node of the path, so it takes the same memory
+ * however many keys it gives, and it can stop and go on at any key. A node's
+ * own key comes before the keys of its children, because a word comes before
+ * its extensions. The trie must not change while a cursor is in use.
+ */
+
+/**
+ * @brief Places a cursor before the first key that is not smaller than a
+ * given one.
+ *
+ * @param cursor The cursor.
+ * @param root The root of the trie.
+ * @param key The key, "" for the first key of the trie.
+ */
+void cursor_seek(i_cursor_t *cursor, g_node_t *root, char *key);
+
+/**
+ * @brief Moves a cursor to the next key.
+ *
+ * @param cursor The cursor.
+ * @return g_node_t* The ending node of the key, with the key in the buff of
+ * the cursor, or NULL if there are no keys left.
+ */
+g_node_t *cursor_next(i_cursor_t *cursor);
+
+#endif  // CURSOR_H_
@@ -1,29 +1,58 @@
 #include "generic_tree.h"
+#include "word_ids.h"
 
 g_tree_t *create_generic_tree(u64_t data_size, void (*free_func)(void *))
 {
 	g_tree_t *new_tree = (g_tree_t *)malloc(sizeof(g_tree_t));
-	DIE(!new_tree, MEMFAIL);
+	if (!new_tree)
+		return NULL;
 
 	new_tree->data_size = data_size;
 	new_tree->free_func = free_func;
 	new_tree->keys_no = 0;
 	new_tree->root = NULL;
 
+	new_tree->epoch = 0;
+	new_tree->decay_period = 0;
+	new_tree->since_decay = 0;
+
+	new_tree->tombs = NULL;
+	new_tree->tombs_no = 0;
+	new_tree->tombs_cap = 0;
+
+	new_tree->mem_used = 0;
+	new_tree->mem_limit = 0;
+	new_tree->evicted = 0;
+	new_tree->rand_state = EVICT_SEED;
+	new_tree->evict_func = NULL;
+	new_tree->evict_arg = NULL;
+	new_tree->ids = NULL;
+
 	return new_tree;
 }
 
-g_node_t *init_tnode(char key, state_t end_of_word, s32_t freq)
+g_node_t *init_tnode(char key, state_t end_of_word, u64_t freq)
 {
 	g_node_t *new_node = (g_node_t *)malloc(sizeof(g_node_t));
-	DIE(!new_node, MEMFAIL);
+	if (!new_node)
+		return NULL;
 
 	new_node->data  = (key_t *)malloc(sizeof(key_t));
-	DIE(!new_node->data, MEMFAIL);
+	new_node->children = (g_node_t **)malloc(ALPH * sizeof(g_node_t *));
+	if (!new_node->data || !new_node->children) {
+		free(new_node->data);
+		free(new_node->children);
+		free(new_node);
+		return NULL;
+	}
 
 	((key_t *)new_node->data)->key = key;
 	((key_t *)new_node->data)->ending = end_of_word;
 	((key_t *)new_node->data)->freq = freq;
+	((key_t *)new_node->data)->score = 0;
+	((key_t *)new_node->data)->epoch = 0;
+	((key_t *)new_node->data)->bound = 0;
+	((key_t *)new_node->data)->bound_epoch = 0;
 
 	/**
 	 * All the nodes will be initialized with INF distance, because it will
@@ -31,9 +60,9 @@ g_node_t *init_tnode(char key, state_t end_of_word, s32_t freq)
 	 * isn't and ending node
 	 */
 	((key_t *)new_node->data)->key_len = INF;
-
-	new_node->children = (g_node_t **)malloc(ALPH * sizeof(g_node_t *));
-	DIE(!new_node->children, MEMFAIL);
+	((key_t *)new_node->data)->subkeys = 0;
+	((key_t *)new_node->data)->shadowed = 0;
+	((key_t *)new_node->data)->id = W_NO_ID;
 
 	/**
 	 * Set all possible children to NULL
@@ -52,9 +81,11 @@ g_node_t *init_tnode(char key, state_t end_of_word, s32_t freq)
 	return new_node;
 }
 
-void init_trie(g_tree_t *tree)
+int init_trie(g_tree_t *tree)
 {
-	g_node_t *root = init_tnode('\0', ROOT, -1);
+	g_node_t *root = init_tnode('\0', ROOT, 0);
+	if (!root)
+		return -1;
 
 	/**
 	 * The Root doesn't have a parent, it is the parent of all the possible
@@ -63,6 +94,13 @@ void init_trie(g_tree_t *tree)
 	root->parent = NULL;
 
 	tree->root = root;
+	tree->mem_used += tnode_size();
+	return 0;
+}
+
+u64_t tnode_size(void)
+{
+	return sizeof(g_node_t) + sizeof(key_t) + ALPH * sizeof(g_node_t *);
 }
 
 void free_tnode(void *data)
@@ -70,14 +108,16 @@ void free_tnode(void *data)
 	free(data);
 }
 
-void free_trie(g_node_t *root, void (*free_func)(void *))
+u64_t free_trie(g_node_t *root, void (*free_func)(void *))
 {
+	u64_t freed = 1;
+
 	/**
 	 * Free all the node's children
 	 */
 	for (unsigned int i = 0; i < ALPH; i++) {
 		if (root->children[i])
-			free_trie(root->children[i], free_func);
+			freed += free_trie(root->children[i], free_func);
 	}
 
 	/**
@@ -86,10 +126,19 @@ void free_trie(g_node_t *root, void (*free_func)(void *))
 	free(root->children);
 	free_func(root->data);
 	free(root);
+
+	return freed;
 }
 
-void insert_key(g_node_t *root, char *key_ptr, size_t key_len)
+g_node_t *insert_key(g_tree_t *trie, g_node_t *root, char *key_ptr,
+					 size_t key_len)
 {
+	/**
+	 * The function is called only for new keys, so every node on the path
+	 * gets one more live key in its subtrie
+	 */
+	((key_t *)root->data)->subkeys++;
+
 	/**
 	 * If the pointer to the string reaches a '\0', it means that it met the
 	 * end of the string at the previous iteration, and the root is actually
@@ -98,9 +147,10 @@ void insert_key(g_node_t *root, char *key_ptr, size_t key_len)
 	 */
 	if (*key_ptr == '\0') {
 		((key_t *)root->data)->ending = END;
-		((key_t *)root->data)->freq = 1;
+		((key_t *)root->data)->freq = 0;
+		((key_t *)root->data)->score = 0;
 		((key_t *)root->data)->key_len = key_len;
-		return;
+		return root;
 	}
 
 	/**
@@ -114,29 +164,189 @@ void insert_key(g_node_t *root, char *key_ptr, size_t key_len)
 	 */
 	if (!root->children[idx]) {
 		root->children[idx] = init_tnode(c, NOT_END, 0);
+		if (!root->children[idx]) {
+			((key_t *)root->data)->subkeys--;
+			return NULL;
+		}
+
 		root->children[idx]->parent = root;
 		root->children_num++;
+		trie->mem_used += tnode_size();
 	}
 
 	/**
 	 * Call the function for the next letter and the corresponding child.
+	 * If the allocation failed somewhere below, the key wasn't inserted, so
+	 * undo the count. The nodes created so far stay without live keys, and
+	 * the searches ignore them.
 	 */
 	key_ptr++;
-	insert_key(root->children[idx], key_ptr, key_len);
+	g_node_t *end = insert_key(trie, root->children[idx], key_ptr, key_len);
+	if (!end)
+		((key_t *)root->data)->subkeys--;
+
+	return end;
 }
 
-void insert_and_update_trie(g_tree_t *trie, char *key)
+int insert_and_update_trie(g_tree_t *trie, char *key)
 {
-	char *key_ptr = key;
-	g_node_t *key_node = get_ending_node(trie->root, key_ptr);
-	if (key_node) {
-		((key_t *)key_node->data)->freq++;
-		return;
+	g_node_t *key_node = find_key(trie, key);
+	if (!key_node) {
+		char *key_ptr = key;
+		key_node = insert_key(trie, trie->root, key_ptr, strlen(key));
+		if (!key_node)
+			return -1;
+
+		trie->keys_no++;
+		if (trie->ids)
+			w_link(trie->ids, key_node, key);
+	}
+
+	bump_key((key_t *)key_node->data, trie->epoch);
+	raise_bounds(key_node, trie->epoch);
+	if (trie->ids)
+		w_sync(trie->ids, key_node);
+
+	/**
+	 * The new key is kept, the victims are the other keys that are used less
+	 */
+	enforce_budget(trie, key_node);
+
+	/**
+	 * The automatic decay is just a counter, so it costs nothing when it is
+	 * turned off
+	 */
+	if (trie->decay_period) {
+		trie->since_decay++;
+		if (trie->since_decay >= trie->decay_period)
+			decay_trie(trie);
+	}
+
+	return 0;
+}
+
+int restore_key(g_tree_t *trie, char *key, u64_t freq, u64_t score,
+				unsigned int epoch)
+{
+	g_node_t *key_node = find_key(trie, key);
+	if (!key_node) {
+		char *key_ptr = key;
+		key_node = insert_key(trie, trie->root, key_ptr, strlen(key));
+		if (!key_node)
+			return -1;
+
+		trie->keys_no++;
+		if (trie->ids)
+			w_link(trie->ids, key_node, key);
 	}
 
-	key_ptr = key;
-	insert_key(trie->root, key_ptr, strlen(key));
-	trie->keys_no++;
+	((key_t *)key_node->data)->freq = freq;
+	((key_t *)key_node->data)->score = score;
+	((key_t *)key_node->data)->epoch = epoch;
+	raise_bounds(key_node, trie->epoch);
+	if (trie->ids)
+		w_sync(trie->ids, key_node);
+
+	return 0;
+}
+
+u64_t key_score(key_t *key, unsigned int epoch)
+{
+	/**
+	 * The score was stored at key->epoch, and every epoch since then halves
+	 * it. After 64 halvings there is nothing left of it.
+	 */
+	unsigned int age = epoch - key->epoch;
+	if (age >= 64)
+		return 0;
+
+	return key->score >> age;
+}
+
+void bump_key(key_t *key, unsigned int epoch)
+{
+	/**
+	 * Normalise the score to the current epoch, before adding the new use
+	 */
+	key->score = key_score(key, epoch);
+	key->epoch = epoch;
+
+	key->score += SCORE_ONE;
+	key->freq++;
+}
+
+u64_t key_bound(key_t *key, unsigned int epoch)
+{
+	/**
+	 * The bound halves with the scores under it, so it stays above them
+	 */
+	unsigned int age = epoch - key->bound_epoch;
+	if (age >= 64)
+		return 0;
+
+	return key->bound >> age;
+}
+
+void raise_bounds(g_node_t *node, unsigned int epoch)
+{
+	u64_t score = key_score((key_t *)node->data, epoch);
+
+	/**
+	 * A parent is never bounded below its children, so the climb stops at
+	 * the first node that is already high enough
+	 */
+	for (; node; node = node->parent) {
+		key_t *key = (key_t *)node->data;
+		if (key_bound(key, epoch) >= score)
+			return;
+
+		key->bound = score;
+		key->bound_epoch = epoch;
+	}
+}
+
+void tighten_bounds(g_node_t *node, unsigned int epoch)
+{
+	for (; node; node = node->parent) {
+		key_t *key = (key_t *)node->data;
+		u64_t bound = key->ending == END ? key_score(key, epoch) : 0;
+
+		for (unsigned int i = 0; i < ALPH; i++) {
+			if (!has_live_keys(node->children[i]))
+				continue;
+
+			u64_t child = key_bound((key_t *)node->children[i]->data, epoch);
+			if (child > bound)
+				bound = child;
+		}
+
+		if (bound == key_bound(key, epoch))
+			return;
+
+		key->bound = bound;
+		key->bound_epoch = epoch;
+	}
+}
+
+void decay_trie(g_tree_t *trie)
+{
+	/**
+	 * No node is touched, the scores are normalised lazily, by key_score and
+	 * bump_key
+	 */
+	trie->epoch++;
+	trie->since_decay = 0;
+}
+
+u8_t has_live_keys(g_node_t *node)
+{
+	if (!node)
+		return 0;
+
+	if (((key_t *)node->data)->subkeys == 0)
+		return 0;
+
+	return 1;
 }
 
 u8_t has_key(g_node_t *root, char *key_ptr)
@@ -157,6 +367,26 @@ u8_t has_key(g_node_t *root, char *key_ptr)
 	return has_key(root->children[idx], key_ptr);
 }
 
+g_node_t *find_key(g_tree_t *trie, char *key)
+{
+	/**
+	 * A frozen word has a single node, so its id is enough. The words added
+	 * after the freeze are walked.
+	 */
+	if (trie->ids) {
+		u32_t id = w_find(trie->ids, key);
+		if (id != W_NO_ID) {
+			g_node_t *node = trie->ids->nodes[id];
+			if (node && ((key_t *)node->data)->ending == END)
+				return node;
+
+			return NULL;
+		}
+	}
+
+	return get_ending_node(trie->root, key);
+}
+
 g_node_t *get_ending_node(g_node_t *root, char *key_ptr)
 {
 	state_t is_end = ((key_t *)root->data)->ending;
@@ -189,15 +419,100 @@ g_node_t *get_ending_node(g_node_t *root, char *key_ptr)
 	return get_ending_node(root->children[idx], key_ptr);
 }
 
-void remove_key(g_node_t *end, void (*free_func)(void *))
+void lookup_batch(g_node_t *root, char **keys, unsigned int keys_no,
+				  unsigned int group, u8_t prefix, g_node_t **ends)
+{
+	g_node_t *cur[LOOKUP_GROUP_MAX];
+	size_t pos[LOOKUP_GROUP_MAX];
+
+	if (group == 0)
+		group = 1;
+	if (group > LOOKUP_GROUP_MAX)
+		group = LOOKUP_GROUP_MAX;
+
+	for (unsigned int first = 0; first < keys_no; first += group) {
+		unsigned int size = keys_no - first < group ? keys_no - first : group;
+		unsigned int active = size;
+
+		for (unsigned int i = 0; i < size; i++) {
+			cur[i] = root;
+			pos[i] = 0;
+		}
+
+		while (active > 0) {
+			/**
+			 * First pass: every node was prefetched by the previous level,
+			 * so only the lines of the next level are requested
+			 */
+			for (unsigned int i = 0; i < size; i++) {
+				if (!cur[i])
+					continue;
+
+				char c = keys[first + i][pos[i]];
+				if (prefix || c == '\0')
+					__builtin_prefetch(cur[i]->data);
+				if (c != '\0')
+					__builtin_prefetch(&cur[i]->children[c - 'a']);
+			}
+
+			/**
+			 * Second pass: check the nodes, step to the children, and ask
+			 * for the children before any of them is touched
+			 */
+			for (unsigned int i = 0; i < size; i++) {
+				if (!cur[i])
+					continue;
+
+				char c = keys[first + i][pos[i]];
+				u8_t dead = prefix && pos[i] > 0 &&
+							((key_t *)cur[i]->data)->subkeys == 0;
+
+				if (dead || c == '\0') {
+					if (dead || (!prefix &&
+								 ((key_t *)cur[i]->data)->ending != END))
+						ends[first + i] = NULL;
+					else
+						ends[first + i] = cur[i];
+
+					cur[i] = NULL;
+					active--;
+					continue;
+				}
+
+				cur[i] = cur[i]->children[c - 'a'];
+				pos[i]++;
+
+				if (cur[i]) {
+					__builtin_prefetch(cur[i]);
+				} else {
+					ends[first + i] = NULL;
+					active--;
+				}
+			}
+		}
+	}
+}
+
+void remove_key(g_tree_t *trie, g_node_t *end)
 {
 	/**
 	 * If it reaches the trie's root, I don't want it to be deleted, so I have
 	 * to come back from recursion.
 	 *
 	 */
-	if (((key_t *)end->data)->ending == ROOT)
+	if (((key_t *)end->data)->ending == ROOT) {
+		tighten_bounds(end, trie->epoch);
 		return;
+	}
+
+	/**
+	 * Only the first call gets an END node, so the number of live keys is
+	 * updated just once, on the whole path
+	 */
+	if (((key_t *)end->data)->ending == END) {
+		for (g_node_t *node = end; node; node = node->parent)
+			((key_t *)node->data)->subkeys--;
+	}
 
 	/**
 	 * If the node has children, I don't want to delete it at all, because the
@@ -207,7 +522,12 @@ void remove_key(g_node_t *end, void (*free_func)(void *))
 	 */
 	if (end->children_num != 0) {
 		((key_t *)end->data)->ending = NOT_END;
+		((key_t *)end->data)->freq = 0;
+		((key_t *)end->data)->score = 0;
 		((key_t *)end->data)->key_len = INF;
+		if (trie->ids)
+			w_sync(trie->ids, end);
+		tighten_bounds(end, trie->epoch);
 		return;
 	}
 
@@ -224,48 +544,411 @@ void remove_key(g_node_t *end, void (*free_func)(void *))
 	 */
 	parent->children_num--;
 
-	free_func(end->data);
+	if (trie->ids)
+		w_forget(trie->ids, end);
+
+	trie->free_func(end->data);
 	free(end->children);
 	free(end);
 
 	parent->children[idx] = NULL;
+	trie->mem_used -= tnode_size();
 
 	/**
 	 * If there were 2 overlapping words, I have to stop when it reaches one
 	 * ending of a word.
 	 */
-	if (((key_t *)parent->data)->ending == END)
+	if (((key_t *)parent->data)->ending == END) {
+		tighten_bounds(parent, trie->epoch);
 		return;
+	}
 
-	remove_key(parent, free_func);
+	remove_key(trie, parent);
 }
 
-void remove_and_update_trie(g_tree_t *trie, char *key)
+int tombstone_key(g_tree_t *trie, g_node_t *end)
 {
-	char *key_ptr = key;
-	g_node_t *end = get_ending_node(trie->root, key_ptr);
+	/**
+	 * Make room for the node first, so nothing is changed if there is no
+	 * memory left
+	 */
+	if (trie->tombs_no == trie->tombs_cap) {
+		u64_t cap = trie->tombs_cap ? 2 * trie->tombs_cap : 16;
+		g_node_t **tombs = (g_node_t **)realloc(trie->tombs,
+												cap * sizeof(g_node_t *));
+		if (!tombs)
+			return -1;
+
+		trie->tombs = tombs;
+		trie->tombs_cap = cap;
+	}
+
+	/**
+	 * The node stays in the trie, but it will be ignored at searches, just
+	 * like an inner node that was never an ending
+	 */
+	((key_t *)end->data)->ending = NOT_END;
+	((key_t *)end->data)->freq = 0;
+	((key_t *)end->data)->score = 0;
+	((key_t *)end->data)->key_len = INF;
+	if (trie->ids)
+		w_sync(trie->ids, end);
 
+	/**
+	 * Update the number of live keys on the whole path, root included
+	 */
+	g_node_t *node = end;
+	while (node) {
+		((key_t *)node->data)->subkeys--;
+		node = node->parent;
+	}
+
+	tighten_bounds(end, trie->epoch);
+	trie->keys_no--;
+
+	/**
+	 * Remember the node, so the sweep can find the dead branch without
+	 * walking the whole trie
+	 */
+	trie->tombs[trie->tombs_no] = end;
+	trie->tombs_no++;
+
+	return 0;
+}
+
+int remove_and_update_trie(g_tree_t *trie, char *key)
+{
+	g_node_t *end = find_key(trie, key);
 	if (!end)
-		return;
+		return 0;
+
+	if (tombstone_key(trie, end) < 0)
+		return -1;
+
+	/**
+	 * The dead branches are freed in bulk, once there are enough of them
+	 */
+	if (trie->tombs_no >= SWEEP_THRESHOLD)
+		sweep_trie(trie);
+
+	return 0;
+}
+
+void sweep_trie(g_tree_t *trie)
+{
+	g_node_t **tops = trie->tombs;
+	u64_t tops_no = 0;
+
+	/**
+	 * For every tombstone, climb to the highest ancestor that doesn't have
+	 * live keys anymore. That is the top of a dead branch, so it can be
+	 * detached from its parent. The tops are freed only after all of them
+	 * were found, because some tombstones can be in the same dead branch,
+	 * and they have to climb through valid memory. The tops are stored over
+	 * the tombs array, because there can't be more tops than tombs.
+	 */
+	for (u64_t i = 0; i < trie->tombs_no; i++) {
+		g_node_t *node = trie->tombs[i];
+
+		/**
+		 * The key was inserted again after it was removed
+		 */
+		if (has_live_keys(node))
+			continue;
+
+		while (((key_t *)node->parent->data)->ending != ROOT &&
+			   !has_live_keys(node->parent))
+			node = node->parent;
+
+		char c = ((key_t *)node->data)->key;
+		unsigned int idx = c - 'a';
+
+		/**
+		 * Another tombstone from the same branch already detached it
+		 */
+		if (node->parent->children[idx] != node)
+			continue;
+
+		node->parent->children[idx] = NULL;
+		node->parent->children_num--;
 
-	remove_key(end, trie->free_func);
+		tops[tops_no] = node;
+		tops_no++;
+	}
+
+	for (u64_t i = 0; i < tops_no; i++) {
+		if (trie->ids)
+			w_forget_subtrie(trie->ids, tops[i]);
+
+		trie->mem_used -= free_trie(tops[i], trie->free_func) * tnode_size();
+	}
+
+	trie->tombs_no = 0;
+}
+
+g_node_t *sample_key(g_tree_t *trie)
+{
+	g_node_t *node = trie->root;
+	if (!has_live_keys(node))
+		return NULL;
+
+	/**
+	 * Every node knows how many live keys are below it, so going down with
+	 * those odds gives every key the same chance
+	 */
+	for (;;) {
+		key_t *key = (key_t *)node->data;
+		trie->rand_state ^= trie->rand_state << 13;
+		trie->rand_state ^= trie->rand_state >> 7;
+		trie->rand_state ^= trie->rand_state << 17;
+		u64_t r = trie->rand_state % key->subkeys;
+
+		if (key->ending == END) {
+			if (r == 0)
+				return node;
+			r--;
+		}
+
+		unsigned int i;
+		for (i = 0; i < ALPH; i++) {
+			if (!has_live_keys(node->children[i]))
+				continue;
+
+			u64_t subkeys = ((key_t *)node->children[i]->data)->subkeys;
+			if (r < subkeys)
+				break;
+			r -= subkeys;
+		}
+
+		node = node->children[i];
+	}
+}
+
+g_node_t *pick_victim(g_tree_t *trie, g_node_t *protect)
+{
+	g_node_t *victim = NULL;
+	u64_t victim_score = 0;
+
+	for (unsigned int i = 0; i < EVICT_SAMPLES; i++) {
+		g_node_t *node = sample_key(trie);
+		if (!node || node == protect)
+			continue;
+
+		u64_t score = key_score((key_t *)node->data, trie->epoch);
+		if (!victim || score < victim_score) {
+			victim = node;
+			victim_score = score;
+		}
+	}
+
+	return victim;
+}
+
+int evict_key(g_tree_t *trie, g_node_t *protect)
+{
+	/**
+	 * The eager removal can free a branch with tombstones in it, so the
+	 * tombstones go first. The sweep may free enough memory by itself.
+	 */
+	if (trie->tombs_no > 0) {
+		sweep_trie(trie);
+		return 0;
+	}
+
+	g_node_t *victim = pick_victim(trie, protect);
+	if (!victim)
+		return -1;
+
+	/**
+	 * Write the key from its end, into the ring of the last evicted keys
+	 */
+	char *word = trie->recent[trie->evicted % EVICT_RECENT];
+	size_t len = ((key_t *)victim->data)->key_len;
+	word[len] = '\0';
+	for (g_node_t *node = victim; len > 0; node = node->parent) {
+		len--;
+		word[len] = ((key_t *)node->data)->key;
+	}
+
+	remove_key(trie, victim);
 	trie->keys_no--;
+	trie->evicted++;
+
+	if (trie->evict_func)
+		trie->evict_func(trie->evict_arg, word);
+
+	return 0;
+}
+
+void enforce_budget(g_tree_t *trie, g_node_t *protect)
+{
+	while (trie->mem_limit && trie->mem_used > trie->mem_limit) {
+		if (evict_key(trie, protect) < 0)
+			break;
+	}
+}
+
+int read_word(FILE *file, char *buff)
+{
+	int c;
+	do {
+		c = getc(file);
+	} while (c != EOF && isspace(c));
+
+	if (c == EOF)
+		return EOF;
+
+	/**
+	 * The token is read until its end even after it stopped being a word,
+	 * so the rest of it isn't taken for the next one
+	 */
+	size_t len = 0;
+	int valid = 1;
+	for (; c != EOF && !isspace(c); c = getc(file)) {
+		if (c < 'a' || c > 'z' || len + 1 >= MAX_BUFF)
+			valid = 0;
+
+		if (valid)
+			buff[len++] = c;
+	}
+
+	buff[len] = '\0';
+	return valid;
 }
 
-void load_file(g_tree_t *trie, char *filename)
+int remove_batch_file(g_tree_t *trie, char *filename)
 {
 	char buff[MAX_BUFF];
 	FILE *file = fopen(filename, "rt");
-	DIE(!file, "Couldn't open the file. Please try again\n");
+	if (!file)
+		return -1;
+
+	/**
+	 * Read the whole list first, so it can be sorted
+	 */
+	char **words = NULL;
+	u64_t words_no = 0, words_cap = 0;
+	int ret = 0, read;
+	while ((read = read_word(file, buff)) != EOF) {
+		if (!read)
+			continue;
+
+		if (words_no == words_cap) {
+			u64_t cap = words_cap ? 2 * words_cap : 64;
+			char **aux = (char **)realloc(words, cap * sizeof(char *));
+			if (!aux) {
+				ret = -1;
+				break;
+			}
+
+			words = aux;
+			words_cap = cap;
+		}
+
+		words[words_no] = (char *)malloc(strlen(buff) + 1);
+		if (!words[words_no]) {
+			ret = -1;
+			break;
+		}
+
+		strcpy(words[words_no], buff);
+		words_no++;
+	}
+
+	fclose(file);
+
+	if (ret < 0) {
+		for (u64_t i = 0; i < words_no; i++)
+			free(words[i]);
+		free(words);
+		return ret;
+	}
+
+	qsort(words, words_no, sizeof(char *), compare_words);
+
+	/**
+	 * path[i] is the node reached after the first i letters of the previous
+	 * word, and depth is how many of them exist in the trie. Sorted words
+	 * share their prefixes with the previous one, so every node on the common
+	 * part is visited only once. The tombstones don't free anything, so the
+	 * path stays valid during the whole pass.
+	 */
+	g_node_t *path[MAX_BUFF];
+	size_t depth = 0;
+	char *prev = "";
+	path[0] = trie->root;
+
+	for (u64_t i = 0; i < words_no; i++) {
+		char *word = words[i];
+
+		size_t common = 0;
+		while (common < depth && word[common] != '\0' &&
+			   word[common] == prev[common])
+			common++;
+
+		depth = common;
+		while (word[depth] != '\0') {
+			g_node_t *child = path[depth]->children[word[depth] - 'a'];
+			if (!child)
+				break;
+
+			path[depth + 1] = child;
+			depth++;
+		}
+
+		prev = word;
+
+		/**
+		 * The word isn't in the trie (or it is a duplicate, already removed)
+		 */
+		if (word[depth] != '\0')
+			continue;
+
+		if (((key_t *)path[depth]->data)->ending != END)
+			continue;
+
+		if (tombstone_key(trie, path[depth]) < 0) {
+			ret = -1;
+			break;
+		}
+	}
+
+	/**
+	 * One sweep for the whole batch
+	 */
+	sweep_trie(trie);
+
+	for (u64_t i = 0; i < words_no; i++)
+		free(words[i]);
+	free(words);
+
+	return ret;
+}
+
+int compare_words(const void *a, const void *b)
+{
+	return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+int load_file(g_tree_t *trie, char *filename)
+{
+	char buff[MAX_BUFF];
+	FILE *file = fopen(filename, "rt");
+	if (!file)
+		return -1;
 
 	/**
 	 * Read all the words and insert them using the functions made by now.
 	 * Read until there is nothing left to read
 	 */
-	while (fscanf(file, "%s", buff) == 1)
-		insert_and_update_trie(trie, buff);
+	int ret = 0, read;
+	while (ret == 0 && (read = read_word(file, buff)) != EOF) {
+		if (read)
+			ret = insert_and_update_trie(trie, buff);
+	}
 
 	fclose(file);
+	return ret;
 }
 
 void print_tree(g_node_t *root, char *buff, unsigned int buff_idx)
@@ -276,7 +959,7 @@ void print_tree(g_node_t *root, char *buff, unsigned int buff_idx)
 	 */
 	if (root->children_num == 0) {
 		buff[buff_idx] = '\0';
-		printf("%s %d\n", buff, ((key_t *)root->data)->freq);
+		printf("%s %lu\n", buff, ((key_t *)root->data)->freq);
 		return;
 	}
 
@@ -286,14 +969,14 @@ void print_tree(g_node_t *root, char *buff, unsigned int buff_idx)
 	 */
 	if (((key_t *)root->data)->ending == END) {
 		buff[buff_idx] = '\0';
-		printf("%s %d\n", buff, ((key_t *)root->data)->freq);
+		printf("%s %lu\n", buff, ((key_t *)root->data)->freq);
 	}
 
 	/**
 	 * Search for the next letter in the possible word
 	 */
 	for (unsigned int i = 0; i < ALPH; i++)
-		if (root->children[i]) {
+		if (has_live_keys(root->children[i])) {
 			char c = i + 'a';
 			buff[buff_idx] = c;
 			buff_idx++;
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <inttypes.h>
 
 #include "structs.h"
@@ -14,7 +15,8 @@
  *
  * @param data_size The size of the data that will be stored in nodes.
  * @param free_func The function that will free the data stored in nodes.
- * @return g_tree_t* The newly created generic tree, with uninitalized root.
+ * @return g_tree_t* The newly created generic tree, with uninitalized root,
+ * or NULL if there is no memory left.
  */
 g_tree_t *create_generic_tree(u64_t data_size, void (*free_func)(void *));
 
@@ -26,21 +28,32 @@ g_tree_t *create_generic_tree(u64_t data_size, void (*free_func)(void *));
  * This will help later. It is useful because some words can overlap.
  * @param freq The frequency of the character. Actually, it is an optional
  * feature, it is never used at all.
- * @return g_node_t* The newly created node, with the given parameters.
+ * @return g_node_t* The newly created node, with the given parameters, or
+ * NULL if there is no memory left.
  */
-g_node_t *init_tnode(char key, state_t end_of_word, s32_t freq);
+g_node_t *init_tnode(char key, state_t end_of_word, u64_t freq);
 
 /**
  * @brief Initializes the root of a trie, and set the params of the generic
  * tree. It initializez the root of the generic tree  with a '\0' key, a ROOT
- * state, and -1 frequency. This will help at searches, because the root will
+ * state, and 0 frequency. This will help at searches, because the root will
  * not influence the maximum frequency, and it won't be considered as the end
  * of a word.
  *
  * @param tree The generic tree created by the create_generic_tree function,
  * that we want to be a trie.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
  */
-void init_trie(g_tree_t *tree);
+int init_trie(g_tree_t *tree);
+
+/**
+ * @brief Gives the memory of a trie node: the node, its key_t data, and its
+ * array of children. Every node has the same size, so the memory of a trie
+ * is tracked exactly by counting the nodes as they are created and freed.
+ *
+ * @return u64_t The size of a node, in bytes.
+ */
+u64_t tnode_size(void);
 
 /**
  * @brief The function that frees a key_t structure. It is actually just
@@ -57,21 +70,26 @@ void free_tnode(void *data);
  *
  * @param root The root of the trie we want to delete.
  * @param free_func The function that frees the data within a node.
+ * @return u64_t The number of nodes freed.
  */
-void free_trie(g_node_t *root, void (*free_func)(void *));
+u64_t free_trie(g_node_t *root, void (*free_func)(void *));
 
 /**
  * @brief Insert a node into a subtrie starting at node given as first
  * parameter. It is designed to start from the root of the trie, but it
  * should work for subtries too.
  *
+ * @param trie The trie, that counts the memory of the new nodes.
  * @param root The root of subtrie / trie where we want to add the key
  * @param key_ptr A pointer to the current letter in the key buffer.
  * It should be positioned at the begining of the string.
  * @param key_len The length of the actual key (I mean the length of the word
  * we want to insert). It will help when we'll try to search the shortest word.
+ * @return g_node_t* The ending node of the key, with 0 frequency, or NULL if
+ * there is no memory left. In that case, the key is not in the trie.
  */
-void insert_key(g_node_t *root, char *key_ptr, size_t key_len);
+g_node_t *insert_key(g_tree_t *trie, g_node_t *root, char *key_ptr,
+					 size_t key_len);
 
 /**
  * @brief Inserts a given key into the trie structure. If they key already
@@ -81,8 +99,91 @@ void insert_key(g_node_t *root, char *key_ptr, size_t key_len);
  *
  * @param tree The trie where we want to insert the key.
  * @param key The key that needs to be inserted.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
  */
-void insert_and_update_trie(g_tree_t *tree, char *key);
+int insert_and_update_trie(g_tree_t *tree, char *key);
+
+/**
+ * @brief Inserts a key with a known frequency and score, the way it was when
+ * it was saved. If the key already exists, its counters are overwritten.
+ *
+ * @param trie The trie where we want to insert the key.
+ * @param key The key.
+ * @param freq The frequency of the key.
+ * @param score The score of the key, as of epoch.
+ * @param epoch The decay epoch when the score was normalised.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+int restore_key(g_tree_t *trie, char *key, u64_t freq, u64_t score,
+				unsigned int epoch);
+
+/**
+ * @brief Gets the decayed frequency of a key at a given epoch. The score is
+ * halved once for every epoch that passed since it was last normalised, so
+ * the old uses of a key count less and less.
+ *
+ * @param key The data of the ending node of the key.
+ * @param epoch The current decay epoch of the trie.
+ * @return u64_t The score of the key, in SCORE_ONE units.
+ */
+u64_t key_score(key_t *key, unsigned int epoch);
+
+/**
+ * @brief Counts one more use of a key. The score is normalised to the current
+ * epoch first, so only the touched key is updated.
+ *
+ * @param key The data of the ending node of the key.
+ * @param epoch The current decay epoch of the trie.
+ */
+void bump_key(key_t *key, unsigned int epoch);
+
+/**
+ * @brief Gets the upper bound of the scores in the subtrie of a node, at a
+ * given epoch. It decays like the scores, so it never falls under them.
+ *
+ * @param key The data of the node.
+ * @param epoch The current decay epoch of the trie.
+ * @return u64_t The bound, in SCORE_ONE units.
+ */
+u64_t key_bound(key_t *key, unsigned int epoch);
+
+/**
+ * @brief Raises the bounds on the path of a key up to its score, after the
+ * score grew.
+ *
+ * @param node The ending node of the key.
+ * @param epoch The current decay epoch of the trie.
+ */
+void raise_bounds(g_node_t *node, unsigned int epoch);
+
+/**
+ * @brief Lowers the bounds from a node up, after a key under it lost its
+ * score, to the best score left among the node and its children. The climb
+ * stops at the first bound that doesn't change.
+ *
+ * @param node The lowest node whose subtrie changed.
+ * @param epoch The current decay epoch of the trie.
+ */
+void tighten_bounds(g_node_t *node, unsigned int epoch);
+
+/**
+ * @brief Halves the scores of all the keys in O(1), by moving the trie to the
+ * next epoch. The nodes are normalised later, when they are read or bumped.
+ *
+ * @param trie The trie we want to decay.
+ */
+void decay_trie(g_tree_t *trie);
+
+/**
+ * @brief Checks if a node is allocated and there is at least one live key in
+ * its subtrie. The removed keys are kept in the trie until the next sweep, so
+ * the searches should go only through the nodes that pass this check.
+ *
+ * @param node The node we want to check. It can be NULL.
+ * @return u8_t Returns an 8-bit unsigned integer, 1 if the subtrie of the node
+ * contains live keys, or 0 otherwise.
+ */
+u8_t has_live_keys(g_node_t *node);
 
 /**
  * @brief Checks if a trie contains a specific key. This functions is extra, in
@@ -111,35 +212,171 @@ u8_t has_key(g_node_t *root, char *key_ptr);
  */
 g_node_t *get_ending_node(g_node_t *root, char *key_ptr);
 
+/**
+ * @brief Gets the ending node of a key, from the root of a trie. A key of the
+ * frozen vocabulary is found from its id, without walking the trie, and the
+ * other keys are found by get_ending_node.
+ *
+ * @param trie The trie.
+ * @param key The key.
+ * @return g_node_t* The ending node of the key, or NULL if the trie doesn't
+ * contain it.
+ */
+g_node_t *find_key(g_tree_t *trie, char *key);
+
+/**
+ * @brief Looks up many keys at once. On a big trie, every level of a lookup
+ * is a cache miss that depends on the previous one, so the keys are walked
+ * in groups, one level at a time for the whole group: the next node of
+ * every key is prefetched before any of them is read, and the misses of the
+ * group overlap.
+ *
+ * @param root The root of the trie.
+ * @param keys The keys.
+ * @param keys_no The number of keys.
+ * @param group The number of keys walked together, up to LOOKUP_GROUP_MAX.
+ * @param prefix 0 to find the ending nodes of the keys, like
+ * get_ending_node, or 1 to find the ends of the prefixes with live keys
+ * below them, like get_end_of_prefix.
+ * @param ends Where to store the node found for every key, or NULL.
+ */
+void lookup_batch(g_node_t *root, char **keys, unsigned int keys_no,
+				  unsigned int group, u8_t prefix, g_node_t **ends);
+
 /**
  * @brief Remove the key that ends with the "end" node given as parameter. It
- * is guaranteed that end has the END state, and it is not NULL.
+ * is guaranteed that end has the END state, and it is not NULL. The nodes are
+ * freed right away, so it is the eager alternative to tombstone_key, and it
+ * must not be used for keys that are waiting for a sweep.
  *
+ * @param trie The trie, that counts the memory of the freed nodes.
  * @param end The node where the key we want to delete ends.
- * @param free_func The function that frees the data within a node.
  */
-void remove_key(g_node_t *end, void (*free_func)(void *));
+void remove_key(g_tree_t *trie, g_node_t *end);
+
+/**
+ * @brief Removes a key logically: the ending node becomes NOT_END, and the
+ * number of live keys is updated on the whole path, but no node is freed.
+ * The node is remembered in the tombs array of the trie, so the next sweep
+ * will reclaim the dead branch.
+ *
+ * @param trie The trie where the key is stored.
+ * @param end The ending node of the key. It is guaranteed that it has the END
+ * state.
+ * @return int Returns 0 on success, or -1 if there is no memory left to
+ * remember the node. In that case, the key is not removed.
+ */
+int tombstone_key(g_tree_t *trie, g_node_t *end);
 
 /**
  * @brief This functions solves the problem that the remove_key function has,
  * it discover the end of the key, and test if it is a valid node. If it's
- * NULL, it won't do anything, otherwise, it will call the function that
- * removes a key. Also, it updates the number of keys from the structure.
+ * NULL, it won't do anything, otherwise, it will tombstone the key. Once there
+ * are SWEEP_THRESHOLD tombstones, the dead branches are freed by a sweep.
  *
  * @param trie The trie where the key should be stored.
  * @param key The key that we want to remove.
+ * @return int Returns 0 on success (a missing key is not an error), or -1 if
+ * there is no memory left.
+ */
+int remove_and_update_trie(g_tree_t *trie, char *key);
+
+/**
+ * @brief Frees all the dead branches of the trie at once. Starting from every
+ * tombstone, it climbs to the highest node without live keys, detaches it
+ * from its parent, and frees the whole branch. It doesn't touch the live part
+ * of the trie.
+ *
+ * @param trie The trie we want to clean.
+ */
+void sweep_trie(g_tree_t *trie);
+
+/**
+ * @brief Picks a live key at random, every key with the same chance, without
+ * walking the whole trie.
+ *
+ * @param trie The trie.
+ * @return g_node_t* The ending node of the key, or NULL if the trie is empty.
+ */
+g_node_t *sample_key(g_tree_t *trie);
+
+/**
+ * @brief Picks the key to evict: the one with the lowest decayed score among
+ * EVICT_SAMPLES random keys. The scores are exact, only the victim is
+ * approximate, so its cost doesn't grow with the trie.
+ *
+ * @param trie The trie.
+ * @param protect A key that must not be picked, or NULL.
+ * @return g_node_t* The ending node of the victim, or NULL if there is none.
+ */
+g_node_t *pick_victim(g_tree_t *trie, g_node_t *protect);
+
+/**
+ * @brief Frees some memory: it sweeps the dead branches if there are any, or
+ * it removes a rarely used key right away otherwise. The evicted key is
+ * counted, remembered among the last EVICT_RECENT ones, and given to the
+ * evict_func of the trie.
+ *
+ * @param trie The trie.
+ * @param protect A key that must not be evicted, or NULL.
+ * @return int Returns 0 if something was freed, or -1 if there is nothing
+ * left to evict.
+ */
+int evict_key(g_tree_t *trie, g_node_t *protect);
+
+/**
+ * @brief Evicts keys until the memory of the trie is under its limit.
+ *
+ * @param trie The trie.
+ * @param protect A key that must not be evicted, or NULL.
+ */
+void enforce_budget(g_tree_t *trie, g_node_t *protect);
+
+/**
+ * @brief Reads the next token of a file, the characters between 2 blanks,
+ * and checks that it is a word: lowercase letters only, and shorter than
+ * MAX_BUFF. A longer token is read whole, not split into several words.
+ *
+ * @param file The file.
+ * @param buff Where to store the word, with room for MAX_BUFF characters.
+ * @return int Returns 1 for a word, 0 for a token that isn't a word, or EOF
+ * if there are no tokens left.
+ */
+int read_word(FILE *file, char *buff);
+
+/**
+ * @brief Removes all the words from a file, in a single pass over the trie.
+ * The words are sorted first, so every word continues from the common prefix
+ * with the previous one, instead of starting again from the root. The dead
+ * branches are swept once, at the end. What isn't a word is skipped.
+ *
+ * @param trie The trie where the words are stored.
+ * @param filename The name of the file with the words we want to remove.
+ * @return int Returns 0 on success, or -1 if the file can't be opened or
+ * there is no memory left, with errno set.
+ */
+int remove_batch_file(g_tree_t *trie, char *filename);
+
+/**
+ * @brief Compares 2 words, for qsort.
+ *
+ * @param a Pointer to the first word (char **).
+ * @param b Pointer to the second word (char **).
+ * @return int The result of strcmp.
  */
-void remove_and_update_trie(g_tree_t *trie, char *key);
+int compare_words(const void *a, const void *b);
 
 /**
- * @brief Loads all the words from a file into a trie. It is guaranteed that
- * the file is well-formated, containing just lowercase and delimiters such as
- * space, enter, dot, and so on.
+ * @brief Loads all the words from a file into a trie. The file may hold
+ * anything, what isn't a word is skipped.
  *
  * @param trie The trie where we want to store the words.
  * @param filename The name of the file we want to load.
+ * @return int Returns 0 on success, or -1 if the file can't be opened or
+ * there is no memory left, with errno set. The words read before the error
+ * stay in the trie.
  */
-void load_file(g_tree_t *trie, char *filename);
+int load_file(g_tree_t *trie, char *filename);
 
 /**
  * @brief Prints all the words stored in a trie, in lexicographic order. It is
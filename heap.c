@@ -0,0 +1,133 @@
+#include "heap.h"
+
+heap_t *create_heap(unsigned int cap)
+{
+	heap_t *heap = (heap_t *)malloc(sizeof(heap_t));
+	if (!heap)
+		return NULL;
+
+	/**
+	 * Keep at least one slot, so the array is always allocated. The size is
+	 * counted in size_t, a cap of UINT_MAX would wrap around in 32 bits.
+	 */
+	size_t slots = (size_t)cap + 1;
+	heap->entries = NULL;
+	if (slots <= SIZE_MAX / sizeof(h_entry_t))
+		heap->entries = (h_entry_t *)malloc(slots * sizeof(h_entry_t));
+	if (!heap->entries) {
+		free(heap);
+		return NULL;
+	}
+
+	heap->cap = cap;
+	heap->size = 0;
+	heap->seq = 0;
+
+	return heap;
+}
+
+u8_t heap_better(h_entry_t *a, h_entry_t *b)
+{
+	if (a->score != b->score)
+		return a->score > b->score;
+
+	return a->seq < b->seq;
+}
+
+void heap_swap(h_entry_t *a, h_entry_t *b)
+{
+	h_entry_t aux = *a;
+	*a = *b;
+	*b = aux;
+}
+
+void heap_sift_down(heap_t *heap, unsigned int idx)
+{
+	/**
+	 * The worst entry must be on top, so go down towards the worse child
+	 */
+	while (1) {
+		unsigned int worst = idx;
+		unsigned int left = 2 * idx + 1;
+		unsigned int right = 2 * idx + 2;
+
+		if (left < heap->size &&
+			heap_better(&heap->entries[worst], &heap->entries[left]))
+			worst = left;
+
+		if (right < heap->size &&
+			heap_better(&heap->entries[worst], &heap->entries[right]))
+			worst = right;
+
+		if (worst == idx)
+			return;
+
+		heap_swap(&heap->entries[idx], &heap->entries[worst]);
+		idx = worst;
+	}
+}
+
+void heap_offer(heap_t *heap, g_node_t *node, u64_t score)
+{
+	h_entry_t entry;
+	entry.node = node;
+	entry.score = score;
+	entry.seq = heap->seq;
+	heap->seq++;
+
+	if (heap->cap == 0)
+		return;
+
+	if (heap->size < heap->cap) {
+		/**
+		 * Go up while the parent is better than the new entry
+		 */
+		unsigned int idx = heap->size;
+		heap->entries[idx] = entry;
+		heap->size++;
+
+		while (idx > 0) {
+			unsigned int parent = (idx - 1) / 2;
+			if (!heap_better(&heap->entries[parent], &heap->entries[idx]))
+				break;
+
+			heap_swap(&heap->entries[parent], &heap->entries[idx]);
+			idx = parent;
+		}
+
+		return;
+	}
+
+	/**
+	 * The heap is full, so the new entry must beat the worst one
+	 */
+	if (!heap_better(&entry, &heap->entries[0]))
+		return;
+
+	heap->entries[0] = entry;
+	heap_sift_down(heap, 0);
+}
+
+unsigned int heap_drain(heap_t *heap, g_node_t **out)
+{
+	unsigned int count = heap->size;
+
+	/**
+	 * The worst entry is popped first, so fill the array from the end
+	 */
+	while (heap->size > 0) {
+		out[heap->size - 1] = heap->entries[0].node;
+
+		heap->size--;
+		heap->entries[0] = heap->entries[heap->size];
+		heap_sift_down(heap, 0);
+	}
+
+	return count;
+}
+
+void free_heap(heap_t *heap)
+{
+	free(heap->entries);
+	free(heap);
+}
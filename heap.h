@@ -0,0 +1,76 @@
+#ifndef HEAP_H_
+#define HEAP_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include "structs.h"
+#include "utils.h"
+
+/**
+ * @brief Creates a bounded heap, that keeps only the best cap nodes offered
+ * to it. The worst of them is always on top, so it can be replaced in
+ * O(log cap) when a better one comes.
+ *
+ * @param cap The maximum number of nodes kept by the heap.
+ * @return heap_t* The newly created, empty heap, or NULL if there is no
+ * memory left, or if cap entries don't fit in the address space.
+ */
+heap_t *create_heap(unsigned int cap);
+
+/**
+ * @brief Checks if an entry ranks better than another one. The one with the
+ * bigger score wins, and if the scores are equal, the one that was offered
+ * first wins.
+ *
+ * @param a The first entry.
+ * @param b The second entry.
+ * @return u8_t Returns 1 if a is better than b, or 0 otherwise.
+ */
+u8_t heap_better(h_entry_t *a, h_entry_t *b);
+
+/**
+ * @brief Swaps 2 entries of the heap.
+ *
+ * @param a The first entry.
+ * @param b The second entry.
+ */
+void heap_swap(h_entry_t *a, h_entry_t *b);
+
+/**
+ * @brief Moves an entry down, until both its children are better than it.
+ *
+ * @param heap The heap.
+ * @param idx The index of the entry we want to move.
+ */
+void heap_sift_down(heap_t *heap, unsigned int idx);
+
+/**
+ * @brief Offers a node to the heap. It is kept only if the heap is not full,
+ * or if it is better than the worst node in the heap.
+ *
+ * @param heap The heap.
+ * @param node The node we offer.
+ * @param score The score of the node.
+ */
+void heap_offer(heap_t *heap, g_node_t *node, u64_t score);
+
+/**
+ * @brief Empties the heap into an array, from the best node to the worst.
+ *
+ * @param heap The heap.
+ * @param out The array where the nodes are stored. It must have room for
+ * heap->size nodes.
+ * @return unsigned int The number of nodes stored in out.
+ */
+unsigned int heap_drain(heap_t *heap, g_node_t **out);
+
+/**
+ * @brief Frees a heap.
+ *
+ * @param heap The heap we want to free.
+ */
+void free_heap(heap_t *heap);
+
+#endif  // HEAP_H_
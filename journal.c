@@ -0,0 +1,469 @@
+#include "journal.h"
+
+u32_t checksum(u32_t hash, const void *data, size_t len)
+{
+	const u8_t *bytes = (const u8_t *)data;
+
+	for (size_t i = 0; i < len; i++) {
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+char *journal_path(const char *dir, const char *name)
+{
+	size_t len = strlen(dir) + strlen(name) + 2;
+	char *path = (char *)malloc(len);
+	if (!path)
+		return NULL;
+
+	snprintf(path, len, "%s/%s", dir, name);
+	return path;
+}
+
+int snapshot_write(FILE *file, const void *data, size_t len, u32_t *hash)
+{
+	*hash = checksum(*hash, data, len);
+
+	if (fwrite(data, 1, len, file) != len)
+		return -1;
+
+	return 0;
+}
+
+int snapshot_read(FILE *file, void *data, size_t len, u32_t *hash)
+{
+	if (fread(data, 1, len, file) != len)
+		return -1;
+
+	*hash = checksum(*hash, data, len);
+	return 0;
+}
+
+int save_subtrie(FILE *file, g_node_t *root, char *buff, size_t depth,
+				 u32_t *hash)
+{
+	key_t *data = (key_t *)root->data;
+
+	if (data->ending == END) {
+		u8_t len = depth;
+		u32_t epoch = data->epoch;
+
+		if (snapshot_write(file, &len, 1, hash) < 0 ||
+			snapshot_write(file, buff, len, hash) < 0 ||
+			snapshot_write(file, &data->freq, sizeof(u64_t), hash) < 0 ||
+			snapshot_write(file, &data->score, sizeof(u64_t), hash) < 0 ||
+			snapshot_write(file, &epoch, sizeof(u32_t), hash) < 0)
+			return -1;
+	}
+
+	for (unsigned int i = 0; i < ALPH; i++) {
+		if (!has_live_keys(root->children[i]))
+			continue;
+
+		buff[depth] = i + 'a';
+		if (save_subtrie(file, root->children[i], buff, depth + 1, hash) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+int save_snapshot(g_tree_t *trie, const char *dir, u64_t next_gen)
+{
+	char *tmp = journal_path(dir, "snapshot.tmp");
+	char *path = journal_path(dir, "snapshot");
+	if (!tmp || !path) {
+		free(tmp);
+		free(path);
+		errno = ENOMEM;
+		return -1;
+	}
+
+	int ret = -1;
+	FILE *file = fopen(tmp, "wb");
+	if (!file)
+		goto out;
+
+	u32_t hash = FNV_BASIS;
+	u32_t epoch = trie->epoch;
+	char buff[MAX_BUFF];
+
+	if (snapshot_write(file, J_SNAPSHOT_MAGIC, J_MAGIC_LEN, &hash) < 0 ||
+		snapshot_write(file, &next_gen, sizeof(u64_t), &hash) < 0 ||
+		snapshot_write(file, &epoch, sizeof(u32_t), &hash) < 0 ||
+		snapshot_write(file, &trie->decay_period, sizeof(u64_t), &hash) < 0 ||
+		snapshot_write(file, &trie->since_decay, sizeof(u64_t), &hash) < 0 ||
+		snapshot_write(file, &trie->keys_no, sizeof(u64_t), &hash) < 0 ||
+		save_subtrie(file, trie->root, buff, 0, &hash) < 0 ||
+		fwrite(&hash, sizeof(u32_t), 1, file) != 1 ||
+		fflush(file) != 0 || fsync(fileno(file)) < 0) {
+		fclose(file);
+		goto out;
+	}
+
+	if (fclose(file) != 0 || rename(tmp, path) < 0)
+		goto out;
+
+	/**
+	 * The rename is durable only when the directory is synced too
+	 */
+	int fd = open(dir, O_RDONLY);
+	if (fd < 0)
+		goto out;
+
+	ret = fsync(fd);
+	close(fd);
+
+out:
+	free(tmp);
+	free(path);
+	return ret;
+}
+
+int load_snapshot(g_tree_t *trie, const char *dir, u64_t *next_gen)
+{
+	char *path = journal_path(dir, "snapshot");
+	if (!path) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	FILE *file = fopen(path, "rb");
+	free(path);
+
+	/**
+	 * No checkpoint was made yet, everything is in the journal
+	 */
+	if (!file && errno == ENOENT) {
+		*next_gen = 0;
+		return 0;
+	}
+
+	if (!file)
+		return -1;
+
+	u32_t hash = FNV_BASIS, epoch, stored;
+	u64_t keys_no, freq, score;
+	char magic[J_MAGIC_LEN], buff[MAX_BUFF];
+	u8_t len;
+
+	if (snapshot_read(file, magic, J_MAGIC_LEN, &hash) < 0 ||
+		memcmp(magic, J_SNAPSHOT_MAGIC, J_MAGIC_LEN) != 0 ||
+		snapshot_read(file, next_gen, sizeof(u64_t), &hash) < 0 ||
+		snapshot_read(file, &epoch, sizeof(u32_t), &hash) < 0 ||
+		snapshot_read(file, &trie->decay_period, sizeof(u64_t), &hash) < 0 ||
+		snapshot_read(file, &trie->since_decay, sizeof(u64_t), &hash) < 0 ||
+		snapshot_read(file, &keys_no, sizeof(u64_t), &hash) < 0)
+		goto corrupt;
+
+	trie->epoch = epoch;
+
+	for (u64_t i = 0; i < keys_no; i++) {
+		if (snapshot_read(file, &len, 1, &hash) < 0 || len == 0 ||
+			len >= MAX_BUFF ||
+			snapshot_read(file, buff, len, &hash) < 0 ||
+			snapshot_read(file, &freq, sizeof(u64_t), &hash) < 0 ||
+			snapshot_read(file, &score, sizeof(u64_t), &hash) < 0 ||
+			snapshot_read(file, &epoch, sizeof(u32_t), &hash) < 0)
+			goto corrupt;
+
+		buff[len] = '\0';
+		if (restore_key(trie, buff, freq, score, epoch) < 0) {
+			fclose(file);
+			return -1;
+		}
+	}
+
+	if (fread(&stored, sizeof(u32_t), 1, file) != 1 || stored != hash)
+		goto corrupt;
+
+	fclose(file);
+	return 0;
+
+corrupt:
+	fclose(file);
+	errno = EINVAL;
+	return -1;
+}
+
+int apply_record(g_tree_t *trie, j_op_t op, u8_t *payload, u8_t len)
+{
+	char word[MAX_BUFF];
+
+	switch (op) {
+	case J_INSERT:
+	case J_REMOVE:
+		if (len == 0 || len >= MAX_BUFF)
+			break;
+
+		memcpy(word, payload, len);
+		word[len] = '\0';
+
+		if (op == J_INSERT)
+			return insert_and_update_trie(trie, word);
+
+		return remove_and_update_trie(trie, word);
+	case J_DECAY:
+		decay_trie(trie);
+		return 0;
+	case J_DECAY_PERIOD:
+		if (len != sizeof(u64_t))
+			break;
+
+		memcpy(&trie->decay_period, payload, sizeof(u64_t));
+		trie->since_decay = 0;
+		return 0;
+	}
+
+	errno = EINVAL;
+	return -1;
+}
+
+int replay_journal(journal_t *journal, g_tree_t *trie)
+{
+	off_t start = lseek(journal->fd, 0, SEEK_CUR);
+	off_t end = lseek(journal->fd, 0, SEEK_END);
+	if (start < 0 || end < 0 || lseek(journal->fd, start, SEEK_SET) < 0)
+		return -1;
+
+	size_t size = end - start;
+	u8_t *data = (u8_t *)malloc(size + 1);
+	if (!data)
+		return -1;
+
+	size_t got = 0;
+	while (got < size) {
+		ssize_t ret = read(journal->fd, data + got, size - got);
+		if (ret <= 0) {
+			free(data);
+			return -1;
+		}
+
+		got += ret;
+	}
+
+	size_t pos = 0;
+	journal->records = 0;
+
+	/**
+	 * Go while there is a whole record, with a matching checksum
+	 */
+	while (pos + 2 <= size) {
+		u8_t op = data[pos];
+		u8_t len = data[pos + 1];
+		u32_t stored;
+
+		if (pos + 2 + len + sizeof(u32_t) > size)
+			break;
+
+		memcpy(&stored, data + pos + 2 + len, sizeof(u32_t));
+		if (stored != checksum(FNV_BASIS, data + pos, 2 + len))
+			break;
+
+		if (apply_record(trie, (j_op_t)op, data + pos + 2, len) < 0) {
+			free(data);
+			return -1;
+		}
+
+		pos += 2 + len + sizeof(u32_t);
+		journal->records++;
+	}
+
+	free(data);
+
+	/**
+	 * Cut the torn tail, the next records go right after the valid ones
+	 */
+	if (pos < size && ftruncate(journal->fd, start + pos) < 0)
+		return -1;
+
+	if (lseek(journal->fd, start + pos, SEEK_SET) < 0)
+		return -1;
+
+	return 0;
+}
+
+int reset_journal(journal_t *journal, u64_t gen)
+{
+	u8_t header[J_MAGIC_LEN + sizeof(u64_t)];
+	memcpy(header, J_JOURNAL_MAGIC, J_MAGIC_LEN);
+	memcpy(header + J_MAGIC_LEN, &gen, sizeof(u64_t));
+
+	if (ftruncate(journal->fd, 0) < 0 ||
+		lseek(journal->fd, 0, SEEK_SET) < 0)
+		return -1;
+
+	if (write(journal->fd, header, sizeof(header)) != sizeof(header))
+		return -1;
+
+	if (fsync(journal->fd) < 0)
+		return -1;
+
+	journal->gen = gen;
+	journal->records = 0;
+
+	return 0;
+}
+
+journal_t *open_journal(g_tree_t *trie, const char *dir)
+{
+	journal_t *journal = (journal_t *)malloc(sizeof(journal_t));
+	if (!journal)
+		return NULL;
+
+	journal->dir = (char *)malloc(strlen(dir) + 1);
+	journal->buff = (u8_t *)malloc(J_GROUP * J_RECORD_MAX);
+	char *path = journal_path(dir, "journal");
+	if (!journal->dir || !journal->buff || !path) {
+		free(path);
+		goto fail;
+	}
+
+	strcpy(journal->dir, dir);
+	journal->buff_len = 0;
+	journal->pending = 0;
+	journal->records = 0;
+	journal->fd = -1;
+
+	u64_t next_gen;
+	if (load_snapshot(trie, dir, &next_gen) < 0) {
+		free(path);
+		goto fail;
+	}
+
+	journal->fd = open(path, O_RDWR | O_CREAT, 0644);
+	free(path);
+	if (journal->fd < 0)
+		goto fail;
+
+	u8_t header[J_MAGIC_LEN + sizeof(u64_t)];
+	ssize_t got = read(journal->fd, header, sizeof(header));
+	if (got < 0)
+		goto fail;
+
+	u64_t gen = 0;
+	if (got == sizeof(header))
+		memcpy(&gen, header + J_MAGIC_LEN, sizeof(u64_t));
+
+	if (got == sizeof(header) &&
+		memcmp(header, J_JOURNAL_MAGIC, J_MAGIC_LEN) != 0) {
+		errno = EINVAL;
+		goto fail;
+	}
+
+	/**
+	 * A missing or torn header means a new journal. An older generation
+	 * means the last checkpoint crashed before emptying the journal, and
+	 * everything in it is already in the snapshot.
+	 */
+	if (got < (ssize_t)sizeof(header) || gen < next_gen) {
+		if (reset_journal(journal, next_gen) < 0)
+			goto fail;
+	} else {
+		journal->gen = gen;
+		if (replay_journal(journal, trie) < 0)
+			goto fail;
+	}
+
+	return journal;
+
+fail:
+	if (journal->fd >= 0)
+		close(journal->fd);
+	free(journal->dir);
+	free(journal->buff);
+	free(journal);
+	return NULL;
+}
+
+int journal_append(journal_t *journal, j_op_t op, const void *payload,
+				   u8_t len)
+{
+	/**
+	 * The last group couldn't be written, so there is no room for another
+	 * record until it is
+	 */
+	if (journal->pending >= J_GROUP && journal_flush(journal) < 0)
+		return -1;
+
+	u8_t *record = journal->buff + journal->buff_len;
+
+	record[0] = op;
+	record[1] = len;
+	if (len > 0)
+		memcpy(record + 2, payload, len);
+
+	u32_t hash = checksum(FNV_BASIS, record, 2 + len);
+	memcpy(record + 2 + len, &hash, sizeof(u32_t));
+
+	journal->buff_len += 2 + len + sizeof(u32_t);
+	journal->pending++;
+	journal->records++;
+
+	if (journal->pending >= J_GROUP)
+		return journal_flush(journal);
+
+	return 0;
+}
+
+int journal_flush(journal_t *journal)
+{
+	size_t done = 0;
+
+	/**
+	 * The front-ends flush whenever they go idle, so nothing to sync is the
+	 * common case
+	 */
+	if (journal->pending == 0)
+		return 0;
+
+	while (done < journal->buff_len) {
+		ssize_t ret = write(journal->fd, journal->buff + done,
+							journal->buff_len - done);
+		if (ret < 0 && errno == EINTR)
+			continue;
+
+		if (ret < 0)
+			return -1;
+
+		done += ret;
+	}
+
+	journal->buff_len = 0;
+
+	/**
+	 * One sync for the whole group. The records stay pending until it
+	 * succeeds, so a failed sync is retried by the next flush.
+	 */
+	if (fsync(journal->fd) < 0)
+		return -1;
+
+	journal->pending = 0;
+	return 0;
+}
+
+int journal_checkpoint(journal_t *journal, g_tree_t *trie)
+{
+	if (journal_flush(journal) < 0)
+		return -1;
+
+	if (save_snapshot(trie, journal->dir, journal->gen + 1) < 0)
+		return -1;
+
+	return reset_journal(journal, journal->gen + 1);
+}
+
+int close_journal(journal_t *journal)
+{
+	int ret = journal_flush(journal);
+
+	close(journal->fd);
+	free(journal->dir);
+	free(journal->buff);
+	free(journal);
+
+	return ret;
+}
@@ -0,0 +1,196 @@
+#ifndef JOURNAL_H_
+#define JOURNAL_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "structs.h"
+#include "utils.h"
+#include "generic_tree.h"
+
+/**
+ * The journal directory holds 2 files. "snapshot" is a checkpoint of the
+ * whole trie, and "journal" has all the updates made after it. Both start
+ * with a magic string and a generation number: the snapshot remembers the
+ * generation of the journal that continues it, so a journal left behind by
+ * a checkpoint that crashed before truncating it is recognised and skipped.
+ *
+ * A journal record is: the operation (1 byte), the length of the payload
+ * (1 byte), the payload (the word, or a number for J_DECAY_PERIOD) and a
+ * checksum of all of them (4 bytes). The numbers are stored in the byte
+ * order of the machine.
+ */
+
+/**
+ * @brief Computes the FNV-1a hash of some bytes, starting from a previous
+ * hash, so it can be computed in pieces.
+ *
+ * @param hash The hash so far, or FNV_BASIS for the first piece.
+ * @param data The bytes.
+ * @param len The number of bytes.
+ * @return u32_t The new hash.
+ */
+u32_t checksum(u32_t hash, const void *data, size_t len);
+
+/**
+ * @brief Builds the path of a file from the journal directory.
+ *
+ * @param dir The directory.
+ * @param name The name of the file.
+ * @return char* The path, that must be freed, or NULL if there is no memory
+ * left.
+ */
+char *journal_path(const char *dir, const char *name);
+
+/**
+ * @brief Writes some bytes into a snapshot, and adds them to its checksum.
+ *
+ * @param file The snapshot.
+ * @param data The bytes.
+ * @param len The number of bytes.
+ * @param hash The checksum of the snapshot so far.
+ * @return int Returns 0 on success, or -1 on error.
+ */
+int snapshot_write(FILE *file, const void *data, size_t len, u32_t *hash);
+
+/**
+ * @brief Reads some bytes from a snapshot, and adds them to its checksum.
+ *
+ * @param file The snapshot.
+ * @param data Where to store the bytes.
+ * @param len The number of bytes.
+ * @param hash The checksum of the snapshot so far.
+ * @return int Returns 0 on success, or -1 if the file ended too early.
+ */
+int snapshot_read(FILE *file, void *data, size_t len, u32_t *hash);
+
+/**
+ * @brief Writes all the live keys of a subtrie into a snapshot, with their
+ * frequencies and scores, in lexicographic order.
+ *
+ * @param file The snapshot.
+ * @param root The root of the subtrie.
+ * @param buff A buffer with the letters on the path to root.
+ * @param depth The number of letters in buff.
+ * @param hash The checksum of the snapshot so far.
+ * @return int Returns 0 on success, or -1 on error.
+ */
+int save_subtrie(FILE *file, g_node_t *root, char *buff, size_t depth,
+				 u32_t *hash);
+
+/**
+ * @brief Writes a checkpoint of the whole trie. It is written into a
+ * temporary file, synced, and then renamed over the old snapshot, so a crash
+ * leaves either the old snapshot or the new one, never a part of one.
+ *
+ * @param trie The trie.
+ * @param dir The journal directory.
+ * @param next_gen The generation of the journal that continues the snapshot.
+ * @return int Returns 0 on success, or -1 with errno set.
+ */
+int save_snapshot(g_tree_t *trie, const char *dir, u64_t next_gen);
+
+/**
+ * @brief Loads the checkpoint of a journal directory into an empty trie.
+ *
+ * @param trie The trie.
+ * @param dir The journal directory.
+ * @param next_gen Where to store the generation of the journal that
+ * continues the snapshot, 0 if there is no snapshot yet.
+ * @return int Returns 0 on success (a missing snapshot is not an error), or
+ * -1 with errno set.
+ */
+int load_snapshot(g_tree_t *trie, const char *dir, u64_t *next_gen);
+
+/**
+ * @brief Applies a journal record to the trie.
+ *
+ * @param trie The trie.
+ * @param op The operation.
+ * @param payload The payload of the record.
+ * @param len The length of the payload.
+ * @return int Returns 0 on success, or -1 with errno set.
+ */
+int apply_record(g_tree_t *trie, j_op_t op, u8_t *payload, u8_t len);
+
+/**
+ * @brief Applies all the valid records of the journal file to the trie. It
+ * stops at the first record that is incomplete or doesn't match its
+ * checksum, which is what a crash in the middle of a write leaves behind,
+ * and cuts the file there, so the new records follow the valid ones.
+ *
+ * @param journal The journal, with the file positioned after the header.
+ * @param trie The trie.
+ * @return int Returns 0 on success, or -1 with errno set.
+ */
+int replay_journal(journal_t *journal, g_tree_t *trie);
+
+/**
+ * @brief Empties the journal file and starts a new generation.
+ *
+ * @param journal The journal.
+ * @param gen The new generation.
+ * @return int Returns 0 on success, or -1 with errno set.
+ */
+int reset_journal(journal_t *journal, u64_t gen);
+
+/**
+ * @brief Recovers a trie from a journal directory, and starts journaling its
+ * updates. The latest checkpoint is loaded first, and then only the journal
+ * written after it is replayed.
+ *
+ * @param trie An empty trie.
+ * @param dir The journal directory. It must exist.
+ * @return journal_t* The journal, or NULL with errno set.
+ */
+journal_t *open_journal(g_tree_t *trie, const char *dir);
+
+/**
+ * @brief Adds a record to the journal. The records wait in memory, and they
+ * are written and synced together once J_GROUP of them gather, or when
+ * journal_flush is called. A crash loses the records that wait, so the
+ * callers flush as soon as no more updates are coming.
+ *
+ * @param journal The journal.
+ * @param op The operation.
+ * @param payload The payload of the record.
+ * @param len The length of the payload.
+ * @return int Returns 0 on success, or -1 with errno set.
+ */
+int journal_append(journal_t *journal, j_op_t op, const void *payload,
+				   u8_t len);
+
+/**
+ * @brief Writes and syncs the records that are waiting for their group. It
+ * does nothing if none are waiting.
+ *
+ * @param journal The journal.
+ * @return int Returns 0 on success, or -1 with errno set.
+ */
+int journal_flush(journal_t *journal);
+
+/**
+ * @brief Writes a checkpoint of the trie and empties the journal, so the
+ * next recovery starts from here.
+ *
+ * @param journal The journal.
+ * @param trie The trie.
+ * @return int Returns 0 on success, or -1 with errno set.
+ */
+int journal_checkpoint(journal_t *journal, g_tree_t *trie);
+
+/**
+ * @brief Flushes the journal and frees it.
+ *
+ * @param journal The journal.
+ * @return int Returns 0 on success, or -1 if the last records couldn't be
+ * written. The journal is freed anyway.
+ */
+int close_journal(journal_t *journal);
+
+#endif  // JOURNAL_H_
@@ -0,0 +1,177 @@
+#include "kd_tree.h"
+
+kd_tree_t *create_kd_tree(kd_point_t *points, size_t n, unsigned int kdim)
+{
+	kd_tree_t *tree = (kd_tree_t *)malloc(sizeof(kd_tree_t));
+	kd_point_t *copy = (kd_point_t *)malloc((n + 1) * sizeof(kd_point_t));
+	if (!tree || !copy) {
+		free(tree);
+		free(copy);
+		return NULL;
+	}
+
+	memcpy(copy, points, n * sizeof(kd_point_t));
+	tree->kdim = kdim;
+	tree->nnodes = n;
+
+	u8_t ok = 1;
+	tree->root = kd_build(copy, n, 0, kdim, NULL, &ok);
+	free(copy);
+
+	if (!ok) {
+		free_kd_tree(tree);
+		return NULL;
+	}
+
+	return tree;
+}
+
+kd_node_t *kd_build(kd_point_t *points, size_t n, unsigned int depth,
+					unsigned int kdim, kd_node_t *parent, u8_t *ok)
+{
+	if (n == 0 || !*ok)
+		return NULL;
+
+	unsigned int axis = depth % kdim;
+	for (size_t i = 1; i < n; i++) {
+		kd_point_t point = points[i];
+		size_t j = i;
+		for (; j > 0 && points[j - 1].coords[axis] > point.coords[axis]; j--)
+			points[j] = points[j - 1];
+		points[j] = point;
+	}
+
+	kd_node_t *node = (kd_node_t *)malloc(sizeof(kd_node_t));
+	if (!node) {
+		*ok = 0;
+		return NULL;
+	}
+
+	node->data = malloc(sizeof(kd_point_t));
+	if (!node->data) {
+		free(node);
+		*ok = 0;
+		return NULL;
+	}
+
+	/**
+	 * The median splits the points, the smaller ones go to the left
+	 */
+	size_t median = n / 2;
+	memcpy(node->data, &points[median], sizeof(kd_point_t));
+	node->parent = parent;
+	node->left = kd_build(points, median, depth + 1, kdim, node, ok);
+	node->right = kd_build(points + median + 1, n - median - 1, depth + 1,
+						   kdim, node, ok);
+
+	return node;
+}
+
+double kd_distance(const double *a, const double *b, unsigned int kdim)
+{
+	double dist = 0;
+	for (unsigned int i = 0; i < kdim; i++)
+		dist += (a[i] - b[i]) * (a[i] - b[i]);
+
+	return dist;
+}
+
+void kd_nearest_node(kd_node_t *node, unsigned int depth, unsigned int kdim,
+					 const double *query, unsigned int k, kd_point_t **best,
+					 double *dists, unsigned int *found)
+{
+	if (!node)
+		return;
+
+	kd_point_t *point = (kd_point_t *)node->data;
+	double dist = kd_distance(point->coords, query, kdim);
+
+	/**
+	 * Keep the k nearest points sorted, by inserting the new one in place
+	 */
+	if (*found < k || dist < dists[*found - 1]) {
+		unsigned int i = *found < k ? *found : k - 1;
+		for (; i > 0 && dists[i - 1] > dist; i--) {
+			best[i] = best[i - 1];
+			dists[i] = dists[i - 1];
+		}
+
+		best[i] = point;
+		dists[i] = dist;
+		if (*found < k)
+			*found = *found + 1;
+	}
+
+	unsigned int axis = depth % kdim;
+	double diff = query[axis] - point->coords[axis];
+	kd_node_t *near = diff < 0 ? node->left : node->right;
+	kd_node_t *far = diff < 0 ? node->right : node->left;
+
+	kd_nearest_node(near, depth + 1, kdim, query, k, best, dists, found);
+	if (*found < k || diff * diff < dists[*found - 1])
+		kd_nearest_node(far, depth + 1, kdim, query, k, best, dists, found);
+}
+
+unsigned int kd_nearest(kd_tree_t *tree, const double *query, unsigned int k,
+						kd_point_t **best, double *dists)
+{
+	unsigned int found = 0;
+	if (k > 0)
+		kd_nearest_node(tree->root, 0, tree->kdim, query, k, best, dists,
+						&found);
+
+	return found;
+}
+
+void kd_radius_node(kd_node_t *node, unsigned int depth, unsigned int kdim,
+					const double *query, double radius, kd_point_t **out,
+					unsigned int max, unsigned int *found)
+{
+	if (!node || *found == max)
+		return;
+
+	kd_point_t *point = (kd_point_t *)node->data;
+	if (kd_distance(point->coords, query, kdim) <= radius * radius) {
+		out[*found] = point;
+		*found = *found + 1;
+	}
+
+	/**
+	 * A side of the split is searched only if the ball reaches it
+	 */
+	unsigned int axis = depth % kdim;
+	double diff = query[axis] - point->coords[axis];
+	if (diff <= radius)
+		kd_radius_node(node->left, depth + 1, kdim, query, radius, out, max,
+					   found);
+	if (diff >= -radius)
+		kd_radius_node(node->right, depth + 1, kdim, query, radius, out, max,
+					   found);
+}
+
+unsigned int kd_radius(kd_tree_t *tree, const double *query, double radius,
+					   kd_point_t **out, unsigned int max)
+{
+	unsigned int found = 0;
+	kd_radius_node(tree->root, 0, tree->kdim, query, radius, out, max,
+				   &found);
+
+	return found;
+}
+
+void free_kd_node(kd_node_t *node)
+{
+	if (!node)
+		return;
+
+	free_kd_node(node->left);
+	free_kd_node(node->right);
+	free(node->data);
+	free(node);
+}
+
+void free_kd_tree(kd_tree_t *tree)
+{
+	free_kd_node(tree->root);
+	free(tree);
+}
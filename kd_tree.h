@@ -0,0 +1,122 @@
+#ifndef KD_TREE_H_
+#define KD_TREE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "structs.h"
+#include "utils.h"
+
+/**
+ * @brief Creates a balanced k-d tree, from a set of points. The points are
+ * copied, so the caller keeps its array.
+ *
+ * @param points The points.
+ * @param n The number of points.
+ * @param kdim The number of coordinates of a point, at most KD_MAX_DIM.
+ * @return kd_tree_t* The tree, or NULL if there is no memory left.
+ */
+kd_tree_t *create_kd_tree(kd_point_t *points, size_t n, unsigned int kdim);
+
+/**
+ * @brief Builds the subtree of a set of points, split on the median of the
+ * coordinate given by the depth. The points are sorted by insertion, because
+ * a keyboard has only a few of them.
+ *
+ * @param points The points, reordered in place.
+ * @param n The number of points.
+ * @param depth The depth of the subtree.
+ * @param kdim The number of coordinates of a point.
+ * @param parent The parent of the subtree.
+ * @param ok Set to 0 if there is no memory left.
+ * @return kd_node_t* The root of the subtree, or NULL if there are no points.
+ */
+kd_node_t *kd_build(kd_point_t *points, size_t n, unsigned int depth,
+					unsigned int kdim, kd_node_t *parent, u8_t *ok);
+
+/**
+ * @brief Computes the squared distance between 2 points.
+ *
+ * @param a The coordinates of the first point.
+ * @param b The coordinates of the second point.
+ * @param kdim The number of coordinates.
+ * @return double The squared distance.
+ */
+double kd_distance(const double *a, const double *b, unsigned int kdim);
+
+/**
+ * @brief Searches a subtree for the k points nearest to a query. The other
+ * side of a split is searched only if it can hold a nearer point than the
+ * k-th one found so far.
+ *
+ * @param node The root of the subtree.
+ * @param depth The depth of the subtree.
+ * @param kdim The number of coordinates of a point.
+ * @param query The coordinates of the query.
+ * @param k The number of points wanted.
+ * @param best The points found so far, from the nearest one.
+ * @param dists Their squared distances.
+ * @param found The number of points found so far.
+ */
+void kd_nearest_node(kd_node_t *node, unsigned int depth, unsigned int kdim,
+					 const double *query, unsigned int k, kd_point_t **best,
+					 double *dists, unsigned int *found);
+
+/**
+ * @brief Finds the k points nearest to a query.
+ *
+ * @param tree The tree.
+ * @param query The coordinates of the query.
+ * @param k The number of points wanted.
+ * @param best Where to store the points, from the nearest one.
+ * @param dists Where to store their squared distances.
+ * @return unsigned int The number of points found, at most k.
+ */
+unsigned int kd_nearest(kd_tree_t *tree, const double *query, unsigned int k,
+						kd_point_t **best, double *dists);
+
+/**
+ * @brief Searches a subtree for the points within a distance of a query.
+ *
+ * @param node The root of the subtree.
+ * @param depth The depth of the subtree.
+ * @param kdim The number of coordinates of a point.
+ * @param query The coordinates of the query.
+ * @param radius The distance.
+ * @param out The points found so far.
+ * @param max The room in out.
+ * @param found The number of points found so far.
+ */
+void kd_radius_node(kd_node_t *node, unsigned int depth, unsigned int kdim,
+					const double *query, double radius, kd_point_t **out,
+					unsigned int max, unsigned int *found);
+
+/**
+ * @brief Finds the points within a distance of a query.
+ *
+ * @param tree The tree.
+ * @param query The coordinates of the query.
+ * @param radius The distance.
+ * @param out Where to store the points, in no particular order.
+ * @param max The room in out.
+ * @return unsigned int The number of points found, at most max.
+ */
+unsigned int kd_radius(kd_tree_t *tree, const double *query, double radius,
+					   kd_point_t **out, unsigned int max);
+
+/**
+ * @brief Frees the nodes of a subtree.
+ *
+ * @param node The root of the subtree.
+ */
+void free_kd_node(kd_node_t *node);
+
+/**
+ * @brief Frees a k-d tree.
+ *
+ * @param tree The tree.
+ */
+void free_kd_tree(kd_tree_t *tree);
+
+#endif  // KD_TREE_H_
@@ -0,0 +1,1871 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "libmk.h"
+#include "structs.h"
+#include "utils.h"
+#include "generic_tree.h"
+#include "magic_keyboard.h"
+#include "par_search.h"
+#include "journal.h"
+#include "vtrie.h"
+#include "swipe.h"
+#include "tier.h"
+#include "overlay.h"
+#include "pattern.h"
+#include "suffix.h"
+#include "word_ids.h"
+#include "cursor.h"
+#include "bigram.h"
+#include "planner.h"
+
+/**
+ * The handle is known only here, the users of the library see just its name
+ */
+struct mk_trie_t {
+	g_tree_t *trie; // the dictionary
+	pool_t *pool; // the workers of the wide searches
+	journal_t *journal; // the journal of the updates, or NULL
+	pthread_rwlock_t lock; // updates are writers, queries are readers
+	v_trie_t *vtrie; // the versions read by AUTOCORRECT, or NULL
+	u8_t stale; // 1 if the last version misses some updates
+	kd_tree_t *keyboard; // the key centres, for decoding the swipes
+	mk_err_t evict_err; // the first error of the evictions of an update
+	t_dict_t *tiers; // the tiered dictionary that replaces trie, or NULL
+	pthread_t merger; // the thread of the last merge of the tiers
+	u8_t merging; // 1 while a merge is running
+	u8_t merger_joinable; // 1 if merger has to be joined
+	o_table_t *users; // the overlays of the users, or NULL before the first
+	sx_index_t *index; // the suffix index, or NULL
+	u8_t index_stale; // 1 if the index misses some updates
+	u8_t frozen; // 1 if the vocabulary is frozen again after every LOAD
+	b_model_t *bigrams; // the bigrams over the frozen ids, or NULL
+	pthread_t loader; // the thread of the last background load
+	FILE *load_file; // the file of the background load
+	u8_t loading; // 1 while a background load is running
+	u8_t loader_joinable; // 1 if loader has to be joined
+	u8_t load_stop; // 1 if the background load has to stop early
+	u8_t load_started; // 1 once a background load was started
+	u64_t load_words; // the words published by the background load
+	u64_t load_bytes; // the bytes of its file read so far
+	u64_t load_size; // the size of its file, 0 if unknown
+	struct timespec load_start; // when it started
+	struct timespec load_end; // when it ended
+	mk_err_t load_err; // its first error
+	u64_t plan_runs[Q_STRATEGIES]; // the AUTOCOMPLETE searches, by strategy
+	u64_t plan_visited[Q_STRATEGIES]; // the nodes they visited
+};
+
+/**
+ * @brief Checks a word given by the caller, and copies it, because the engine
+ * works with writable strings.
+ *
+ * @param word The word of the caller.
+ * @param copy A buffer with room for MK_WORD_MAX characters.
+ * @return int Returns 0 if the word is valid, or -1 otherwise.
+ */
+static int copy_word(const char *word, char *copy)
+{
+	if (!word || word[0] == '\0')
+		return -1;
+
+	size_t i;
+	for (i = 0; word[i] != '\0'; i++) {
+		if (i + 1 >= MK_WORD_MAX || word[i] < 'a' || word[i] > 'z')
+			return -1;
+
+		copy[i] = word[i];
+	}
+
+	copy[i] = '\0';
+	return 0;
+}
+
+/**
+ * @brief Appends a word and a '\n' to the caller's buffer, if they fit.
+ *
+ * @param word The word.
+ * @param buff The caller's buffer.
+ * @param len The size of the buffer.
+ * @param used The bytes of the words appended so far, fitting or not.
+ * @param err Set to MK_ERANGE if the word doesn't fit.
+ */
+static void put_word(char *word, char *buff, size_t len, size_t *used,
+					 mk_err_t *err)
+{
+	size_t word_len = strlen(word);
+
+	/**
+	 * Keep counting after the buffer is full, to tell the caller how
+	 * much it needs
+	 */
+	if (*used + word_len + 2 <= len) {
+		memcpy(buff + *used, word, word_len);
+		buff[*used + word_len] = '\n';
+	} else {
+		*err = MK_ERANGE;
+	}
+
+	*used += word_len + 1;
+}
+
+/**
+ * @brief Ends the list of words in the caller's buffer.
+ *
+ * @param buff The caller's buffer.
+ * @param len The size of the buffer.
+ * @param used The bytes of the words, fitting or not.
+ * @param needed Where to store the size the words need, '\0' included, or
+ * NULL.
+ * @param err MK_OK if all the words fit, MK_ERANGE otherwise.
+ * @return mk_err_t err.
+ */
+static mk_err_t end_words(char *buff, size_t len, size_t used,
+						  size_t *needed, mk_err_t err)
+{
+	if (err == MK_OK && len > used)
+		buff[used] = '\0';
+	else if (len > 0)
+		buff[0] = '\0';
+
+	if (needed)
+		*needed = used + 1;
+
+	return err;
+}
+
+/**
+ * @brief Writes the words that end in some nodes into the caller's buffer,
+ * each one followed by '\n'.
+ *
+ * @param nodes The ending nodes of the words.
+ * @param count The number of nodes.
+ * @param buff The caller's buffer.
+ * @param len The size of the buffer.
+ * @param needed Where to store the size the words need, '\0' included, or
+ * NULL.
+ * @return mk_err_t MK_OK or MK_ERANGE.
+ */
+static mk_err_t put_words(g_node_t **nodes, unsigned int count, char *buff,
+						  size_t len, size_t *needed)
+{
+	char word[MAX_BUFF];
+	size_t used = 0;
+	mk_err_t err = MK_OK;
+
+	for (unsigned int i = 0; i < count; i++) {
+		get_word_from_end(nodes[i], word);
+		put_word(word, buff, len, &used, &err);
+	}
+
+	return end_words(buff, len, used, needed, err);
+}
+
+/**
+ * @brief Writes an update into the journal, if the dictionary has one, and
+ * makes a checkpoint once the journal has J_CHECKPOINT_EVERY records. It is
+ * called with the writer lock held, after the update was made.
+ *
+ * @param trie The handle of the dictionary.
+ * @param op The operation.
+ * @param payload The payload of the record.
+ * @param len The length of the payload.
+ * @return mk_err_t MK_OK or MK_EIO.
+ */
+static mk_err_t log_update(mk_trie_t *trie, j_op_t op, const void *payload,
+						   u8_t len)
+{
+	if (!trie->journal)
+		return MK_OK;
+
+	if (journal_append(trie->journal, op, payload, len) < 0)
+		return MK_EIO;
+
+	if (trie->journal->records >= J_CHECKPOINT_EVERY &&
+		journal_checkpoint(trie->journal, trie->trie) < 0)
+		return MK_EIO;
+
+	return MK_OK;
+}
+
+/**
+ * @brief Journals an update made from a file, like LOAD and REMOVE_BATCH, if
+ * the dictionary has a journal. The file can change later, so it can't be
+ * replayed from the journal: a checkpoint records its effect instead, even
+ * when only a part of the file was applied. It is called with the writer
+ * lock held, after the update was made.
+ *
+ * @param trie The handle of the dictionary.
+ * @return int Returns 0 on success, or -1 if the checkpoint failed.
+ */
+static int log_file_update(mk_trie_t *trie)
+{
+	if (trie->journal && journal_checkpoint(trie->journal, trie->trie) < 0)
+		return -1;
+
+	return 0;
+}
+
+/**
+ * @brief Brings the suffix index up to date with the dictionary, after an
+ * update of a word. It is called with the writer lock held. If the index
+ * can't be updated, the suffix queries fail, until a later update manages
+ * to rebuild it.
+ *
+ * @param trie The handle of the dictionary.
+ * @param word The updated word, or NULL after a bulk update.
+ * @return mk_err_t MK_OK or MK_ENOMEM.
+ */
+static mk_err_t update_index(mk_trie_t *trie, char *word)
+{
+	if (!trie->index)
+		return MK_OK;
+
+	int ret = 0;
+	if (!word || trie->index_stale)
+		ret = sx_rebuild(trie->index, trie->trie);
+	else if (find_key(trie->trie, word))
+		ret = sx_add_word(trie->index, word);
+	else
+		sx_remove_word(trie->index, word);
+
+	trie->index_stale = ret < 0;
+
+	return ret < 0 ? MK_ENOMEM : MK_OK;
+}
+
+/**
+ * @brief Freezes the vocabulary of the dictionary again, so the words added
+ * since the last freeze get ids too. It is called with the writer lock held.
+ * If the ids can't be built, the words are walked in the trie, until the
+ * next freeze, and the bigrams are dropped.
+ *
+ * @param trie The handle of the dictionary.
+ * @return mk_err_t MK_OK or MK_ENOMEM.
+ */
+static mk_err_t freeze_words(mk_trie_t *trie)
+{
+	w_index_t *old = trie->trie->ids;
+	if (old)
+		w_unlink(old);
+
+	trie->trie->ids = build_word_ids(trie->trie);
+	mk_err_t err = trie->trie->ids ? MK_OK : MK_ENOMEM;
+
+	/**
+	 * The old ids are still readable, so the bigrams can follow their words
+	 * to the new ones
+	 */
+	if (trie->bigrams) {
+		b_model_t *moved = NULL;
+		if (trie->trie->ids)
+			moved = remap_bigrams(trie->bigrams, old, trie->trie->ids);
+
+		free_bigrams(trie->bigrams);
+		trie->bigrams = moved;
+		if (!moved)
+			err = MK_ENOMEM;
+	}
+
+	free_word_ids(old);
+	return err;
+}
+
+/**
+ * @brief Brings the versions and the suffix index up to date with the
+ * dictionary, after an update of a word. It is called with the writer lock
+ * held. If a version can't be published, the readers use the dictionary
+ * under the lock, until a later update manages to copy the whole dictionary.
+ *
+ * @param trie The handle of the dictionary.
+ * @param word The updated word, or NULL after a bulk update.
+ * @return mk_err_t MK_OK or MK_ENOMEM.
+ */
+static mk_err_t publish_update(mk_trie_t *trie, char *word)
+{
+	mk_err_t err = update_index(trie, word);
+	if (!trie->vtrie)
+		return err;
+
+	int ret;
+	if (!word || trie->stale) {
+		ret = vtrie_rebuild(trie->vtrie, trie->trie);
+	} else {
+		g_node_t *end = find_key(trie->trie, word);
+		if (end)
+			ret = vtrie_insert(trie->vtrie, word, ((key_t *)end->data)->freq);
+		else
+			ret = vtrie_remove(trie->vtrie, word);
+	}
+
+	__atomic_store_n(&trie->stale, ret < 0, __ATOMIC_RELEASE);
+
+	return ret < 0 ? MK_ENOMEM : err;
+}
+
+/**
+ * @brief Keeps the versions and the journal in step with the dictionary,
+ * when a key is evicted in the middle of an update. The record is appended
+ * without the checkpoint check, because the update that evicts the key
+ * isn't journaled yet. It is called with the writer lock held.
+ *
+ * @param arg The handle of the dictionary.
+ * @param key The evicted key.
+ */
+static void on_evict(void *arg, char *key)
+{
+	mk_trie_t *trie = (mk_trie_t *)arg;
+
+	mk_err_t err = publish_update(trie, key);
+	if (err == MK_OK && trie->journal &&
+		journal_append(trie->journal, J_REMOVE, key, strlen(key)) < 0)
+		err = MK_EIO;
+
+	if (trie->evict_err == MK_OK)
+		trie->evict_err = err;
+}
+
+/**
+ * @brief Merges the base of the tiers with the frozen delta, in the
+ * background. Nothing writes them until the new base is installed, so they
+ * are read without the lock, and only the installation waits for it.
+ *
+ * @param arg The handle of the dictionary.
+ * @return void* NULL.
+ */
+static void *merge_tiers(void *arg)
+{
+	mk_trie_t *trie = (mk_trie_t *)arg;
+	t_dict_t *dict = trie->tiers;
+
+	c_trie_t *base = build_base(dict->base, dict->deltas, 1);
+
+	/**
+	 * If there is no memory left, the frozen delta stays, and the next
+	 * update tries again
+	 */
+	pthread_rwlock_wrlock(&trie->lock);
+	if (base)
+		install_base(dict, base);
+	trie->merging = 0;
+	pthread_rwlock_unlock(&trie->lock);
+
+	return NULL;
+}
+
+/**
+ * @brief Starts a merge of the tiers, if the newest delta is big enough and
+ * no merge is running. It is called with the writer lock held.
+ *
+ * @param trie The handle of the dictionary.
+ */
+static void start_merge(mk_trie_t *trie)
+{
+	if (trie->merging || !tiers_need_merge(trie->tiers))
+		return;
+
+	/**
+	 * The last merge is over, its thread just has to be joined
+	 */
+	if (trie->merger_joinable) {
+		pthread_join(trie->merger, NULL);
+		trie->merger_joinable = 0;
+	}
+
+	if (trie->tiers->deltas_no == 1 && push_delta(trie->tiers) < 0)
+		return;
+
+	trie->merging = 1;
+	if (pthread_create(&trie->merger, NULL, merge_tiers, trie) != 0) {
+		trie->merging = 0;
+		return;
+	}
+
+	trie->merger_joinable = 1;
+}
+
+/**
+ * @brief Completes a prefix in a tiered dictionary, like mk_autocomplete. It
+ * is called with the reader lock held.
+ *
+ * @param dict The tiered dictionary.
+ * @param prefix The prefix.
+ * @param mode The mode, from 0 to 3.
+ * @param buff The caller's buffer.
+ * @param len The size of the buffer.
+ * @return mk_err_t MK_OK, MK_ENOTFOUND or MK_ERANGE.
+ */
+static mk_err_t tiers_autocomplete(t_dict_t *dict, char *prefix,
+								   unsigned int mode, char *buff, size_t len)
+{
+	t_pos_t pos;
+	if (!tier_end_of_prefix(dict, prefix, &pos)) {
+		if (len > 0)
+			buff[0] = '\0';
+
+		return MK_ENOTFOUND;
+	}
+
+	char word[MAX_BUFF], shortest[MAX_BUFF], frequent[MAX_BUFF];
+	size_t prefix_len = strlen(prefix);
+	size_t used = 0;
+	mk_err_t err = MK_OK;
+
+	if (mode == 0 || mode == 1) {
+		strcpy(word, prefix);
+		t_first_word(dict->base, &pos, word, prefix_len);
+		put_word(word, buff, len, &used, &err);
+	}
+
+	/**
+	 * Like in a single trie, only the words compete, so the most frequent
+	 * one starts empty
+	 */
+	if (mode != 1) {
+		size_t shortest_len = INF;
+		u64_t max_score = 0;
+		strcpy(word, prefix);
+		strcpy(shortest, prefix);
+		frequent[0] = '\0';
+		t_best_words(dict->base, &pos, word, prefix_len, dict->epoch,
+					 shortest, &shortest_len, frequent, &max_score);
+
+		if (mode == 0 || mode == 2)
+			put_word(shortest, buff, len, &used, &err);
+
+		if (mode == 0 || mode == 3)
+			put_word(frequent, buff, len, &used, &err);
+	}
+
+	return end_words(buff, len, used, NULL, err);
+}
+
+/**
+ * @brief Inserts a word, or counts one more use of it, like mk_insert. It is
+ * called with the writer lock held.
+ *
+ * @param trie The handle of the dictionary.
+ * @param word The word, already checked.
+ * @return mk_err_t MK_OK, MK_ENOMEM or MK_EIO.
+ */
+static mk_err_t insert_word(mk_trie_t *trie, char *word)
+{
+	mk_err_t err = MK_ENOMEM;
+
+	trie->evict_err = MK_OK;
+	if (trie->tiers) {
+		if (tier_insert(trie->tiers, word) == 0)
+			err = MK_OK;
+		start_merge(trie);
+	} else if (insert_and_update_trie(trie->trie, word) == 0) {
+		err = publish_update(trie, word);
+		if (err == MK_OK)
+			err = log_update(trie, J_INSERT, word, strlen(word));
+		if (err == MK_OK)
+			err = trie->evict_err;
+	}
+
+	return err;
+}
+
+/**
+ * @brief Loads a file in the background. The words are read in chunks of
+ * LOAD_CHUNK without the lock, and every chunk is inserted under the writer
+ * lock, so the queries are answered between the chunks, with the words
+ * published so far. The words go through the path of mk_insert, so they are
+ * journaled and they reach the versions and the suffix index one by one.
+ *
+ * @param arg The handle of the dictionary.
+ * @return void* NULL.
+ */
+static void *load_in_background(void *arg)
+{
+	mk_trie_t *trie = (mk_trie_t *)arg;
+	char *words = (char *)malloc(LOAD_CHUNK * MAX_BUFF);
+	mk_err_t err = words ? MK_OK : MK_ENOMEM;
+	unsigned int words_no = 0;
+
+	while (err == MK_OK && !__atomic_load_n(&trie->load_stop,
+											__ATOMIC_ACQUIRE)) {
+		/**
+		 * The file may hold anything, so what isn't a word is skipped
+		 */
+		int read = 0;
+		words_no = 0;
+		while (words_no < LOAD_CHUNK &&
+			   (read = read_word(trie->load_file,
+								 words + (size_t)words_no * MAX_BUFF)) != EOF)
+			words_no += read;
+
+		long bytes = ftell(trie->load_file);
+		if (words_no == 0)
+			break;
+
+		pthread_rwlock_wrlock(&trie->lock);
+		for (unsigned int i = 0; i < words_no && err == MK_OK; i++) {
+			err = insert_word(trie, words + (size_t)i * MAX_BUFF);
+			if (err == MK_OK)
+				trie->load_words++;
+		}
+
+		if (bytes >= 0)
+			trie->load_bytes = bytes;
+		pthread_rwlock_unlock(&trie->lock);
+	}
+
+	if (err == MK_OK && ferror(trie->load_file))
+		err = MK_EIO;
+
+	free(words);
+	fclose(trie->load_file);
+
+	pthread_rwlock_wrlock(&trie->lock);
+	if (err == MK_OK && trie->frozen && !trie->tiers)
+		err = freeze_words(trie);
+
+	/**
+	 * The last words may not fill a group, and no command may come to sync
+	 * them
+	 */
+	if (err == MK_OK && trie->journal && journal_flush(trie->journal) < 0)
+		err = MK_EIO;
+
+	trie->load_err = err;
+	trie->loading = 0;
+	clock_gettime(CLOCK_MONOTONIC, &trie->load_end);
+	pthread_rwlock_unlock(&trie->lock);
+
+	return NULL;
+}
+
+mk_err_t mk_create(mk_trie_t **trie, unsigned int threads_no)
+{
+	mk_trie_t *handle = (mk_trie_t *)malloc(sizeof(mk_trie_t));
+	if (!handle)
+		return MK_ENOMEM;
+
+	handle->trie = create_generic_tree(sizeof(key_t), free_tnode);
+	if (!handle->trie) {
+		free(handle);
+		return MK_ENOMEM;
+	}
+
+	if (init_trie(handle->trie) < 0) {
+		free(handle->trie);
+		free(handle);
+		return MK_ENOMEM;
+	}
+
+	handle->pool = create_pool(threads_no);
+	handle->keyboard = create_keyboard();
+	if (!handle->pool || !handle->keyboard) {
+		if (handle->pool)
+			free_pool(handle->pool);
+		if (handle->keyboard)
+			free_kd_tree(handle->keyboard);
+
+		free_trie(handle->trie->root, handle->trie->free_func);
+		free(handle->trie);
+		free(handle);
+		return MK_ENOMEM;
+	}
+
+	pthread_rwlock_init(&handle->lock, NULL);
+	handle->journal = NULL;
+	handle->vtrie = NULL;
+	handle->stale = 0;
+	handle->evict_err = MK_OK;
+	handle->tiers = NULL;
+	handle->merging = 0;
+	handle->merger_joinable = 0;
+	handle->users = NULL;
+	handle->index = NULL;
+	handle->index_stale = 0;
+	handle->frozen = 0;
+	handle->bigrams = NULL;
+	memset(handle->plan_runs, 0, sizeof(handle->plan_runs));
+	memset(handle->plan_visited, 0, sizeof(handle->plan_visited));
+	handle->loading = 0;
+	handle->loader_joinable = 0;
+	handle->load_stop = 0;
+	handle->load_started = 0;
+	handle->trie->evict_func = on_evict;
+	handle->trie->evict_arg = handle;
+
+	*trie = handle;
+	return MK_OK;
+}
+
+void mk_destroy(mk_trie_t *trie)
+{
+	if (!trie)
+		return;
+
+	/**
+	 * The load goes on until its current chunk is inserted
+	 */
+	if (trie->loader_joinable) {
+		__atomic_store_n(&trie->load_stop, 1, __ATOMIC_RELEASE);
+		pthread_join(trie->loader, NULL);
+	}
+
+	if (trie->journal)
+		close_journal(trie->journal);
+
+	if (trie->merger_joinable)
+		pthread_join(trie->merger, NULL);
+
+	if (trie->tiers)
+		free_tiers(trie->tiers);
+
+	free_overlays(trie->users);
+	free_suffix_index(trie->index);
+	free_bigrams(trie->bigrams);
+	free_word_ids(trie->trie->ids);
+
+	free_trie(trie->trie->root, trie->trie->free_func);
+	free(trie->trie->tombs);
+	free(trie->trie);
+
+	if (trie->vtrie)
+		free_vtrie(trie->vtrie);
+
+	free_kd_tree(trie->keyboard);
+	free_pool(trie->pool);
+	pthread_rwlock_destroy(&trie->lock);
+	free(trie);
+}
+
+mk_err_t mk_insert(mk_trie_t *trie, const char *word)
+{
+	char copy[MK_WORD_MAX];
+	if (copy_word(word, copy) < 0)
+		return MK_EINVAL;
+
+	pthread_rwlock_wrlock(&trie->lock);
+	mk_err_t err = insert_word(trie, copy);
+	pthread_rwlock_unlock(&trie->lock);
+
+	return err;
+}
+
+mk_err_t mk_remove(mk_trie_t *trie, const char *word)
+{
+	char copy[MK_WORD_MAX];
+	if (copy_word(word, copy) < 0)
+		return MK_EINVAL;
+
+	mk_err_t err = MK_ENOMEM;
+
+	pthread_rwlock_wrlock(&trie->lock);
+	if (trie->tiers) {
+		if (tier_remove(trie->tiers, copy) == 0)
+			err = MK_OK;
+		start_merge(trie);
+	} else if (remove_and_update_trie(trie->trie, copy) == 0) {
+		err = publish_update(trie, copy);
+		if (err == MK_OK)
+			err = log_update(trie, J_REMOVE, copy, strlen(copy));
+	}
+	pthread_rwlock_unlock(&trie->lock);
+
+	return err;
+}
+
+mk_err_t mk_load(mk_trie_t *trie, const char *filename)
+{
+	pthread_rwlock_wrlock(&trie->lock);
+	errno = 0;
+	int ret;
+	if (trie->tiers) {
+		ret = tier_apply_file(trie->tiers, (char *)filename, 0);
+		start_merge(trie);
+	} else {
+		ret = load_file(trie->trie, (char *)filename);
+	}
+	int err = errno;
+
+	if (trie->frozen && freeze_words(trie) != MK_OK && ret == 0) {
+		ret = -1;
+		err = ENOMEM;
+	}
+
+	if (publish_update(trie, NULL) != MK_OK && ret == 0) {
+		ret = -1;
+		err = ENOMEM;
+	}
+
+	if (log_file_update(trie) < 0)
+		ret = err = -1;
+	pthread_rwlock_unlock(&trie->lock);
+
+	if (ret == 0)
+		return MK_OK;
+
+	return err == ENOMEM ? MK_ENOMEM : MK_EIO;
+}
+
+mk_err_t mk_load_async(mk_trie_t *trie, const char *filename)
+{
+	FILE *file = fopen(filename, "rt");
+	if (!file)
+		return MK_EIO;
+
+	/**
+	 * The size is only for the progress, a file without one loads the same
+	 */
+	long size = -1;
+	if (fseek(file, 0, SEEK_END) == 0)
+		size = ftell(file);
+	rewind(file);
+
+	pthread_rwlock_wrlock(&trie->lock);
+	if (trie->loading) {
+		pthread_rwlock_unlock(&trie->lock);
+		fclose(file);
+		return MK_EINVAL;
+	}
+
+	/**
+	 * The last load is over, its thread just has to be joined
+	 */
+	if (trie->loader_joinable) {
+		pthread_join(trie->loader, NULL);
+		trie->loader_joinable = 0;
+	}
+
+	trie->load_file = file;
+	trie->load_stop = 0;
+	trie->load_started = 1;
+	trie->load_words = 0;
+	trie->load_bytes = 0;
+	trie->load_size = size > 0 ? size : 0;
+	trie->load_err = MK_OK;
+	clock_gettime(CLOCK_MONOTONIC, &trie->load_start);
+
+	trie->loading = 1;
+	if (pthread_create(&trie->loader, NULL, load_in_background, trie) != 0) {
+		trie->loading = 0;
+		trie->load_started = 0;
+		pthread_rwlock_unlock(&trie->lock);
+		fclose(file);
+		return MK_ENOMEM;
+	}
+
+	trie->loader_joinable = 1;
+	pthread_rwlock_unlock(&trie->lock);
+
+	return MK_OK;
+}
+
+void mk_load_status(mk_trie_t *trie, mk_load_status_t *status)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	pthread_rwlock_rdlock(&trie->lock);
+	status->started = trie->load_started;
+	status->running = trie->loading;
+	status->words = trie->load_started ? trie->load_words : 0;
+	status->bytes = trie->load_started ? trie->load_bytes : 0;
+	status->size = trie->load_started ? trie->load_size : 0;
+	status->err = trie->load_started ? trie->load_err : MK_OK;
+	status->seconds = 0;
+
+	if (trie->load_started) {
+		struct timespec *end = trie->loading ? &now : &trie->load_end;
+		status->seconds = (end->tv_sec - trie->load_start.tv_sec) +
+						  (end->tv_nsec - trie->load_start.tv_nsec) / 1e9;
+	}
+	pthread_rwlock_unlock(&trie->lock);
+}
+
+mk_err_t mk_remove_batch(mk_trie_t *trie, const char *filename)
+{
+	pthread_rwlock_wrlock(&trie->lock);
+	errno = 0;
+	int ret;
+	if (trie->tiers) {
+		ret = tier_apply_file(trie->tiers, (char *)filename, 1);
+		start_merge(trie);
+	} else {
+		ret = remove_batch_file(trie->trie, (char *)filename);
+	}
+	int err = errno;
+
+	if (publish_update(trie, NULL) != MK_OK && ret == 0) {
+		ret = -1;
+		err = ENOMEM;
+	}
+
+	if (log_file_update(trie) < 0)
+		ret = err = -1;
+	pthread_rwlock_unlock(&trie->lock);
+
+	if (ret == 0)
+		return MK_OK;
+
+	return err == ENOMEM ? MK_ENOMEM : MK_EIO;
+}
+
+mk_err_t mk_decay(mk_trie_t *trie)
+{
+	pthread_rwlock_wrlock(&trie->lock);
+	if (trie->tiers)
+		tier_decay(trie->tiers);
+	else
+		decay_trie(trie->trie);
+	mk_err_t err = log_update(trie, J_DECAY, NULL, 0);
+	pthread_rwlock_unlock(&trie->lock);
+
+	return err;
+}
+
+mk_err_t mk_set_decay_period(mk_trie_t *trie, unsigned long period)
+{
+	u64_t value = period;
+
+	pthread_rwlock_wrlock(&trie->lock);
+	if (trie->tiers) {
+		trie->tiers->decay_period = value;
+		trie->tiers->since_decay = 0;
+	} else {
+		trie->trie->decay_period = value;
+		trie->trie->since_decay = 0;
+	}
+	mk_err_t err = log_update(trie, J_DECAY_PERIOD, &value, sizeof(u64_t));
+	pthread_rwlock_unlock(&trie->lock);
+
+	return err;
+}
+
+mk_err_t mk_open_journal(mk_trie_t *trie, const char *dir)
+{
+	mk_err_t err = MK_OK;
+
+	pthread_rwlock_wrlock(&trie->lock);
+
+	/**
+	 * The journal describes the whole dictionary, so it can only be opened
+	 * before anything else is in it
+	 */
+	if (trie->journal || trie->tiers || trie->trie->keys_no != 0) {
+		err = MK_EINVAL;
+	} else {
+		/**
+		 * The replay brings back the evictions from their records, so it
+		 * must not evict by itself
+		 */
+		u64_t mem_limit = trie->trie->mem_limit;
+		trie->trie->mem_limit = 0;
+
+		errno = 0;
+		trie->journal = open_journal(trie->trie, dir);
+		trie->trie->mem_limit = mem_limit;
+
+		if (!trie->journal) {
+			err = errno == ENOMEM ? MK_ENOMEM : MK_EIO;
+		} else {
+			trie->evict_err = MK_OK;
+			enforce_budget(trie->trie, NULL);
+			if (trie->frozen)
+				err = freeze_words(trie);
+			if (err == MK_OK)
+				err = publish_update(trie, NULL);
+			if (err == MK_OK)
+				err = trie->evict_err;
+		}
+	}
+
+	pthread_rwlock_unlock(&trie->lock);
+
+	return err;
+}
+
+mk_err_t mk_enable_snapshots(mk_trie_t *trie)
+{
+	mk_err_t err = MK_OK;
+
+	pthread_rwlock_wrlock(&trie->lock);
+	if (trie->tiers) {
+		err = MK_EINVAL;
+	} else if (!trie->vtrie) {
+		v_trie_t *vtrie = create_vtrie();
+		if (!vtrie || vtrie_rebuild(vtrie, trie->trie) < 0) {
+			if (vtrie)
+				free_vtrie(vtrie);
+
+			err = MK_ENOMEM;
+		} else {
+			/**
+			 * The readers find the versions without the lock
+			 */
+			__atomic_store_n(&trie->vtrie, vtrie, __ATOMIC_RELEASE);
+		}
+	}
+	pthread_rwlock_unlock(&trie->lock);
+
+	return err;
+}
+
+mk_err_t mk_enable_tiers(mk_trie_t *trie, unsigned long merge_bytes)
+{
+	mk_err_t err = MK_OK;
+
+	pthread_rwlock_wrlock(&trie->lock);
+	if (trie->tiers || trie->journal || trie->vtrie || trie->index ||
+		trie->frozen || trie->trie->mem_limit) {
+		err = MK_EINVAL;
+	} else {
+		t_dict_t *tiers = create_tiers(trie->trie, merge_bytes ? merge_bytes :
+									   TIER_MERGE_BYTES);
+		g_node_t *old_root = trie->trie->root;
+
+		/**
+		 * The keys live in the base from now on, so the trie is emptied
+		 */
+		if (!tiers || init_trie(trie->trie) < 0) {
+			if (tiers)
+				free_tiers(tiers);
+
+			trie->trie->root = old_root;
+			err = MK_ENOMEM;
+		} else {
+			free_trie(old_root, trie->trie->free_func);
+			trie->trie->keys_no = 0;
+			trie->trie->tombs_no = 0;
+			trie->trie->mem_used = tnode_size();
+			trie->tiers = tiers;
+		}
+	}
+	pthread_rwlock_unlock(&trie->lock);
+
+	return err;
+}
+
+mk_err_t mk_enable_index(mk_trie_t *trie)
+{
+	mk_err_t err = MK_OK;
+
+	pthread_rwlock_wrlock(&trie->lock);
+	if (trie->tiers) {
+		err = MK_EINVAL;
+	} else if (!trie->index) {
+		sx_index_t *index = create_suffix_index();
+		if (!index || sx_rebuild(index, trie->trie) < 0) {
+			free_suffix_index(index);
+			err = MK_ENOMEM;
+		} else {
+			trie->index = index;
+			trie->index_stale = 0;
+		}
+	}
+	pthread_rwlock_unlock(&trie->lock);
+
+	return err;
+}
+
+mk_err_t mk_freeze_words(mk_trie_t *trie)
+{
+	mk_err_t err = MK_EINVAL;
+
+	pthread_rwlock_wrlock(&trie->lock);
+	if (!trie->tiers) {
+		trie->frozen = 1;
+		err = freeze_words(trie);
+	}
+	pthread_rwlock_unlock(&trie->lock);
+
+	return err;
+}
+
+/**
+ * @brief Reads the pairs of consecutive words of a text, as the ids of the
+ * frozen vocabulary. A word outside of it, or an invalid one, ends the
+ * pair of the word before it and starts no pair.
+ *
+ * @param file The text.
+ * @param ids The ids.
+ * @param pairs Where to store the pairs, to be freed by the caller.
+ * @param pairs_no Where to store their number.
+ * @return mk_err_t MK_OK, MK_EIO or MK_ENOMEM.
+ */
+static mk_err_t read_pairs(FILE *file, w_index_t *ids, u64_t **pairs,
+						   u64_t *pairs_no)
+{
+	char word[MAX_BUFF];
+	u64_t cap = 0;
+	u32_t prev = W_NO_ID;
+	int read;
+
+	*pairs = NULL;
+	*pairs_no = 0;
+
+	while ((read = read_word(file, word)) != EOF) {
+		u32_t next = W_NO_ID;
+		if (read)
+			next = w_find(ids, word);
+
+		if (prev != W_NO_ID && next != W_NO_ID) {
+			if (*pairs_no == cap) {
+				cap = cap ? 2 * cap : LOAD_CHUNK;
+				u64_t *bigger = (u64_t *)realloc(*pairs, cap * sizeof(u64_t));
+				if (!bigger)
+					return MK_ENOMEM;
+
+				*pairs = bigger;
+			}
+
+			(*pairs)[(*pairs_no)++] = (u64_t)prev << 32 | next;
+		}
+
+		prev = next;
+	}
+
+	return ferror(file) ? MK_EIO : MK_OK;
+}
+
+mk_err_t mk_load_bigrams(mk_trie_t *trie, const char *filename)
+{
+	FILE *file = fopen(filename, "rt");
+	if (!file)
+		return MK_EIO;
+
+	u64_t *pairs = NULL, pairs_no = 0;
+	mk_err_t err = MK_EINVAL;
+
+	pthread_rwlock_wrlock(&trie->lock);
+	w_index_t *ids = trie->trie->ids;
+	if (ids)
+		err = read_pairs(file, ids, &pairs, &pairs_no);
+
+	if (err == MK_OK) {
+		b_model_t *model = build_bigrams(pairs, pairs_no, ids->words_no);
+		if (!model) {
+			err = MK_ENOMEM;
+		} else {
+			free_bigrams(trie->bigrams);
+			trie->bigrams = model;
+		}
+	}
+	pthread_rwlock_unlock(&trie->lock);
+
+	free(pairs);
+	fclose(file);
+	return err;
+}
+
+mk_err_t mk_set_mem_limit(mk_trie_t *trie, unsigned long bytes)
+{
+	mk_err_t err = MK_EINVAL;
+
+	pthread_rwlock_wrlock(&trie->lock);
+	if (!trie->tiers) {
+		trie->evict_err = MK_OK;
+		trie->trie->mem_limit = bytes;
+		enforce_budget(trie->trie, NULL);
+		err = trie->evict_err;
+	}
+	pthread_rwlock_unlock(&trie->lock);
+
+	return err;
+}
+
+void mk_stats(mk_trie_t *trie, mk_stats_t *stats)
+{
+	pthread_rwlock_rdlock(&trie->lock);
+
+	stats->tiered = trie->tiers != NULL;
+	stats->users = trie->users ? trie->users->users_no : 0;
+	stats->users_bytes = trie->users ? trie->users->bytes : 0;
+	stats->indexed = trie->index != NULL;
+	stats->index_nodes = trie->index ? trie->index->nodes : 0;
+	stats->index_posts = trie->index ? trie->index->posts : 0;
+	stats->index_bytes = trie->index ? trie->index->bytes : 0;
+	stats->frozen_words = trie->trie->ids ? trie->trie->ids->words_no : 0;
+	stats->frozen_bytes = trie->trie->ids ? trie->trie->ids->bytes : 0;
+	stats->bigrams = trie->bigrams ? trie->bigrams->pairs_no : 0;
+	stats->bigrams_bytes = trie->bigrams ? trie->bigrams->bytes : 0;
+	for (unsigned int i = 0; i < Q_STRATEGIES; i++) {
+		stats->plan_runs[i] = __atomic_load_n(&trie->plan_runs[i],
+											  __ATOMIC_RELAXED);
+		stats->plan_visited[i] = __atomic_load_n(&trie->plan_visited[i],
+												 __ATOMIC_RELAXED);
+	}
+	if (trie->tiers) {
+		u64_t base_nodes, delta_nodes;
+		stats->mem_used = tiers_size(trie->tiers, &base_nodes, &delta_nodes);
+		stats->keys = trie->tiers->keys_no;
+		stats->nodes = base_nodes + delta_nodes;
+		stats->base_nodes = base_nodes;
+		stats->delta_nodes = delta_nodes;
+		stats->merges = trie->tiers->merges;
+		stats->mem_limit = 0;
+		stats->evicted = 0;
+		stats->recent_no = 0;
+		pthread_rwlock_unlock(&trie->lock);
+		return;
+	}
+
+	g_tree_t *dict = trie->trie;
+	stats->keys = dict->keys_no;
+	stats->nodes = dict->mem_used / tnode_size();
+	stats->mem_used = dict->mem_used;
+	stats->mem_limit = dict->mem_limit;
+	stats->evicted = dict->evicted;
+	stats->base_nodes = 0;
+	stats->delta_nodes = 0;
+	stats->merges = 0;
+
+	/**
+	 * The ring holds the last EVICT_RECENT keys, the newest is copied first
+	 */
+	stats->recent_no = 0;
+	for (u64_t i = dict->evicted; i > 0 && stats->recent_no < MK_RECENT_MAX &&
+		 stats->recent_no < EVICT_RECENT; i--) {
+		strcpy(stats->recent[stats->recent_no],
+			   dict->recent[(i - 1) % EVICT_RECENT]);
+		stats->recent_no++;
+	}
+
+	pthread_rwlock_unlock(&trie->lock);
+}
+
+mk_err_t mk_checkpoint(mk_trie_t *trie)
+{
+	mk_err_t err = MK_OK;
+
+	pthread_rwlock_wrlock(&trie->lock);
+	if (!trie->journal)
+		err = MK_EINVAL;
+	else if (journal_checkpoint(trie->journal, trie->trie) < 0)
+		err = MK_EIO;
+	pthread_rwlock_unlock(&trie->lock);
+
+	return err;
+}
+
+mk_err_t mk_sync(mk_trie_t *trie)
+{
+	mk_err_t err = MK_OK;
+
+	pthread_rwlock_wrlock(&trie->lock);
+	if (trie->journal && journal_flush(trie->journal) < 0)
+		err = MK_EIO;
+	pthread_rwlock_unlock(&trie->lock);
+
+	return err;
+}
+
+unsigned long mk_keys(mk_trie_t *trie)
+{
+	pthread_rwlock_rdlock(&trie->lock);
+	unsigned long keys = trie->tiers ? trie->tiers->keys_no :
+									   trie->trie->keys_no;
+	pthread_rwlock_unlock(&trie->lock);
+
+	return keys;
+}
+
+mk_err_t mk_lookup_batch(mk_trie_t *trie, const char **words,
+						 unsigned int words_no, unsigned long *freqs)
+{
+	char copy[MK_WORD_MAX];
+	for (unsigned int i = 0; i < words_no; i++) {
+		if (copy_word(words[i], copy) < 0)
+			return MK_EINVAL;
+	}
+
+	g_node_t **ends = (g_node_t **)malloc((words_no + 1) *
+										  sizeof(g_node_t *));
+	if (!ends)
+		return MK_ENOMEM;
+
+	pthread_rwlock_rdlock(&trie->lock);
+	if (trie->tiers) {
+		t_dict_t *dict = trie->tiers;
+		for (unsigned int i = 0; i < words_no; i++) {
+			key_t rec;
+			strcpy(copy, words[i]);
+			freqs[i] = t_find(dict->base, dict->deltas, dict->deltas_no, copy,
+							  &rec) ? rec.freq : 0;
+		}
+
+		pthread_rwlock_unlock(&trie->lock);
+		free(ends);
+		return MK_OK;
+	}
+
+	w_index_t *ids = trie->trie->ids;
+	if (ids) {
+		/**
+		 * The frozen words are read from the array of their ids, only the
+		 * newer ones are walked
+		 */
+		for (unsigned int i = 0; i < words_no; i++) {
+			strcpy(copy, words[i]);
+			u32_t id = w_find(ids, copy);
+			if (id != W_NO_ID) {
+				freqs[i] = ids->freqs[id];
+			} else {
+				g_node_t *end = get_ending_node(trie->trie->root, copy);
+				freqs[i] = end ? ((key_t *)end->data)->freq : 0;
+			}
+		}
+
+		pthread_rwlock_unlock(&trie->lock);
+		free(ends);
+		return MK_OK;
+	}
+
+	lookup_batch(trie->trie->root, (char **)words, words_no, LOOKUP_GROUP, 0,
+				 ends);
+
+	for (unsigned int i = 0; i < words_no; i++)
+		freqs[i] = ends[i] ? ((key_t *)ends[i]->data)->freq : 0;
+	pthread_rwlock_unlock(&trie->lock);
+
+	free(ends);
+	return MK_OK;
+}
+
+mk_err_t mk_autocorrect(mk_trie_t *trie, const char *word, unsigned int k,
+						char *buff, size_t len, size_t *needed)
+{
+	char copy[MK_WORD_MAX];
+	if (copy_word(word, copy) < 0)
+		return MK_EINVAL;
+
+	char *out = NULL;
+	size_t out_len = 0;
+	FILE *stream = open_memstream(&out, &out_len);
+	if (!stream)
+		return MK_ENOMEM;
+
+	/**
+	 * With snapshots, the search reads a pinned version, so it never waits
+	 * for the updates and they never wait for it
+	 */
+	unsigned int found = 0;
+	v_trie_t *vtrie = __atomic_load_n(&trie->vtrie, __ATOMIC_ACQUIRE);
+	if (vtrie && !__atomic_load_n(&trie->stale, __ATOMIC_ACQUIRE)) {
+		char word_buff[MAX_BUFF];
+		v_version_t *version = vtrie_pin(vtrie);
+		v_search_kdiff(version->root, word_buff, 0, copy, strlen(copy), k,
+					   &found, stream);
+		vtrie_unpin(vtrie, version);
+	} else {
+		pthread_rwlock_rdlock(&trie->lock);
+		if (trie->tiers) {
+			char word_buff[MAX_BUFF];
+			t_pos_t root;
+			t_dict_t *dict = trie->tiers;
+			t_root(dict->base, dict->deltas, dict->deltas_no, &root);
+			t_search_kdiff(dict->base, &root, word_buff, 0, copy,
+						   strlen(copy), k, &found, stream);
+		} else {
+			found = par_search_kdiff(trie->pool, trie->trie->root, copy, k,
+									 stream);
+		}
+		pthread_rwlock_unlock(&trie->lock);
+	}
+
+	if (fclose(stream) != 0) {
+		free(out);
+		return MK_ENOMEM;
+	}
+
+	*needed = out_len + 1;
+
+	mk_err_t err = MK_OK;
+	if (found == 0)
+		err = MK_ENOTFOUND;
+	else if (len < *needed)
+		err = MK_ERANGE;
+
+	if (err == MK_OK)
+		memcpy(buff, out, out_len + 1);
+	else if (len > 0)
+		buff[0] = '\0';
+
+	free(out);
+	return err;
+}
+
+/**
+ * @brief Completes a prefix, and tells how.
+ *
+ * @param trie The handle of the dictionary.
+ * @param prefix The prefix.
+ * @param mode The mode, from 0 to 3.
+ * @param buff The caller's buffer.
+ * @param len The size of the buffer.
+ * @param plan Where to store the strategies that ran, or NULL.
+ * @return mk_err_t MK_OK, MK_ENOTFOUND, MK_EINVAL or MK_ERANGE.
+ */
+static mk_err_t autocomplete(mk_trie_t *trie, const char *prefix,
+							 unsigned int mode, char *buff, size_t len,
+							 mk_plan_t *plan)
+{
+	char copy[MK_WORD_MAX];
+	if (copy_word(prefix, copy) < 0 || mode > 3)
+		return MK_EINVAL;
+
+	if (plan)
+		plan->steps_no = 0;
+
+	pthread_rwlock_rdlock(&trie->lock);
+
+	if (trie->tiers) {
+		mk_err_t err = tiers_autocomplete(trie->tiers, copy, mode, buff, len);
+		pthread_rwlock_unlock(&trie->lock);
+		return err;
+	}
+
+	g_node_t *prefix_end = get_end_of_prefix(trie->trie->root, copy, 0);
+	if (!prefix_end) {
+		pthread_rwlock_unlock(&trie->lock);
+		if (len > 0)
+			buff[0] = '\0';
+
+		return MK_ENOTFOUND;
+	}
+
+	g_node_t *nodes[3];
+	q_plan_t steps;
+	unsigned int count = plan_autocomplete(trie->pool, prefix_end, mode,
+										   trie->trie->epoch, nodes, &steps);
+
+	/**
+	 * The readers run at the same time, so the counters are atomic
+	 */
+	for (unsigned int i = 0; i < steps.steps_no; i++) {
+		__atomic_add_fetch(&trie->plan_runs[steps.strategies[i]], 1,
+						   __ATOMIC_RELAXED);
+		__atomic_add_fetch(&trie->plan_visited[steps.strategies[i]],
+						   steps.visited[i], __ATOMIC_RELAXED);
+
+		if (plan) {
+			plan->strategies[i] = q_strategy_name(steps.strategies[i]);
+			plan->visited[i] = steps.visited[i];
+			plan->tasks[i] = steps.tasks[i];
+		}
+	}
+
+	if (plan)
+		plan->steps_no = steps.steps_no;
+
+	mk_err_t err = put_words(nodes, count, buff, len, NULL);
+	pthread_rwlock_unlock(&trie->lock);
+
+	return err;
+}
+
+mk_err_t mk_autocomplete(mk_trie_t *trie, const char *prefix,
+						 unsigned int mode, char *buff, size_t len)
+{
+	return autocomplete(trie, prefix, mode, buff, len, NULL);
+}
+
+mk_err_t mk_explain_autocomplete(mk_trie_t *trie, const char *prefix,
+								 unsigned int mode, char *buff, size_t len,
+								 mk_plan_t *plan)
+{
+	return autocomplete(trie, prefix, mode, buff, len, plan);
+}
+
+mk_err_t mk_autocomplete_fuzzy(mk_trie_t *trie, const char *prefix,
+							   unsigned int k, unsigned int n, char *buff,
+							   size_t len, size_t *needed)
+{
+	char copy[MK_WORD_MAX];
+	if (copy_word(prefix, copy) < 0 || n > MK_RESULTS_MAX)
+		return MK_EINVAL;
+
+	pthread_rwlock_rdlock(&trie->lock);
+
+	if (trie->tiers) {
+		pthread_rwlock_unlock(&trie->lock);
+		return MK_EINVAL;
+	}
+
+	unsigned int count;
+	g_node_t **best = get_fuzzy_completions(trie->trie->root, copy, k, n,
+											trie->trie->epoch, &count);
+	if (!best) {
+		pthread_rwlock_unlock(&trie->lock);
+		return MK_ENOMEM;
+	}
+
+	mk_err_t err = put_words(best, count, buff, len, needed);
+	pthread_rwlock_unlock(&trie->lock);
+	free(best);
+
+	if (count == 0)
+		return MK_ENOTFOUND;
+
+	return err;
+}
+
+mk_err_t mk_match(mk_trie_t *trie, const char *pattern, unsigned long limit,
+				  int (*found)(const char *word, void *arg), void *arg,
+				  unsigned long *count)
+{
+	m_pattern_t compiled;
+	if (!pattern || compile_pattern(pattern, &compiled) < 0)
+		return MK_EINVAL;
+
+	m_search_t search;
+	search.pattern = &compiled;
+	search.limit = limit;
+	search.found = 0;
+	search.stop = 0;
+	search.found_func = found;
+	search.found_arg = arg;
+
+	pthread_rwlock_rdlock(&trie->lock);
+	if (trie->tiers) {
+		pthread_rwlock_unlock(&trie->lock);
+		return MK_EINVAL;
+	}
+
+	search_pattern(trie->trie->root, &search, m_start(&compiled), 0);
+	pthread_rwlock_unlock(&trie->lock);
+
+	if (count)
+		*count = search.found;
+
+	return search.found ? MK_OK : MK_ENOTFOUND;
+}
+
+mk_err_t mk_predict(mk_trie_t *trie, const char *prev, const char *prefix,
+					unsigned long n,
+					int (*found)(const char *word, unsigned long count,
+								 void *arg),
+					void *arg, unsigned long *count)
+{
+	char prev_copy[MK_WORD_MAX], prefix_copy[MK_WORD_MAX] = "";
+	if (copy_word(prev, prev_copy) < 0 ||
+		(prefix && prefix[0] != '\0' && copy_word(prefix, prefix_copy) < 0))
+		return MK_EINVAL;
+
+	pthread_rwlock_rdlock(&trie->lock);
+	if (!trie->bigrams) {
+		pthread_rwlock_unlock(&trie->lock);
+		return MK_EINVAL;
+	}
+
+	w_index_t *ids = trie->trie->ids;
+	b_candidate_t *candidates = NULL;
+	u32_t candidates_no = 0;
+	mk_err_t err = MK_OK;
+
+	/**
+	 * The successors are read only when the prefix has keys under it, and
+	 * only the ones in that subtrie are kept
+	 */
+	u32_t id = w_find(ids, prev_copy);
+	g_node_t *end = get_end_of_prefix(trie->trie->root, prefix_copy, 0);
+	if (id != W_NO_ID && end && has_live_keys(end) &&
+		b_predict(trie->bigrams, ids, id, prefix_copy, &candidates,
+				  &candidates_no) < 0)
+		err = MK_ENOMEM;
+
+	unsigned long given = 0;
+	for (u32_t i = 0; i < candidates_no && (n == 0 || given < n); i++) {
+		given++;
+		if (found(candidates[i].word, b_count(candidates[i].count), arg))
+			break;
+	}
+	pthread_rwlock_unlock(&trie->lock);
+
+	free(candidates);
+	if (count)
+		*count = given;
+
+	if (err != MK_OK)
+		return err;
+
+	return given ? MK_OK : MK_ENOTFOUND;
+}
+
+/**
+ * @brief Finds the words that end with a string, or that contain it, with
+ * the suffix index.
+ *
+ * @param trie The handle of the dictionary.
+ * @param str The string.
+ * @param infix 1 for the words that contain the string, 0 for the words that
+ * end with it.
+ * @param limit The maximum number of words, 0 for all of them.
+ * @param found The callback.
+ * @param arg The second argument of the callback.
+ * @param count Where to store the number of words found, or NULL.
+ * @return mk_err_t MK_OK, MK_ENOTFOUND, MK_EINVAL or MK_ENOMEM.
+ */
+static mk_err_t find_in_index(mk_trie_t *trie, const char *str, u8_t infix,
+							  unsigned long limit,
+							  int (*found)(const char *word, void *arg),
+							  void *arg, unsigned long *count)
+{
+	char copy[MK_WORD_MAX];
+	if (copy_word(str, copy) < 0)
+		return MK_EINVAL;
+
+	pthread_rwlock_rdlock(&trie->lock);
+	if (!trie->index || trie->index_stale) {
+		mk_err_t err = trie->index ? MK_ENOMEM : MK_EINVAL;
+		pthread_rwlock_unlock(&trie->lock);
+		return err;
+	}
+
+	u64_t found_no;
+	int ret = sx_find(trie->index, copy, infix, limit, found, arg,
+					  &found_no);
+	pthread_rwlock_unlock(&trie->lock);
+
+	if (count)
+		*count = found_no;
+
+	if (ret < 0)
+		return MK_ENOMEM;
+
+	return found_no ? MK_OK : MK_ENOTFOUND;
+}
+
+mk_err_t mk_find_suffix(mk_trie_t *trie, const char *suffix,
+						unsigned long limit,
+						int (*found)(const char *word, void *arg), void *arg,
+						unsigned long *count)
+{
+	return find_in_index(trie, suffix, 0, limit, found, arg, count);
+}
+
+mk_err_t mk_find_infix(mk_trie_t *trie, const char *infix,
+					   unsigned long limit,
+					   int (*found)(const char *word, void *arg), void *arg,
+					   unsigned long *count)
+{
+	return find_in_index(trie, infix, 1, limit, found, arg, count);
+}
+
+/**
+ * @brief Checks an end of a range given by the caller, and copies it.
+ *
+ * @param word The end, NULL or "" for none.
+ * @param copy A buffer with room for MK_WORD_MAX characters.
+ * @return int Returns 0 if the end is valid, or -1 otherwise.
+ */
+static int copy_bound(const char *word, char *copy)
+{
+	if (!word || word[0] == '\0') {
+		copy[0] = '\0';
+		return 0;
+	}
+
+	return copy_word(word, copy);
+}
+
+mk_err_t mk_cursor_init(mk_cursor_t *cursor, const char *from, const char *to)
+{
+	if (copy_bound(from, cursor->from) < 0 || copy_bound(to, cursor->to) < 0)
+		return MK_EINVAL;
+
+	cursor->skip_from = 0;
+	cursor->done = 0;
+	return MK_OK;
+}
+
+mk_err_t mk_cursor_fetch(mk_trie_t *trie, mk_cursor_t *cursor,
+						 unsigned long n,
+						 int (*found)(const char *word, unsigned long freq,
+									  void *arg),
+						 void *arg, unsigned long *count)
+{
+	unsigned long given = 0;
+	if (count)
+		*count = 0;
+
+	if (cursor->done)
+		return MK_ENOTFOUND;
+
+	pthread_rwlock_rdlock(&trie->lock);
+	if (trie->tiers) {
+		pthread_rwlock_unlock(&trie->lock);
+		return MK_EINVAL;
+	}
+
+	/**
+	 * The walk starts again from the last word given, so the updates made
+	 * between two fetches are seen, and nothing is left locked
+	 */
+	i_cursor_t walk;
+	cursor_seek(&walk, trie->trie->root, cursor->from);
+
+	while (n == 0 || given < n) {
+		g_node_t *node = cursor_next(&walk);
+		if (!node || (cursor->to[0] != '\0' &&
+					  strcmp(walk.buff, cursor->to) >= 0)) {
+			cursor->done = 1;
+			break;
+		}
+
+		if (cursor->skip_from && strcmp(walk.buff, cursor->from) == 0)
+			continue;
+
+		strcpy(cursor->from, walk.buff);
+		cursor->skip_from = 1;
+		given++;
+
+		if (found(walk.buff, ((key_t *)node->data)->freq, arg) != 0)
+			break;
+	}
+	pthread_rwlock_unlock(&trie->lock);
+
+	if (count)
+		*count = given;
+
+	return given ? MK_OK : MK_ENOTFOUND;
+}
+
+mk_err_t mk_swipe(mk_trie_t *trie, const double *points,
+				  unsigned int points_no, unsigned int n, char *buff,
+				  size_t len, size_t *needed)
+{
+	if (points_no == 0 || points_no > SWIPE_MAX_PTS || n > MK_RESULTS_MAX)
+		return MK_EINVAL;
+
+	pthread_rwlock_rdlock(&trie->lock);
+
+	if (trie->tiers) {
+		pthread_rwlock_unlock(&trie->lock);
+		return MK_EINVAL;
+	}
+
+	unsigned int count;
+	g_node_t **best = decode_swipe(trie->trie->root, trie->keyboard, points,
+								   points_no, n, trie->trie->epoch, &count);
+	if (!best) {
+		pthread_rwlock_unlock(&trie->lock);
+		return MK_ENOMEM;
+	}
+
+	mk_err_t err = put_words(best, count, buff, len, needed);
+	pthread_rwlock_unlock(&trie->lock);
+	free(best);
+
+	if (count == 0)
+		return MK_ENOTFOUND;
+
+	return err;
+}
+
+mk_err_t mk_user_insert(mk_trie_t *trie, unsigned long user,
+						const char *word)
+{
+	char copy[MK_WORD_MAX];
+	if (copy_word(word, copy) < 0)
+		return MK_EINVAL;
+
+	mk_err_t err = MK_OK;
+
+	pthread_rwlock_wrlock(&trie->lock);
+	if (!trie->users)
+		trie->users = create_overlays();
+
+	if (trie->tiers)
+		err = MK_EINVAL;
+	else if (!trie->users || overlay_insert(trie->users, trie->trie, user,
+											 copy) < 0)
+		err = MK_ENOMEM;
+	pthread_rwlock_unlock(&trie->lock);
+
+	return err;
+}
+
+mk_err_t mk_user_remove(mk_trie_t *trie, unsigned long user,
+						const char *word)
+{
+	char copy[MK_WORD_MAX];
+	if (copy_word(word, copy) < 0)
+		return MK_EINVAL;
+
+	mk_err_t err = MK_OK;
+
+	pthread_rwlock_wrlock(&trie->lock);
+	if (!trie->users)
+		trie->users = create_overlays();
+
+	if (trie->tiers)
+		err = MK_EINVAL;
+	else if (!trie->users || overlay_remove(trie->users, trie->trie, user,
+											 copy) < 0)
+		err = MK_ENOMEM;
+	pthread_rwlock_unlock(&trie->lock);
+
+	return err;
+}
+
+void mk_user_drop(mk_trie_t *trie, unsigned long user)
+{
+	pthread_rwlock_wrlock(&trie->lock);
+	if (trie->users)
+		drop_overlay(trie->users, user);
+	pthread_rwlock_unlock(&trie->lock);
+}
+
+mk_err_t mk_user_autocorrect(mk_trie_t *trie, unsigned long user,
+							 const char *word, unsigned int k, char *buff,
+							 size_t len, size_t *needed)
+{
+	char copy[MK_WORD_MAX];
+	if (copy_word(word, copy) < 0)
+		return MK_EINVAL;
+
+	/**
+	 * A user without changes sees the shared dictionary, with its faster
+	 * searches
+	 */
+	pthread_rwlock_rdlock(&trie->lock);
+
+	o_overlay_t *overlay = get_overlay(trie->users, user);
+	if (!overlay || trie->tiers) {
+		u8_t tiered = trie->tiers != NULL;
+		pthread_rwlock_unlock(&trie->lock);
+
+		if (tiered)
+			return MK_EINVAL;
+
+		return mk_autocorrect(trie, copy, k, buff, len, needed);
+	}
+
+	char *out = NULL;
+	size_t out_len = 0;
+	FILE *stream = open_memstream(&out, &out_len);
+	if (!stream) {
+		pthread_rwlock_unlock(&trie->lock);
+		return MK_ENOMEM;
+	}
+
+	unsigned int found = 0;
+	char word_buff[MAX_BUFF];
+	o_pos_t root;
+	o_root(trie->trie->root, overlay, &root);
+	o_search_kdiff_words(overlay, &root, word_buff, 0, copy, strlen(copy), k,
+						 &found, stream);
+	pthread_rwlock_unlock(&trie->lock);
+
+	if (fclose(stream) != 0) {
+		free(out);
+		return MK_ENOMEM;
+	}
+
+	*needed = out_len + 1;
+
+	mk_err_t err = MK_OK;
+	if (found == 0)
+		err = MK_ENOTFOUND;
+	else if (len < *needed)
+		err = MK_ERANGE;
+
+	if (err == MK_OK)
+		memcpy(buff, out, out_len + 1);
+	else if (len > 0)
+		buff[0] = '\0';
+
+	free(out);
+	return err;
+}
+
+mk_err_t mk_user_autocomplete(mk_trie_t *trie, unsigned long user,
+							  const char *prefix, unsigned int mode,
+							  char *buff, size_t len)
+{
+	char copy[MK_WORD_MAX];
+	if (copy_word(prefix, copy) < 0 || mode > 3)
+		return MK_EINVAL;
+
+	pthread_rwlock_rdlock(&trie->lock);
+
+	o_overlay_t *overlay = get_overlay(trie->users, user);
+	if (!overlay || trie->tiers) {
+		u8_t tiered = trie->tiers != NULL;
+		pthread_rwlock_unlock(&trie->lock);
+
+		if (tiered)
+			return MK_EINVAL;
+
+		return mk_autocomplete(trie, copy, mode, buff, len);
+	}
+
+	o_pos_t pos;
+	if (!o_get_end_of_prefix(trie->trie->root, overlay, copy, &pos)) {
+		pthread_rwlock_unlock(&trie->lock);
+		if (len > 0)
+			buff[0] = '\0';
+
+		return MK_ENOTFOUND;
+	}
+
+	char word[MAX_BUFF], shortest[MAX_BUFF], frequent[MAX_BUFF];
+	size_t used = 0;
+	mk_err_t err = MK_OK;
+
+	if (mode == 0 || mode == 1) {
+		strcpy(word, copy);
+		o_first_word(overlay, &pos, word);
+		put_word(word, buff, len, &used, &err);
+	}
+
+	if (mode != 1) {
+		size_t shortest_len = INF;
+		u64_t max_score = 0;
+		strcpy(word, copy);
+		strcpy(shortest, copy);
+		frequent[0] = '\0';
+		o_best_words(overlay, &pos, word, trie->trie->epoch, shortest,
+					 &shortest_len, frequent, &max_score);
+
+		if (mode == 0 || mode == 2)
+			put_word(shortest, buff, len, &used, &err);
+
+		if (mode == 0 || mode == 3)
+			put_word(frequent, buff, len, &used, &err);
+	}
+
+	pthread_rwlock_unlock(&trie->lock);
+
+	return end_words(buff, len, used, NULL, err);
+}
+
+const char *mk_strategy_name(unsigned int strategy)
+{
+	if (strategy >= Q_STRATEGIES)
+		return NULL;
+
+	return q_strategy_name(strategy);
+}
+
+const char *mk_strerror(mk_err_t err)
+{
+	switch (err) {
+	case MK_OK:
+		return "Success";
+	case MK_ENOTFOUND:
+		return "No words found";
+	case MK_EINVAL:
+		return "Invalid word or parameter";
+	case MK_ENOMEM:
+		return "Oops! Memory allocation failed. Please try again.";
+	case MK_EIO:
+		return "Couldn't open or write a file. Please try again";
+	case MK_ERANGE:
+		return "The result doesn't fit in the buffer";
+	}
+
+	return "Unknown error";
+}
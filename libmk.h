@@ -0,0 +1,684 @@
+#ifndef LIBMK_H_
+#define LIBMK_H_
+
+#include <stddef.h>
+
+/**
+ * The magic keyboard engine, as a library. The trie is hidden behind an
+ * opaque handle, the results are written into buffers given by the caller,
+ * and every function reports its errors through its return value, it never
+ * prints or exits.
+ *
+ * Thread safety: all the functions that take a handle can be called from
+ * any number of threads at the same time. The updates (insert, remove, load,
+ * decay) are serialised by the handle, and the queries run concurrently
+ * with each other, but never with an update, unless the snapshots are
+ * enabled (see mk_enable_snapshots). mk_destroy must be the last
+ * call on a handle, with no other call in progress. Different handles share
+ * nothing.
+ *
+ * The words are made of lowercase English letters, and they are shorter
+ * than MK_WORD_MAX characters.
+ */
+
+#define MK_WORD_MAX 100
+#define MK_RECENT_MAX 8
+#define MK_STRATEGIES 4
+#define MK_RESULTS_MAX 65536
+
+typedef struct mk_trie_t mk_trie_t;
+
+enum mk_err {
+	MK_OK, // success
+	MK_ENOTFOUND, // the query has no results
+	MK_EINVAL, // an invalid word or parameter
+	MK_ENOMEM, // there is no memory left
+	MK_EIO, // a file couldn't be opened, read or written
+	MK_ERANGE // the result doesn't fit in the caller's buffer
+};
+typedef enum mk_err mk_err_t;
+
+typedef struct mk_stats_t mk_stats_t;
+struct mk_stats_t {
+	unsigned long keys; // the words in the dictionary
+	unsigned long nodes; // the nodes of the trie
+	unsigned long mem_used; // the bytes of the nodes
+	unsigned long mem_limit; // the ceiling of mem_used, 0 = no limit
+	unsigned long evicted; // the words evicted to stay under the ceiling
+	char recent[MK_RECENT_MAX][MK_WORD_MAX]; // the last evicted words, the
+											 // newest first
+	unsigned int recent_no; // the number of words in recent
+	int tiered; // 1 if the dictionary is tiered (see mk_enable_tiers)
+	unsigned long base_nodes; // the nodes of the frozen base, if tiered
+	unsigned long delta_nodes; // the nodes of the deltas, if tiered
+	unsigned long merges; // the merges of the deltas into the base
+	unsigned long users; // the users with their own changes
+	unsigned long users_bytes; // the memory of the changes of the users
+	int indexed; // 1 if the suffix index is on (see mk_enable_index)
+	unsigned long index_nodes; // the nodes of the suffix index
+	unsigned long index_posts; // the suffixes in the suffix index
+	unsigned long index_bytes; // the memory of the suffix index
+	unsigned long frozen_words; // the words with ids (see mk_freeze_words)
+	unsigned long frozen_bytes; // the memory of the ids
+	unsigned long bigrams; // the pairs of the bigrams (see mk_load_bigrams)
+	unsigned long bigrams_bytes; // the memory of the bigrams
+	unsigned long plan_runs[MK_STRATEGIES]; // the AUTOCOMPLETE searches of
+											// every strategy (see
+											// mk_strategy_name)
+	unsigned long plan_visited[MK_STRATEGIES]; // the nodes they visited
+};
+
+typedef struct mk_load_status_t mk_load_status_t;
+struct mk_load_status_t {
+	int started; // 1 once a background load was started
+	int running; // 1 while the last background load is running
+	unsigned long words; // the words it inserted so far
+	unsigned long bytes; // the bytes of its file read so far
+	unsigned long size; // the size of its file, 0 if unknown
+	double seconds; // the time since it started, or its whole time once over
+	mk_err_t err; // its first error, MK_OK so far
+};
+
+typedef struct mk_plan_t mk_plan_t;
+struct mk_plan_t {
+	const char *strategies[3]; // the names of the strategies that ran
+	unsigned long visited[3]; // the nodes that every one of them visited
+	unsigned int tasks[3]; // the tasks every one of them ran on the workers,
+						   // 0 if it ran on the calling thread
+	unsigned int steps_no; // the number of strategies that ran
+};
+
+typedef struct mk_cursor_t mk_cursor_t;
+struct mk_cursor_t {
+	char from[MK_WORD_MAX]; // where the next fetch starts
+	char to[MK_WORD_MAX]; // where the range ends, excluded, "" for no end
+	int skip_from; // 1 if from was given by the last fetch, so it is skipped
+	int done; // 1 once the range has no words left
+};
+
+/**
+ * @brief Creates an empty dictionary.
+ *
+ * @param trie Where to store the handle of the dictionary.
+ * @param threads_no The number of threads used by the wide searches, 0 for
+ * one per online CPU, or 1 to do all the work on the calling thread.
+ * @return mk_err_t MK_OK or MK_ENOMEM.
+ */
+mk_err_t mk_create(mk_trie_t **trie, unsigned int threads_no);
+
+/**
+ * @brief Frees a dictionary and everything in it. A background load is
+ * stopped after its current chunk.
+ *
+ * @param trie The handle of the dictionary. It can be NULL.
+ */
+void mk_destroy(mk_trie_t *trie);
+
+/**
+ * @brief Inserts a word, or counts one more use of it if it already exists.
+ *
+ * @param trie The handle of the dictionary.
+ * @param word The word.
+ * @return mk_err_t MK_OK, MK_EINVAL, MK_ENOMEM or MK_EIO (the word was
+ * inserted, but it couldn't be journaled).
+ */
+mk_err_t mk_insert(mk_trie_t *trie, const char *word);
+
+/**
+ * @brief Removes a word. Removing a missing word is not an error.
+ *
+ * @param trie The handle of the dictionary.
+ * @param word The word.
+ * @return mk_err_t MK_OK, MK_EINVAL, MK_ENOMEM or MK_EIO (the word was
+ * removed, but it couldn't be journaled).
+ */
+mk_err_t mk_remove(mk_trie_t *trie, const char *word);
+
+/**
+ * @brief Inserts all the words of a text file. What isn't a word is skipped.
+ *
+ * @param trie The handle of the dictionary.
+ * @param filename The name of the file.
+ * @return mk_err_t MK_OK, MK_EIO or MK_ENOMEM. The words read before an
+ * error stay in the dictionary.
+ */
+mk_err_t mk_load(mk_trie_t *trie, const char *filename);
+
+/**
+ * @brief Inserts all the words of a text file, in the background. A thread
+ * reads the file in chunks of words, without the lock, and inserts every
+ * chunk under the writer lock, like mk_insert would, so the queries go on
+ * during the load, and they see the chunks inserted so far. What isn't a
+ * word is skipped. The progress is given by mk_load_status. A crash in the
+ * middle of the load keeps the chunks that were journaled.
+ *
+ * @param trie The handle of the dictionary.
+ * @param filename The name of the file.
+ * @return mk_err_t MK_OK if the load started, MK_EIO (the file can't be
+ * opened), MK_EINVAL (a background load is already running) or MK_ENOMEM.
+ * The errors of the load itself are given by mk_load_status.
+ */
+mk_err_t mk_load_async(mk_trie_t *trie, const char *filename);
+
+/**
+ * @brief Gets the progress of the last background load.
+ *
+ * @param trie The handle of the dictionary.
+ * @param status Where to store the progress.
+ */
+void mk_load_status(mk_trie_t *trie, mk_load_status_t *status);
+
+/**
+ * @brief Removes all the words of a text file, in a single pass. What isn't
+ * a word is skipped.
+ *
+ * @param trie The handle of the dictionary.
+ * @param filename The name of the file.
+ * @return mk_err_t MK_OK, MK_EIO or MK_ENOMEM.
+ */
+mk_err_t mk_remove_batch(mk_trie_t *trie, const char *filename);
+
+/**
+ * @brief Halves the weight of all the past uses of the words, in O(1).
+ *
+ * @param trie The handle of the dictionary.
+ * @return mk_err_t MK_OK or MK_EIO.
+ */
+mk_err_t mk_decay(mk_trie_t *trie);
+
+/**
+ * @brief Makes the dictionary decay by itself, after every period insertions.
+ *
+ * @param trie The handle of the dictionary.
+ * @param period The number of insertions between 2 decays, 0 to turn the
+ * automatic decay off.
+ * @return mk_err_t MK_OK or MK_EIO.
+ */
+mk_err_t mk_set_decay_period(mk_trie_t *trie, unsigned long period);
+
+/**
+ * @brief Recovers the dictionary from a journal directory, and journals all
+ * the updates that follow. The latest checkpoint is loaded, and only the
+ * updates made after it are replayed, so the recovery takes time
+ * proportional to the recent changes. The updates are synced in groups, and
+ * a group that doesn't fill up waits for mk_sync, so a crash loses only the
+ * updates made since the last mk_sync or the last full group; LOAD and
+ * REMOVE_BATCH are followed by a checkpoint, because their files can change.
+ *
+ * @param trie The handle of an empty dictionary.
+ * @param dir The journal directory. It must exist.
+ * @return mk_err_t MK_OK, MK_EINVAL (the dictionary isn't empty, it
+ * already has a journal, or it is tiered), MK_ENOMEM or MK_EIO. After an
+ * error, the dictionary may hold a part of the recovered words, so it should
+ * be destroyed.
+ */
+mk_err_t mk_open_journal(mk_trie_t *trie, const char *dir);
+
+/**
+ * @brief Keeps copy-on-write versions of the dictionary, for AUTOCORRECT.
+ * Every update copies the path to its word and publishes a new version; a
+ * search pins the latest version and reads it without the lock, so it sees
+ * a consistent dictionary while the updates go on. An old version is freed
+ * when its last search ends. The versions cost an extra copy of the
+ * dictionary, and they can't be turned off, except by mk_destroy.
+ *
+ * @param trie The handle of the dictionary.
+ * @return mk_err_t MK_OK, MK_EINVAL (a tiered dictionary) or MK_ENOMEM.
+ */
+mk_err_t mk_enable_snapshots(mk_trie_t *trie);
+
+/**
+ * @brief Splits the dictionary in 2 tiers: the words so far are frozen into
+ * a compact, read-only base, and the updates go to a small trie on top of
+ * it, the delta, as new words, removal marks and more uses of the base
+ * words. AUTOCOMPLETE, AUTOCORRECT and the lookups read both tiers, with the
+ * same results as a single trie. When the delta grows past merge_bytes, a
+ * background thread merges it into a new base, while a fresh delta takes
+ * the updates. The tiers can't be turned off, except by mk_destroy.
+ *
+ * A tiered dictionary has no journal, no snapshots, no suffix index, no
+ * frozen vocabulary and no memory ceiling, and it doesn't decode swipes or
+ * fuzzy completions (MK_EINVAL).
+ *
+ * @param trie The handle of the dictionary.
+ * @param merge_bytes The size of the delta that starts a merge, 0 for the
+ * default one (1 MiB).
+ * @return mk_err_t MK_OK, MK_EINVAL (already tiered, or it has a journal,
+ * snapshots, a suffix index, a frozen vocabulary or a memory ceiling) or
+ * MK_ENOMEM.
+ */
+mk_err_t mk_enable_tiers(mk_trie_t *trie, unsigned long merge_bytes);
+
+/**
+ * @brief Freezes the vocabulary: every word gets a dense id from a minimal
+ * perfect hash, and its uses are kept in an array indexed by id. The exact
+ * lookups of the frozen words (the updates of a word, the lookups of
+ * mk_lookup_batch) then take two hashes and a compare, instead of a walk
+ * down the trie. The words inserted later are walked, like before, until
+ * the next LOAD freezes the vocabulary again. The ids take about 22 bytes
+ * and the letters of every word, and they can't be turned off, except by
+ * mk_destroy.
+ *
+ * @param trie The handle of the dictionary.
+ * @return mk_err_t MK_OK, MK_EINVAL (a tiered dictionary) or MK_ENOMEM.
+ */
+mk_err_t mk_freeze_words(mk_trie_t *trie);
+
+/**
+ * @brief Counts the pairs of consecutive words of a text, for mk_predict.
+ * The pairs are kept by the ids of the frozen vocabulary, so the words have
+ * to be frozen first, and a pair with a word outside of it is skipped. The
+ * successors of every word are sorted, as the gaps between their ids, with
+ * their counts quantised to a byte, so a pair takes about 3 bytes. The
+ * pairs replace the ones of the last text, and they follow the words when
+ * the vocabulary is frozen again. They are not journaled, so they are
+ * counted again after a restart.
+ *
+ * @param trie The handle of the dictionary.
+ * @param filename The text, with the words separated by white space.
+ * @return mk_err_t MK_OK, MK_EINVAL (no frozen vocabulary), MK_EIO or
+ * MK_ENOMEM.
+ */
+mk_err_t mk_load_bigrams(mk_trie_t *trie, const char *filename);
+
+/**
+ * @brief Builds a suffix index of the dictionary, for mk_find_suffix and
+ * mk_find_infix: a trie of all the suffixes of all the words, where the
+ * node of a suffix lists the words it comes from. A query walks its string
+ * and reads just the words it gives back, so it takes time proportional to
+ * the length of the string plus the results, instead of a scan of the
+ * whole dictionary. Every update keeps the index in step, and LOAD and
+ * REMOVE_BATCH rebuild it. The index takes about as many nodes as the
+ * letters of all the words, so it can't be turned off, except by
+ * mk_destroy.
+ *
+ * @param trie The handle of the dictionary.
+ * @return mk_err_t MK_OK, MK_EINVAL (a tiered dictionary) or MK_ENOMEM.
+ */
+mk_err_t mk_enable_index(mk_trie_t *trie);
+
+/**
+ * @brief Sets a ceiling on the memory of the trie nodes. When an update goes
+ * over it, the rarely used words are evicted: each victim is the word with
+ * the lowest decayed frequency among a few random ones, so it is found
+ * without walking the trie. The word of the update itself is never evicted.
+ * The evictions are journaled like removals.
+ *
+ * @param trie The handle of the dictionary.
+ * @param bytes The ceiling, 0 for no limit. A lower one evicts words right
+ * away.
+ * @return mk_err_t MK_OK, MK_EINVAL (a tiered dictionary), MK_ENOMEM or
+ * MK_EIO (an eviction couldn't be journaled).
+ */
+mk_err_t mk_set_mem_limit(mk_trie_t *trie, unsigned long bytes);
+
+/**
+ * @brief Gives the size of the dictionary and the evictions made so far.
+ *
+ * @param trie The handle of the dictionary.
+ * @param stats Where to store the numbers.
+ */
+void mk_stats(mk_trie_t *trie, mk_stats_t *stats);
+
+/**
+ * @brief Writes a checkpoint of the dictionary and empties the journal.
+ *
+ * @param trie The handle of the dictionary.
+ * @return mk_err_t MK_OK, MK_EINVAL (there is no journal) or MK_EIO.
+ */
+mk_err_t mk_checkpoint(mk_trie_t *trie);
+
+/**
+ * @brief Writes and syncs the journaled updates that are waiting for their
+ * group. It should be called whenever no more updates are coming, like mk
+ * and mk_server do when they run out of commands, so an update doesn't wait
+ * for its group forever. It is cheap when nothing waits. mk_destroy does it
+ * too.
+ *
+ * @param trie The handle of the dictionary.
+ * @return mk_err_t MK_OK or MK_EIO.
+ */
+mk_err_t mk_sync(mk_trie_t *trie);
+
+/**
+ * @brief Gets the number of words in the dictionary.
+ *
+ * @param trie The handle of the dictionary.
+ * @return unsigned long The number of words.
+ */
+unsigned long mk_keys(mk_trie_t *trie);
+
+/**
+ * @brief Looks up many words at once. The lookups are interleaved, so their
+ * cache misses overlap, and a batch is much faster than the same words
+ * looked up one by one, on a dictionary bigger than the cache.
+ *
+ * @param trie The handle of the dictionary.
+ * @param words The words.
+ * @param words_no The number of words.
+ * @param freqs Where to store the number of uses of every word, 0 for the
+ * missing ones.
+ * @return mk_err_t MK_OK, MK_EINVAL or MK_ENOMEM.
+ */
+mk_err_t mk_lookup_batch(mk_trie_t *trie, const char **words,
+						 unsigned int words_no, unsigned long *freqs);
+
+/**
+ * @brief Finds the words as long as a given one, that differ from it by at
+ * most k letters. The words are written in lexicographic order, each one
+ * followed by '\n', and the whole list ends with '\0'.
+ *
+ * @param trie The handle of the dictionary.
+ * @param word The word we correct.
+ * @param k The maximum number of different letters.
+ * @param buff The caller's buffer.
+ * @param len The size of the buffer.
+ * @param needed Where to store the size the list needs, '\0' included. It
+ * is set even if the list doesn't fit.
+ * @return mk_err_t MK_OK, MK_ENOTFOUND, MK_EINVAL, MK_ENOMEM or MK_ERANGE.
+ */
+mk_err_t mk_autocorrect(mk_trie_t *trie, const char *word, unsigned int k,
+						char *buff, size_t len, size_t *needed);
+
+/**
+ * @brief Completes a prefix. Mode 1 gives the first word in lexicographic
+ * order, mode 2 the shortest one, mode 3 the most frequent one (recent uses
+ * weigh more), and mode 0 all of them, in this order. Every word is followed
+ * by '\n', and the list ends with '\0', so 3 * MK_WORD_MAX + 1 bytes are
+ * always enough.
+ *
+ * @param trie The handle of the dictionary.
+ * @param prefix The prefix.
+ * @param mode The mode, from 0 to 3.
+ * @param buff The caller's buffer.
+ * @param len The size of the buffer.
+ * @return mk_err_t MK_OK, MK_ENOTFOUND, MK_EINVAL or MK_ERANGE.
+ */
+mk_err_t mk_autocomplete(mk_trie_t *trie, const char *prefix,
+						 unsigned int mode, char *buff, size_t len);
+
+/**
+ * @brief Completes a prefix, like mk_autocomplete, and tells how the words
+ * were found. Every mode picks its own search: "descent" goes down to the
+ * first word, "levels" looks for the shortest word level by level, and
+ * "bounded" looks for the most frequent word, skipping the branches whose
+ * best score can't win. A small prefix subtrie in mode 0 is walked once
+ * for both the shortest and the most frequent word, with "scan". A big
+ * subtrie is split into tasks for the workers by "bounded" and "scan". A
+ * tiered dictionary reports no strategies.
+ *
+ * @param trie The handle of the dictionary.
+ * @param prefix The prefix.
+ * @param mode The mode, from 0 to 3.
+ * @param buff The caller's buffer.
+ * @param len The size of the buffer.
+ * @param plan Where to store the strategies that ran, with the nodes they
+ * visited and their tasks.
+ * @return mk_err_t MK_OK, MK_ENOTFOUND, MK_EINVAL or MK_ERANGE.
+ */
+mk_err_t mk_explain_autocomplete(mk_trie_t *trie, const char *prefix,
+								 unsigned int mode, char *buff, size_t len,
+								 mk_plan_t *plan);
+
+/**
+ * @brief Finds the n most frequent completions of a prefix that can be at
+ * most k edits away from the given one. The words are written from the most
+ * frequent, each one followed by '\n', and the list ends with '\0', so
+ * n * MK_WORD_MAX + 1 bytes are always enough.
+ *
+ * @param trie The handle of the dictionary.
+ * @param prefix The (maybe mistyped) prefix.
+ * @param k The maximum number of edits.
+ * @param n The maximum number of completions, at most MK_RESULTS_MAX.
+ * @param buff The caller's buffer.
+ * @param len The size of the buffer.
+ * @param needed Where to store the size the list needs, '\0' included. It
+ * is set even if the list doesn't fit.
+ * @return mk_err_t MK_OK, MK_ENOTFOUND, MK_EINVAL (or a tiered dictionary),
+ * MK_ENOMEM or MK_ERANGE.
+ */
+mk_err_t mk_autocomplete_fuzzy(mk_trie_t *trie, const char *prefix,
+							   unsigned int k, unsigned int n, char *buff,
+							   size_t len, size_t *needed);
+
+/**
+ * @brief Finds the words that match a pattern, in lexicographic order. '?'
+ * stands for any letter, '*' for any number of letters, none included, and
+ * a class like [aeiou], [a-f] or [^xyz] for one letter of the class, so
+ * "h?ll*" matches "hello" and "hall". The words are given to a callback as
+ * they are found, so a long list is never held in memory. The callback runs
+ * with the reader lock held, so it must not call the library on the same
+ * handle for an update.
+ *
+ * @param trie The handle of the dictionary.
+ * @param pattern The pattern, with at most 63 letters, classes and wildcards.
+ * @param limit The maximum number of words, 0 for all of them.
+ * @param found The callback, that gets every word and its arg. It ends the
+ * search by returning non-zero.
+ * @param arg The second argument of the callback.
+ * @param count Where to store the number of words found, or NULL.
+ * @return mk_err_t MK_OK, MK_ENOTFOUND or MK_EINVAL (an invalid pattern, or
+ * a tiered dictionary).
+ */
+mk_err_t mk_match(mk_trie_t *trie, const char *pattern, unsigned long limit,
+				  int (*found)(const char *word, void *arg), void *arg,
+				  unsigned long *count);
+
+/**
+ * @brief Finds the words that end with a string, in lexicographic order,
+ * with the suffix index. The words are given to a callback like in
+ * mk_match, with the reader lock held.
+ *
+ * @param trie The handle of the dictionary.
+ * @param suffix The string.
+ * @param limit The maximum number of words, 0 for all of them.
+ * @param found The callback, that gets every word and its arg. It ends the
+ * search by returning non-zero.
+ * @param arg The second argument of the callback.
+ * @param count Where to store the number of words found, or NULL.
+ * @return mk_err_t MK_OK, MK_ENOTFOUND, MK_EINVAL (an invalid string, or no
+ * suffix index) or MK_ENOMEM (the index missed an update for lack of
+ * memory, and the next update rebuilds it, or the words couldn't be
+ * sorted).
+ */
+mk_err_t mk_find_suffix(mk_trie_t *trie, const char *suffix,
+						unsigned long limit,
+						int (*found)(const char *word, void *arg), void *arg,
+						unsigned long *count);
+
+/**
+ * @brief Finds the words that contain a string anywhere, in lexicographic
+ * order, with the suffix index. Every word is given once, even if it holds
+ * the string more than once. The words are given to a callback like in
+ * mk_match, with the reader lock held.
+ *
+ * @param trie The handle of the dictionary.
+ * @param infix The string.
+ * @param limit The maximum number of words, 0 for all of them.
+ * @param found The callback, that gets every word and its arg. It ends the
+ * search by returning non-zero.
+ * @param arg The second argument of the callback.
+ * @param count Where to store the number of words found, or NULL.
+ * @return mk_err_t MK_OK, MK_ENOTFOUND, MK_EINVAL (an invalid string, or no
+ * suffix index) or MK_ENOMEM (the index missed an update for lack of
+ * memory, and the next update rebuilds it, or the words couldn't be
+ * sorted).
+ */
+mk_err_t mk_find_infix(mk_trie_t *trie, const char *infix,
+					   unsigned long limit,
+					   int (*found)(const char *word, void *arg), void *arg,
+					   unsigned long *count);
+
+/**
+ * @brief Predicts the next word, from the word before it and the prefix
+ * typed so far: the words that followed the previous word in the text of
+ * mk_load_bigrams and start with the prefix, the most frequent pairs
+ * first, then the most used words, then in lexicographic order. The words
+ * are given to a callback like in mk_match, with the reader lock held, with
+ * the count of their pair, within 25%.
+ *
+ * @param trie The handle of the dictionary.
+ * @param prev The previous word.
+ * @param prefix The prefix, NULL or "" for all the words that follow prev.
+ * @param n The maximum number of words, 0 for all of them.
+ * @param found The callback, that gets every word, its count and its arg.
+ * It ends the search by returning non-zero.
+ * @param arg The last argument of the callback.
+ * @param count Where to store the number of words found, or NULL.
+ * @return mk_err_t MK_OK, MK_ENOTFOUND, MK_EINVAL (an invalid word, or no
+ * bigrams) or MK_ENOMEM.
+ */
+mk_err_t mk_predict(mk_trie_t *trie, const char *prev, const char *prefix,
+					unsigned long n,
+					int (*found)(const char *word, unsigned long count,
+								 void *arg),
+					void *arg, unsigned long *count);
+
+/**
+ * @brief Starts a cursor over the words of a range, for mk_cursor_fetch. The
+ * cursor is a plain structure of the caller, it holds no resources, so it
+ * can be dropped at any time.
+ *
+ * @param cursor The cursor.
+ * @param from The first word of the range, included, NULL or "" to start
+ * with the first word of the dictionary. It doesn't have to be a word of the
+ * dictionary.
+ * @param to The end of the range, excluded, NULL or "" for no end.
+ * @return mk_err_t MK_OK or MK_EINVAL.
+ */
+mk_err_t mk_cursor_init(mk_cursor_t *cursor, const char *from, const char *to);
+
+/**
+ * @brief Gives the next words of a cursor, in lexicographic order, to a
+ * callback. Every fetch walks down to the last word given and goes on from
+ * there, with an explicit stack, so a listing of any size takes the same
+ * memory, and it can be paged through, or stopped and resumed later. The
+ * reader lock is held for a single fetch, so the updates made between two
+ * fetches are seen by the next ones, like in a scan without a snapshot. The
+ * callback runs with the reader lock held, like in mk_match.
+ *
+ * @param trie The handle of the dictionary.
+ * @param cursor The cursor, from mk_cursor_init.
+ * @param n The maximum number of words, 0 for all of them.
+ * @param found The callback, that gets every word, its number of uses and
+ * its arg. It ends the fetch by returning non-zero, and the next fetch goes
+ * on after that word.
+ * @param arg The third argument of the callback.
+ * @param count Where to store the number of words given, or NULL.
+ * @return mk_err_t MK_OK, MK_ENOTFOUND (no words left in the range) or
+ * MK_EINVAL (a tiered dictionary).
+ */
+mk_err_t mk_cursor_fetch(mk_trie_t *trie, mk_cursor_t *cursor,
+						 unsigned long n,
+						 int (*found)(const char *word, unsigned long freq,
+									  void *arg),
+						 void *arg, unsigned long *count);
+
+/**
+ * @brief Decodes a swipe over a QWERTY keyboard into the n best words. The
+ * coordinates are in key widths: the centre of 'q' is at (0, 0), 'a' is at
+ * (0.5, 1) and 'z' is at (1.5, 2). A word must start near the first point
+ * and end near the last one, and its letters must be passed over in order.
+ *
+ * @param trie The handle of the dictionary.
+ * @param points The touch samples of the swipe, x and y for each one.
+ * @param points_no The number of samples, from 1 to 256.
+ * @param n The number of words wanted, at most MK_RESULTS_MAX.
+ * @param buff Where to write the words, the best first.
+ * @param len The size of the buffer.
+ * @param needed Where to store the size the words need, '\0' included.
+ * @return mk_err_t MK_OK, MK_ENOTFOUND, MK_EINVAL (or a tiered dictionary),
+ * MK_ENOMEM or MK_ERANGE.
+ */
+mk_err_t mk_swipe(mk_trie_t *trie, const double *points,
+				  unsigned int points_no, unsigned int n, char *buff,
+				  size_t len, size_t *needed);
+
+/**
+ * The functions below give every user a view of the dictionary with the
+ * user's own changes: the words the user inserted, with their own
+ * frequencies, and without the words the user removed. Only the changes are
+ * stored, a few bytes for each, so a process can hold many users. A user
+ * without changes sees the shared dictionary. The changes are not journaled,
+ * and a tiered dictionary doesn't have them (MK_EINVAL).
+ */
+
+/**
+ * @brief Inserts a word for a user, or counts one more use of it. A shared
+ * word starts from its shared number of uses.
+ *
+ * @param trie The handle of the dictionary.
+ * @param user The id of the user.
+ * @param word The word.
+ * @return mk_err_t MK_OK, MK_EINVAL or MK_ENOMEM.
+ */
+mk_err_t mk_user_insert(mk_trie_t *trie, unsigned long user,
+						const char *word);
+
+/**
+ * @brief Removes a word for a user. The other users still see it.
+ *
+ * @param trie The handle of the dictionary.
+ * @param user The id of the user.
+ * @param word The word.
+ * @return mk_err_t MK_OK, MK_EINVAL or MK_ENOMEM.
+ */
+mk_err_t mk_user_remove(mk_trie_t *trie, unsigned long user,
+						const char *word);
+
+/**
+ * @brief Forgets all the changes of a user.
+ *
+ * @param trie The handle of the dictionary.
+ * @param user The id of the user.
+ */
+void mk_user_drop(mk_trie_t *trie, unsigned long user);
+
+/**
+ * @brief Like mk_autocorrect, but with the changes of a user.
+ *
+ * @param trie The handle of the dictionary.
+ * @param user The id of the user.
+ * @param word The word we correct.
+ * @param k The maximum number of different letters.
+ * @param buff The caller's buffer.
+ * @param len The size of the buffer.
+ * @param needed Where to store the size the list needs, '\0' included.
+ * @return mk_err_t MK_OK, MK_ENOTFOUND, MK_EINVAL, MK_ENOMEM or MK_ERANGE.
+ */
+mk_err_t mk_user_autocorrect(mk_trie_t *trie, unsigned long user,
+							 const char *word, unsigned int k, char *buff,
+							 size_t len, size_t *needed);
+
+/**
+ * @brief Like mk_autocomplete, but with the changes of a user.
+ *
+ * @param trie The handle of the dictionary.
+ * @param user The id of the user.
+ * @param prefix The prefix.
+ * @param mode The mode, from 0 to 3.
+ * @param buff The caller's buffer.
+ * @param len The size of the buffer.
+ * @return mk_err_t MK_OK, MK_ENOTFOUND, MK_EINVAL or MK_ERANGE.
+ */
+mk_err_t mk_user_autocomplete(mk_trie_t *trie, unsigned long user,
+							  const char *prefix, unsigned int mode,
+							  char *buff, size_t len);
+
+/**
+ * @brief Gives the name of an AUTOCOMPLETE strategy, as counted by mk_stats.
+ *
+ * @param strategy The strategy, from 0 to MK_STRATEGIES - 1.
+ * @return const char* A static name, or NULL for an invalid strategy.
+ */
+const char *mk_strategy_name(unsigned int strategy);
+
+/**
+ * @brief Describes an error code.
+ *
+ * @param err The error code.
+ * @return const char* A static message.
+ */
+const char *mk_strerror(mk_err_t err);
+
+#endif  // LIBMK_H_
@@ -29,7 +29,8 @@ u8_t k_different_word(char *word1, size_t word1_len, char *word2,
 }
 
 void search_kdiff_words(g_node_t *root, char *buff, size_t bufflen, char *word,
-						size_t wordlen, unsigned int k, unsigned int *found)
+						size_t wordlen, unsigned int k, unsigned int *found,
+						FILE *out)
 {
 	/**
 	 * If the words are already too different, it should stop searching on
@@ -52,7 +53,7 @@ void search_kdiff_words(g_node_t *root, char *buff, size_t bufflen, char *word,
 		buff[bufflen] = '\0';
 
 		if (difference == 1 && bufflen == wordlen) {
-			printf("%s\n", buff);
+			fprintf(out, "%s\n", buff);
 			*found = *found + 1;
 			return;
 		}
@@ -62,12 +63,12 @@ void search_kdiff_words(g_node_t *root, char *buff, size_t bufflen, char *word,
 	 * Search through the all possible combinations
 	 */
 	for (unsigned int i = 0; i < ALPH; i++) {
-		if (root->children[i]) {
+		if (has_live_keys(root->children[i])) {
 			char c = i + 'a';
 			buff[bufflen] = c;
 
 			search_kdiff_words(root->children[i], buff, bufflen + 1, word,
-							   wordlen, k, found);
+							   wordlen, k, found, out);
 		}
 	}
 }
@@ -84,10 +85,10 @@ u8_t check_prefix(g_node_t *root, char *prefix, unsigned int prefix_idx)
 		return 1;
 
 	/**
-	 * If the specific children isn't allocated, there is no chance the prefix
-	 * exists
+	 * If the specific children isn't allocated, or all its keys were removed,
+	 * there is no chance the prefix exists
 	 */
-	if (!root->children[c - 'a'])
+	if (!has_live_keys(root->children[c - 'a']))
 		return 0;
 
 	prefix_idx++;
@@ -107,224 +108,385 @@ g_node_t *get_end_of_prefix(g_node_t *root, char *prefix,
 
 	prefix_idx++;
 
-	if (!root->children[c - 'a'])
+	if (!has_live_keys(root->children[c - 'a']))
 		return NULL;
 
 	return get_end_of_prefix(root->children[c - 'a'], prefix, prefix_idx);
 }
 
-void print_first_combination(g_node_t *root)
+g_node_t *get_first_combination(g_node_t *root)
 {
 	/**
 	 * Stop when it meets the first END node
 	 */
 	if (((key_t *)root->data)->ending == END)
-		return;
+		return root;
 
 	for (unsigned int i = 0; i < ALPH; i++) {
 		/**
-		 * Search for the first allocated children, then break, to find
+		 * Search for the first allocated children, then stop, to find
 		 * just the first combination
 		 */
-		if (root->children[i]) {
-			char c = i + 'a';
-			printf("%c", c);
-			print_first_combination(root->children[i]);
-			break;
-		}
+		if (has_live_keys(root->children[i]))
+			return get_first_combination(root->children[i]);
 	}
+
+	return root;
 }
 
-void print_most_lexic(g_node_t *prefix_end, char *prefix)
+void parallel_searching(g_node_t *root, g_node_t **shortest,
+						g_node_t **frequent, unsigned int epoch)
 {
+	u64_t curr_score = key_score((key_t *)root->data, epoch);
+	size_t curr_len = ((key_t *)root->data)->key_len;
+
+	size_t shortest_len = ((key_t *)((*shortest)->data))->key_len;
+
 	/**
-	 * Check if the prefix exists. If it doesn't exists, the prefix_end
-	 * pointer will be NULL
+	 * Only the ends of the keys compete, even with a score of 0. The first
+	 * one in lexicographic order is taken as it is, the next ones have to
+	 * beat it strictly, so the ties go to the first one. An end of a word
+	 * doesn't stop the search, because it could have a bigger word
+	 * overlapping.
 	 */
-	if (!prefix_end) {
-		printf("No words found\n");
-		return;
+	if (((key_t *)root->data)->ending == END) {
+		if (!*frequent ||
+			curr_score > key_score((key_t *)((*frequent)->data), epoch))
+			*frequent = root;
+
+		if (curr_len < shortest_len)
+			*shortest = root;
 	}
 
-	/**
-	 * Print the part of the key that we already have
-	 */
-	printf("%s", prefix);
+	for (unsigned int i = 0; i < ALPH; i++) {
+		if (has_live_keys(root->children[i]))
+			parallel_searching(root->children[i], shortest, frequent, epoch);
+	}
+}
 
-	/**
-	 * Print the rest of the key
-	 */
-	print_first_combination(prefix_end);
-	printf("\n");
+void rank_subtrie(g_node_t *root, heap_t *heap, unsigned int epoch)
+{
+	if (((key_t *)root->data)->ending == END)
+		heap_offer(heap, root, key_score((key_t *)root->data, epoch));
+
+	for (unsigned int i = 0; i < ALPH; i++) {
+		if (has_live_keys(root->children[i]))
+			rank_subtrie(root->children[i], heap, epoch);
+	}
 }
 
-g_node_t *get_shortestdist_node(g_node_t *root, g_node_t *node)
+void search_fuzzy_prefix(g_node_t *root, char *prefix, size_t prefix_len,
+						 size_t *row, unsigned int k, heap_t *heap,
+						 unsigned int epoch)
 {
 	/**
-	 * If it reaches the end of a key, return the node associated with the
-	 * shortest distance
+	 * row[j] is the edit distance between the path to this node and the
+	 * first j letters of the prefix. If the whole prefix is close enough,
+	 * every key below is a completion, and the deeper matches are in the same
+	 * subtrie, so there is no need to go further. That's why no subtrie is
+	 * ranked twice.
 	 */
-	if (((key_t *)root->data)->ending == END) {
-		if (((key_t *)root->data)->key_len < ((key_t *)node->data)->key_len)
-			node = root;
+	if (row[prefix_len] <= k) {
+		rank_subtrie(root, heap, epoch);
+		return;
+	}
 
-		return node;
+	/**
+	 * If every cell is bigger than k, no continuation can get back under it
+	 */
+	size_t best = row[0];
+	for (size_t j = 1; j <= prefix_len; j++) {
+		if (row[j] < best)
+			best = row[j];
 	}
 
+	if (best > k)
+		return;
+
+	size_t next[MAX_STR + 1];
 	for (unsigned int i = 0; i < ALPH; i++) {
-		if (root->children[i])
-			node = get_shortestdist_node(root->children[i], node);
-	}
+		if (!has_live_keys(root->children[i]))
+			continue;
+
+		char c = i + 'a';
+
+		/**
+		 * The usual Levenshtein recurrence, one row per trie level
+		 */
+		next[0] = row[0] + 1;
+		for (size_t j = 1; j <= prefix_len; j++) {
+			size_t cost = row[j - 1] + (prefix[j - 1] != c);
+
+			if (row[j] + 1 < cost)
+				cost = row[j] + 1;
+
+			if (next[j - 1] + 1 < cost)
+				cost = next[j - 1] + 1;
 
-	return node;
+			next[j] = cost;
+		}
+
+		search_fuzzy_prefix(root->children[i], prefix, prefix_len, next, k,
+							heap, epoch);
+	}
 }
 
-void print_shortest_key(g_node_t *prefix_end)
+g_node_t **get_fuzzy_completions(g_node_t *root, char *prefix,
+								 unsigned int k, unsigned int n,
+								 unsigned int epoch, unsigned int *count)
 {
-	if (!prefix_end) {
-		printf("No words found\n");
-		return;
+	size_t prefix_len = strlen(prefix);
+	size_t row[MAX_STR + 1];
+
+	/**
+	 * The root is the empty string, j edits away from the first j letters
+	 */
+	for (size_t j = 0; j <= prefix_len; j++)
+		row[j] = j;
+
+	/**
+	 * There are never more completions than live keys, so a huge n doesn't
+	 * allocate more than the trie could fill
+	 */
+	if (n > ((key_t *)root->data)->subkeys)
+		n = ((key_t *)root->data)->subkeys;
+
+	heap_t *heap = create_heap(n);
+	if (!heap)
+		return NULL;
+
+	g_node_t **best = (g_node_t **)malloc(((size_t)n + 1) *
+										  sizeof(g_node_t *));
+	if (!best) {
+		free_heap(heap);
+		return NULL;
 	}
 
-	g_node_t *key_end = get_shortestdist_node(prefix_end, prefix_end);
+	search_fuzzy_prefix(root, prefix, prefix_len, row, k, heap, epoch);
+	*count = heap_drain(heap, best);
 
-	char buff[MAX_BUFF];
-	print_word_from_end(key_end, buff, 0);
+	free_heap(heap);
+	return best;
 }
 
-g_node_t *get_maxfrequency_node(g_node_t *root, g_node_t *node)
+void get_word_from_end(g_node_t *end, char *buff)
 {
 	/**
-	 * If it reaches a leaf, return the node associated with the maximum
-	 * frequency key
+	 * Count the letters first, so the word can be written from its last
+	 * letter to the first one, while going from parent to parent
 	 */
-	if (root->children_num == 0) {
-		if (((key_t *)root->data)->freq > ((key_t *)node->data)->freq)
-			node = root;
-
-		return node;
+	unsigned int len = 0;
+	for (g_node_t *node = end; ((key_t *)node->data)->ending != ROOT;
+		 node = node->parent)
+		len++;
+
+	buff[len] = '\0';
+	for (g_node_t *node = end; ((key_t *)node->data)->ending != ROOT;
+		 node = node->parent) {
+		len--;
+		buff[len] = ((key_t *)node->data)->key;
 	}
+}
+
+void o_root(g_node_t *root, o_overlay_t *overlay, o_pos_t *pos)
+{
+	pos->node = root;
+	pos->lo = 0;
+	pos->hi = overlay ? overlay->entries_no : 0;
+	pos->depth = 0;
+}
+
+u8_t o_child(o_overlay_t *overlay, o_pos_t *pos, char c, o_pos_t *child)
+{
+	child->node = pos->node ? pos->node->children[c - 'a'] : NULL;
+	child->depth = pos->depth + 1;
 
 	/**
-	 * If is just the end of a word, continue searching, because it could have
-	 * a bigger word overlapping
+	 * The entries of the position share its prefix, and they are sorted, so
+	 * the ones followed by c are adjacent. Two binary searches find them.
 	 */
-	if (((key_t *)root->data)->ending == END) {
-		if (((key_t *)root->data)->freq > ((key_t *)node->data)->freq)
-			node = root;
+	u32_t lo = pos->lo, hi = pos->hi;
+	while (lo < hi) {
+		u32_t mid = lo + (hi - lo) / 2;
+		if (overlay->entries[mid].word[pos->depth] < c)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
-
-	for (unsigned int i = 0; i < ALPH; i++) {
-		if (root->children[i])
-			node = get_maxfrequency_node(root->children[i], node);
+	child->lo = lo;
+
+	hi = pos->hi;
+	while (lo < hi) {
+		u32_t mid = lo + (hi - lo) / 2;
+		if (overlay->entries[mid].word[pos->depth] <= c)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
+	child->hi = lo;
 
-	return node;
+	return child->node || child->lo < child->hi;
 }
 
-void print_maxfreq_key(g_node_t *prefix_end)
+u8_t o_get_key(o_overlay_t *overlay, o_pos_t *pos, key_t *rec)
 {
-	if (!prefix_end) {
-		printf("No words found\n");
-		return;
+	/**
+	 * The entry of the prefix itself sorts first, before its extensions
+	 */
+	if (pos->lo < pos->hi &&
+		overlay->entries[pos->lo].word[pos->depth] == '\0') {
+		o_entry_t *entry = &overlay->entries[pos->lo];
+		if (entry->state == TOMB)
+			return 0;
+
+		rec->freq = entry->freq;
+		rec->score = entry->score;
+		rec->epoch = entry->epoch;
+		rec->key_len = pos->depth;
+		return 1;
 	}
 
-	g_node_t *key_end = get_maxfrequency_node(prefix_end, prefix_end);
+	if (!pos->node || ((key_t *)pos->node->data)->ending != END)
+		return 0;
 
-	char buff[MAX_BUFF];
-	print_word_from_end(key_end, buff, 0);
+	*rec = *(key_t *)pos->node->data;
+	return 1;
 }
 
-void parallel_searching(g_node_t *root, g_node_t **shortest,
-						g_node_t **frequent)
+u8_t o_has_live_keys(o_overlay_t *overlay, o_pos_t *pos)
 {
+	u64_t base_live = pos->node ? ((key_t *)pos->node->data)->subkeys : 0;
+	if (pos->lo == pos->hi)
+		return base_live > 0;
+
 	/**
-	 * This functions combines the get_shortestdist_node with the
-	 * get_maxfrequency_node, without coming with new ideas. The only
-	 * difference is that it comes back from recursion only if it reaches
-	 * a leaf
+	 * A word of the user is always live. Otherwise, the TOMB entries are
+	 * an upper bound of the hidden shared words, and only when it is not
+	 * enough they are checked one by one.
 	 */
+	u64_t tombs = 0;
+	for (u32_t i = pos->lo; i < pos->hi; i++) {
+		if (overlay->entries[i].state == END)
+			return 1;
 
-	s32_t curr_freq = ((key_t *)root->data)->freq;
-	size_t curr_len = ((key_t *)root->data)->key_len;
-
-	size_t shortest_len = ((key_t *)((*shortest)->data))->key_len;
-	s32_t max_freq = ((key_t *)((*frequent)->data))->freq;
+		tombs++;
+	}
 
-	if (root->children_num == 0) {
-		if (curr_freq > max_freq)
-			*frequent = root;
+	if (base_live > tombs)
+		return 1;
 
-		if (curr_len < shortest_len)
-			*shortest = root;
+	if (base_live == 0)
+		return 0;
 
-		return;
+	u64_t hidden = 0;
+	for (u32_t i = pos->lo; i < pos->hi; i++) {
+		if (get_ending_node(pos->node, overlay->entries[i].word + pos->depth))
+			hidden++;
 	}
 
-	if (((key_t *)root->data)->ending == END) {
-		if (curr_freq > max_freq)
-			*frequent = root;
+	return base_live > hidden;
+}
 
-		if (curr_len < shortest_len)
-			*shortest = root;
-	}
+u8_t o_get_end_of_prefix(g_node_t *root, o_overlay_t *overlay, char *prefix,
+						 o_pos_t *pos)
+{
+	o_root(root, overlay, pos);
 
-	for (unsigned int i = 0; i < ALPH; i++) {
-		if (root->children[i])
-			parallel_searching(root->children[i], shortest, frequent);
+	for (; *prefix != '\0'; prefix++) {
+		o_pos_t child;
+		if (!o_child(overlay, pos, *prefix, &child) ||
+			!o_has_live_keys(overlay, &child))
+			return 0;
+
+		*pos = child;
 	}
+
+	return 1;
 }
 
-void print_parallel_search_result(g_node_t *prefix_end)
+void o_search_kdiff_words(o_overlay_t *overlay, o_pos_t *pos, char *buff,
+						  size_t bufflen, char *word, size_t wordlen,
+						  unsigned int k, unsigned int *found, FILE *out)
 {
-	if (!prefix_end) {
-		printf("No words found\n");
-		printf("No words found\n");
+	u8_t difference = k_different_word(buff, bufflen, word, wordlen, k);
+	if (difference == 0)
 		return;
-	}
 
-	g_node_t *shortest = prefix_end;
-	g_node_t *frequent = prefix_end;
-	parallel_searching(prefix_end, &shortest, &frequent);
+	if (bufflen > wordlen)
+		return;
 
-	char buff[MAX_BUFF];
-	print_word_from_end(shortest, buff, 0);
-	print_word_from_end(frequent, buff, 0);
-}
+	key_t rec;
+	if (o_get_key(overlay, pos, &rec)) {
+		buff[bufflen] = '\0';
 
-void print_word_from_end(g_node_t *end, char *buff, unsigned int buff_idx)
-{
-	/**
-	 * If it reaches the root, the complete word is in buffer, so I should add
-	 * '\0' at the end, and print it in reverse order
-	 */
-	if (((key_t *)end->data)->ending == ROOT) {
-		buff[buff_idx] = '\0';
-		str_print_reverse(buff, buff_idx);
+		if (difference == 1 && bufflen == wordlen) {
+			fprintf(out, "%s\n", buff);
+			*found = *found + 1;
+			return;
+		}
+	}
 
-		return;
+	for (unsigned int i = 0; i < ALPH; i++) {
+		o_pos_t child;
+		if (o_child(overlay, pos, i + 'a', &child) &&
+			o_has_live_keys(overlay, &child)) {
+			buff[bufflen] = i + 'a';
+			o_search_kdiff_words(overlay, &child, buff, bufflen + 1, word,
+								 wordlen, k, found, out);
+		}
 	}
+}
 
-	char c = ((key_t *)end->data)->key;
-	buff[buff_idx] = c;
-	buff_idx++;
+void o_first_word(o_overlay_t *overlay, o_pos_t *pos, char *buff)
+{
+	key_t rec;
+	buff[pos->depth] = '\0';
+	if (o_get_key(overlay, pos, &rec))
+		return;
 
-	/**
-	 * Go from parent to parent until it reaches the root
-	 */
-	print_word_from_end(end->parent, buff, buff_idx);
+	for (unsigned int i = 0; i < ALPH; i++) {
+		o_pos_t child;
+		if (o_child(overlay, pos, i + 'a', &child) &&
+			o_has_live_keys(overlay, &child)) {
+			buff[pos->depth] = i + 'a';
+			o_first_word(overlay, &child, buff);
+			return;
+		}
+	}
 }
 
-void str_print_reverse(char *buff, unsigned int buff_idx)
+void o_best_words(o_overlay_t *overlay, o_pos_t *pos, char *buff,
+				  unsigned int epoch, char *shortest, size_t *shortest_len,
+				  char *frequent, u64_t *max_score)
 {
-	/**
-	 * Print char by char from right to left (I mean from the end to
-	 * the begging)
-	 */
-	while (buff_idx > 0) {
-		printf("%c", buff[buff_idx - 1]);
-		buff_idx--;
+	key_t rec;
+	if (o_get_key(overlay, pos, &rec)) {
+		buff[pos->depth] = '\0';
+		u64_t score = key_score(&rec, epoch);
+
+		/**
+		 * The first word is taken as it is, then only a strictly better word
+		 * replaces the best one, so the first one in lexicographic order
+		 * wins the ties, like in parallel_searching
+		 */
+		if (frequent[0] == '\0' || score > *max_score) {
+			*max_score = score;
+			strcpy(frequent, buff);
+		}
+
+		if (pos->depth < *shortest_len) {
+			*shortest_len = pos->depth;
+			strcpy(shortest, buff);
+		}
 	}
 
-	printf("\n");
+	for (unsigned int i = 0; i < ALPH; i++) {
+		o_pos_t child;
+		if (o_child(overlay, pos, i + 'a', &child) &&
+			o_has_live_keys(overlay, &child)) {
+			buff[pos->depth] = i + 'a';
+			o_best_words(overlay, &child, buff, epoch, shortest, shortest_len,
+						 frequent, max_score);
+		}
+	}
 }
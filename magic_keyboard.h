@@ -7,6 +7,7 @@
 #include "utils.h"
 #include "structs.h"
 #include "generic_tree.h"
+#include "heap.h"
 
 /**
  * @brief Checks if 2 words are different by maximum k characters
@@ -33,9 +34,11 @@ uint8_t k_different_word(char *word1, size_t word1_len, char *word2,
  * @param wordlen The word length
  * @param k The k number (maximum letters)
  * @param found The number of words found
+ * @param out The file where the words are printed
  */
 void search_kdiff_words(g_node_t *root, char *buff, size_t bufflen, char *word,
-						size_t wordlen, unsigned int k, unsigned int *found);
+						size_t wordlen, unsigned int k, unsigned int *found,
+						FILE *out);
 /**
  * @brief Checks if a prefix exists in the trie.
  *
@@ -63,90 +66,190 @@ g_node_t *get_end_of_prefix(g_node_t *root, char *prefix,
 							unsigned int prefix_idx);
 
 /**
- * @brief Prints the first word it find in a subtrie.
+ * @brief Gets the first word in a subtrie, in lexicographic order. If the
+ * root of the subtrie is an ending, it is the first word.
+ *
+ * @param root The root of the subtrie. It must have live keys.
+ * @return g_node_t* Returns the ending node of the first word.
+ */
+g_node_t *get_first_combination(g_node_t *root);
+
+/**
+ * @brief Finds the ending nodes of the shortest key and of the key with the
+ * maximum frequency in a subtrie, in a single walk. The keys are ranked by
+ * their decayed score, so the recent uses weigh more than the old ones.
+ *
+ * @param root The root of the subtrie where we search.
+ * @param shortest Address of a node where to store the shortest key node.
+ * @param frequent Address of a node where to store the frequent key node,
+ * that holds NULL at first. A key beats it only with a bigger score, so the
+ * ties go to the first key in lexicographic order, even when all the scores
+ * decayed to 0.
+ * @param epoch The current decay epoch of the trie.
+ */
+void parallel_searching(g_node_t *root, g_node_t **shortest,
+						g_node_t **frequent, unsigned int epoch);
+
+/**
+ * @brief Offers all the keys of a subtrie to a bounded heap, ranked by their
+ * decayed score.
  *
  * @param root The root of the subtrie.
+ * @param heap The heap that keeps the best keys.
+ * @param epoch The current decay epoch of the trie.
+ */
+void rank_subtrie(g_node_t *root, heap_t *heap, unsigned int epoch);
+
+/**
+ * @brief Searches for the nodes whose path is at most k edits away from a
+ * prefix, and ranks the keys below them. It is the same idea as in
+ * search_kdiff_words, but with the edit distance instead of the number of
+ * different letters, so the mistyped, missing or extra letters are accepted.
+ *
+ * @param root The root of the trie / subtrie.
+ * @param prefix The (maybe mistyped) prefix.
+ * @param prefix_len The length of the prefix.
+ * @param row The edit distances between the path to root and every prefix
+ * of the prefix, prefix_len + 1 values.
+ * @param k The maximum number of edits.
+ * @param heap The heap that keeps the best completions.
+ * @param epoch The current decay epoch of the trie.
  */
-void print_first_combination(g_node_t *root);
+void search_fuzzy_prefix(g_node_t *root, char *prefix, size_t prefix_len,
+						 size_t *row, unsigned int k, heap_t *heap,
+						 unsigned int epoch);
 
 /**
- * @brief Prints the first lexicographic word that exists in the trie, with
- * the given prefix. It prints an error if there is no such a word.
+ * @brief Gets the n most frequent completions of a prefix that can be at
+ * most k edits away from what the user typed.
  *
- * @param prefix_end The node where the prefix ends.
+ * @param root The root of the trie.
  * @param prefix The prefix as a string.
+ * @param k The maximum number of edits.
+ * @param n The maximum number of completions. More than the live keys of the
+ * trie are never kept.
+ * @param epoch The current decay epoch of the trie.
+ * @param count Where to store the number of completions found.
+ * @return g_node_t** Returns an array with the ending nodes of the
+ * completions, from the most frequent to the least, that must be freed by
+ * the caller, or NULL if there is no memory left.
  */
-void print_most_lexic(g_node_t *prefix_end, char *prefix);
+g_node_t **get_fuzzy_completions(g_node_t *root, char *prefix,
+								 unsigned int k, unsigned int n,
+								 unsigned int epoch, unsigned int *count);
 
 /**
- * @brief Get the ending node of the shortest word in a subtrie.
+ * @brief Writes a word into a buffer, starting from the ending node of the
+ * word.
  *
- * @param root The root of the subtrie.
- * @param node A prediction for the node with the shortest key length.
- * @return g_node_t* Returns the ending node of the shortest key in the
- * subtrie.
+ * @param end The ending node of the key.
+ * @param buff The buffer, with room for MAX_BUFF characters.
  */
-g_node_t *get_shortestdist_node(g_node_t *root, g_node_t *node);
+void get_word_from_end(g_node_t *end, char *buff);
 
 /**
- * @brief Prints the shortest key with the prefix ending with node prefix_end.
+ * The functions below walk the shared trie and the overlay of a user at the
+ * same time, as if the changes of the user were made in the trie. A
+ * position is a node of the trie, or NULL, and the range of the overlay
+ * entries that start with the same prefix. The entry of a word wins over
+ * the node of the word.
+ */
+
+/**
+ * @brief Gets the position of the root.
  *
- * @param prefix_end The ending node of the prefix
+ * @param root The root of the trie.
+ * @param overlay The overlay of the user, or NULL.
+ * @param pos Where to store the position.
  */
-void print_shortest_key(g_node_t *prefix_end);
+void o_root(g_node_t *root, o_overlay_t *overlay, o_pos_t *pos);
 
 /**
- * @brief Gets the node of the maximum frequency key.
+ * @brief Moves from a position to one of its children.
  *
- * @param root The root of the subtrie where the node is searched.
- * @param node An initial prediction (it can be very bad, actually it can
- * be just the root), to have a starting point.
- * @return g_node_t* Returns the ending node of the key that was inserted the
- * most.
+ * @param overlay The overlay of the user.
+ * @param pos The position.
+ * @param c The letter of the child.
+ * @param child Where to store the position of the child.
+ * @return u8_t 1 if the trie or the overlay has the child, 0 otherwise.
  */
-g_node_t *get_maxfrequency_node(g_node_t *root, g_node_t *node);
+u8_t o_child(o_overlay_t *overlay, o_pos_t *pos, char c, o_pos_t *child);
 
 /**
- * @brief Prints the key with the maximum frequency with a given prefix.
+ * @brief Gets the key that ends at a position, as the user sees it.
  *
- * @param prefix_end The node where the prefix ends.
+ * @param overlay The overlay of the user.
+ * @param pos The position.
+ * @param rec Where to store the frequency and the score of the key.
+ * @return u8_t 1 if a key ends at the position, 0 otherwise.
  */
-void print_maxfreq_key(g_node_t *prefix_end);
+u8_t o_get_key(o_overlay_t *overlay, o_pos_t *pos, key_t *rec);
 
 /**
- * @brief Performs the get_maxfrequency_node and get_shortestdist_node at the
- * same time, for a better time of execution, in case we need both.
+ * @brief Checks if the user sees any key under a position, like
+ * has_live_keys.
  *
- * @param root The root of the subtrie where we search.
- * @param shortest Address of a node where to store the shortest key node.
- * @param frequent Address of a node where to store the frequent key node.
+ * @param overlay The overlay of the user.
+ * @param pos The position.
+ * @return u8_t 1 if there is a key, 0 otherwise.
  */
-void parallel_searching(g_node_t *root, g_node_t **shortest,
-						g_node_t **frequent);
+u8_t o_has_live_keys(o_overlay_t *overlay, o_pos_t *pos);
 
 /**
- * @brief Prints the result of parallel searching.
+ * @brief Gets the position of the end of a prefix, like get_end_of_prefix.
  *
- * @param prefix_end The node where the prefix ends, the point where the
- * parallel searching starts.
+ * @param root The root of the trie.
+ * @param overlay The overlay of the user, or NULL.
+ * @param prefix The prefix.
+ * @param pos Where to store the position.
+ * @return u8_t 1 if the user sees a key that starts with the prefix, 0
+ * otherwise.
  */
-void print_parallel_search_result(g_node_t *prefix_end);
+u8_t o_get_end_of_prefix(g_node_t *root, o_overlay_t *overlay, char *prefix,
+						 o_pos_t *pos);
 
 /**
- * @brief Prints a string in reverse order.
+ * @brief Searches for k-different words, like search_kdiff_words.
  *
- * @param buff The buffer where the string is stored.
- * @param buff_idx The buffer / string length, but it is used as an decreasing
- * index.
+ * @param overlay The overlay of the user.
+ * @param pos The position where the search starts.
+ * @param buff A buffer, with the letters of the path to the position.
+ * @param bufflen The number of letters in the buffer.
+ * @param word The word we correct.
+ * @param wordlen The length of the word.
+ * @param k The maximum number of different letters.
+ * @param found The number of words found.
+ * @param out The file where the words are printed.
  */
-void str_print_reverse(char *buff, unsigned int buff_idx);
+void o_search_kdiff_words(o_overlay_t *overlay, o_pos_t *pos, char *buff,
+						  size_t bufflen, char *word, size_t wordlen,
+						  unsigned int k, unsigned int *found, FILE *out);
 
 /**
- * @brief Prints a word starting from the ending node of the word.
+ * @brief Gets the first word under a position, like get_first_combination.
  *
- * @param end The ending node of the key.
- * @param buff A temporarily buffer to store the key.
- * @param buff_idx The index for the buffer.
+ * @param overlay The overlay of the user.
+ * @param pos The position, it must have live keys.
+ * @param buff A buffer, with the letters of the path to the position, where
+ * the word is completed.
  */
-void print_word_from_end(g_node_t *end, char *buff, unsigned int buff_idx);
+void o_first_word(o_overlay_t *overlay, o_pos_t *pos, char *buff);
+
+/**
+ * @brief Finds the shortest and the most frequent words under a position,
+ * like parallel_searching. Only the words compete, never the prefix itself.
+ *
+ * @param overlay The overlay of the user.
+ * @param pos The position.
+ * @param buff A buffer, with the letters of the path to the position.
+ * @param epoch The current decay epoch of the trie.
+ * @param shortest The shortest word.
+ * @param shortest_len The length of the shortest word, INF at first.
+ * @param frequent The most frequent word, empty at first.
+ * @param max_score The score of the most frequent word.
+ */
+void o_best_words(o_overlay_t *overlay, o_pos_t *pos, char *buff,
+				  unsigned int epoch, char *shortest, size_t *shortest_len,
+				  char *frequent, u64_t *max_score);
+
 #endif  // MAGIC_KEYBOARD_H_
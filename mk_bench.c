@@ -0,0 +1,642 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "structs.h"
+#include "utils.h"
+#include "generic_tree.h"
+#include "vtrie.h"
+#include "magic_keyboard.h"
+#include "swipe.h"
+#include "overlay.h"
+#include "word_ids.h"
+#include "bigram.h"
+#include "planner.h"
+
+/**
+ * The benchmarks of the engine. They work on generated words, so every run
+ * measures the same dictionary:
+ *
+ *	mk_bench cow [words]	in-place trie vs copy-on-write versions
+ *	mk_bench swipe [words]	swipe decoding time and accuracy
+ *	mk_bench lookup [words]	batched lookups, by group size, and by word id
+ *	mk_bench users [users]	per-user overlays: memory and query time, and
+ *				the planned AUTOCOMPLETE against the whole walk
+ *	mk_bench predict [words]	bigrams: memory per pair and PREDICT time
+ */
+
+#define BENCH_WORDS 100000
+#define BENCH_MIN_LEN 3
+#define BENCH_MAX_LEN 10
+#define BENCH_SWIPE_WORDS 200000
+#define BENCH_SWIPES 1000
+#define BENCH_SWIPE_STEP 0.3
+#define BENCH_SWIPE_NOISE 0.2
+#define BENCH_LOOKUP_WORDS 1000000
+#define BENCH_LOOKUPS 1000000
+#define BENCH_USERS 100000
+#define BENCH_USER_CHANGES 8
+#define BENCH_USER_QUERIES 100000
+#define BENCH_PREDICT_TOKENS 10000000
+#define BENCH_PREDICT_FAVOURITES 16
+#define BENCH_PREDICT_QUERIES 100000
+#define BENCH_PREDICT_N 5
+
+static u64_t bench_state = 0x2545f4914f6cdd1dUL;
+
+/**
+ * @brief Gives the next pseudo-random number, always the same sequence.
+ *
+ * @return unsigned int The number.
+ */
+static unsigned int next_random(void)
+{
+	bench_state = bench_state * 6364136223846793005UL + 1442695040888963407UL;
+	return bench_state >> 33;
+}
+
+/**
+ * @brief Gives the time elapsed since a moment, in nanoseconds.
+ *
+ * @param start The moment.
+ * @return double The nanoseconds since start.
+ */
+static double elapsed_ns(struct timespec *start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) * 1e9 +
+		   (now.tv_nsec - start->tv_nsec);
+}
+
+/**
+ * @brief Generates pseudo-random words, always the same ones. The letters
+ * are skewed towards the start of the alphabet, so the words share prefixes
+ * like the real ones do.
+ *
+ * @param words_no The number of words.
+ * @return char* The words, MAX_BUFF characters apart.
+ */
+static char *generate_words(unsigned int words_no)
+{
+	char *words = (char *)malloc((size_t)words_no * MAX_BUFF);
+	DIE(!words, MEMFAIL);
+
+	for (unsigned int i = 0; i < words_no; i++) {
+		unsigned int len = BENCH_MIN_LEN +
+						   next_random() % (BENCH_MAX_LEN - BENCH_MIN_LEN + 1);
+
+		char *word = words + (size_t)i * MAX_BUFF;
+		for (unsigned int j = 0; j < len; j++) {
+			unsigned int a = next_random() % ALPH;
+			unsigned int b = next_random() % ALPH;
+			word[j] = 'a' + (a < b ? a : b);
+		}
+
+		word[len] = '\0';
+	}
+
+	return words;
+}
+
+/**
+ * @brief Counts the nodes of a generic trie.
+ *
+ * @param root The root of the trie.
+ * @return u64_t The number of nodes.
+ */
+static u64_t count_nodes(g_node_t *root)
+{
+	u64_t nodes = 1;
+	for (unsigned int i = 0; i < ALPH; i++) {
+		if (root->children[i])
+			nodes += count_nodes(root->children[i]);
+	}
+
+	return nodes;
+}
+
+/**
+ * @brief Prints a line of the results.
+ *
+ * @param name The name of the measurement.
+ * @param ns The total time, in nanoseconds.
+ * @param ops The number of operations, 0 to print only the memory.
+ * @param bytes The memory used after the operations.
+ */
+static void report_line(const char *name, double ns, unsigned int ops,
+						u64_t bytes)
+{
+	if (ops > 0)
+		printf("%-28s %10.1f ns/op", name, ns / ops);
+	else
+		printf("%-28s %16s", name, "");
+
+	printf(" %10.2f MiB\n", bytes / (1024.0 * 1024.0));
+}
+
+/**
+ * @brief Compares the updates of the in-place trie with the ones of the
+ * copy-on-write versions: the time of an insert and of a remove, and the
+ * memory of the dictionary. The versions are also measured while a reader
+ * pins the first version, which keeps every replaced path alive.
+ *
+ * @param words_no The number of words.
+ */
+static void bench_cow(unsigned int words_no)
+{
+	char *words = generate_words(words_no);
+	struct timespec start;
+	u64_t g_node_size = sizeof(g_node_t) + sizeof(key_t) +
+						ALPH * sizeof(g_node_t *);
+
+	g_tree_t *trie = create_generic_tree(sizeof(key_t), free_tnode);
+	DIE(!trie || init_trie(trie) < 0, MEMFAIL);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (unsigned int i = 0; i < words_no; i++)
+		DIE(insert_and_update_trie(trie, words + (size_t)i * MAX_BUFF) < 0,
+			MEMFAIL);
+	report_line("in-place insert", elapsed_ns(&start), words_no,
+				count_nodes(trie->root) * g_node_size);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (unsigned int i = 0; i < words_no; i += 2)
+		DIE(remove_and_update_trie(trie, words + (size_t)i * MAX_BUFF) < 0,
+			MEMFAIL);
+	sweep_trie(trie);
+	report_line("in-place remove", elapsed_ns(&start), (words_no + 1) / 2,
+				count_nodes(trie->root) * g_node_size);
+
+	v_trie_t *vtrie = create_vtrie();
+	DIE(!vtrie, MEMFAIL);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (unsigned int i = 0; i < words_no; i++)
+		DIE(vtrie_insert(vtrie, words + (size_t)i * MAX_BUFF, 1) < 0, MEMFAIL);
+	report_line("copy-on-write insert", elapsed_ns(&start), words_no,
+				vtrie->nodes * sizeof(v_node_t));
+
+	v_version_t *pinned = vtrie_pin(vtrie);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (unsigned int i = 0; i < words_no; i += 2)
+		DIE(vtrie_remove(vtrie, words + (size_t)i * MAX_BUFF) < 0, MEMFAIL);
+	report_line("copy-on-write remove, pinned", elapsed_ns(&start),
+				(words_no + 1) / 2, vtrie->nodes * sizeof(v_node_t));
+
+	/**
+	 * The paths replaced since the pin are freed with the first version
+	 */
+	vtrie_unpin(vtrie, pinned);
+	report_line("copy-on-write, unpinned", 0, 0,
+				vtrie->nodes * sizeof(v_node_t));
+
+	free_vtrie(vtrie);
+	free_trie(trie->root, trie->free_func);
+	free(trie->tombs);
+	free(trie);
+	free(words);
+}
+
+/**
+ * @brief Draws a swipe over the keys of a word: a line through their
+ * centres, sampled every BENCH_SWIPE_STEP keys, with every sample moved by up
+ * to BENCH_SWIPE_NOISE keys on each axis.
+ *
+ * @param word The word.
+ * @param samples Where to store the samples, room for SWIPE_MAX_PTS.
+ * @return unsigned int The number of samples.
+ */
+static unsigned int draw_swipe(char *word, double *samples)
+{
+	double from[2], to[2];
+	unsigned int samples_no = 0;
+	get_key_centre(word[0], from);
+
+	for (size_t i = 1; word[i] != '\0'; i++) {
+		get_key_centre(word[i], to);
+
+		double dx = to[0] - from[0], dy = to[1] - from[1];
+		unsigned int steps = 1;
+		while (steps * BENCH_SWIPE_STEP * steps * BENCH_SWIPE_STEP <
+			   dx * dx + dy * dy)
+			steps++;
+
+		for (unsigned int j = 0; j < steps; j++) {
+			if (samples_no + 1 >= SWIPE_MAX_PTS)
+				break;
+
+			double noise_x = (next_random() % 2001 / 1000.0 - 1) *
+							 BENCH_SWIPE_NOISE;
+			double noise_y = (next_random() % 2001 / 1000.0 - 1) *
+							 BENCH_SWIPE_NOISE;
+			samples[2 * samples_no] = from[0] + dx * j / steps + noise_x;
+			samples[2 * samples_no + 1] = from[1] + dy * j / steps + noise_y;
+			samples_no++;
+		}
+
+		memcpy(from, to, sizeof(from));
+	}
+
+	/**
+	 * The swipe ends on the last key
+	 */
+	samples[2 * samples_no] = from[0];
+	samples[2 * samples_no + 1] = from[1];
+	return samples_no + 1;
+}
+
+/**
+ * @brief Compares 2 times, for sorting.
+ *
+ * @param a The first time.
+ * @param b The second time.
+ * @return int The order of the times.
+ */
+static int compare_times(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * @brief Measures the time of decoding the swipes of random words of the
+ * dictionary, and how often the word is the first or among the first 3
+ * results.
+ *
+ * @param words_no The number of words in the dictionary.
+ */
+static void bench_swipe(unsigned int words_no)
+{
+	char *words = generate_words(words_no);
+	double *times = (double *)malloc(BENCH_SWIPES * sizeof(double));
+	double samples[2 * SWIPE_MAX_PTS];
+	char decoded[MAX_BUFF];
+	struct timespec start;
+	unsigned int top1 = 0, top3 = 0;
+
+	g_tree_t *trie = create_generic_tree(sizeof(key_t), free_tnode);
+	kd_tree_t *keyboard = create_keyboard();
+	DIE(!times || !trie || !keyboard || init_trie(trie) < 0, MEMFAIL);
+
+	for (unsigned int i = 0; i < words_no; i++)
+		DIE(insert_and_update_trie(trie, words + (size_t)i * MAX_BUFF) < 0,
+			MEMFAIL);
+
+	for (unsigned int i = 0; i < BENCH_SWIPES; i++) {
+		char *word = words + (size_t)(next_random() % words_no) * MAX_BUFF;
+		unsigned int samples_no = draw_swipe(word, samples);
+		unsigned int count;
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		g_node_t **best = decode_swipe(trie->root, keyboard, samples,
+									   samples_no, 3, trie->epoch, &count);
+		times[i] = elapsed_ns(&start);
+		DIE(!best, MEMFAIL);
+
+		for (unsigned int j = 0; j < count; j++) {
+			get_word_from_end(best[j], decoded);
+			if (strcmp(decoded, word) == 0) {
+				top1 += j == 0;
+				top3++;
+			}
+		}
+
+		free(best);
+	}
+
+	qsort(times, BENCH_SWIPES, sizeof(double), compare_times);
+
+	double total = 0;
+	for (unsigned int i = 0; i < BENCH_SWIPES; i++)
+		total += times[i];
+
+	printf("swipes: %u on %u words\n", BENCH_SWIPES, words_no);
+	printf("mean:   %.3f ms\n", total / BENCH_SWIPES / 1e6);
+	printf("p50:    %.3f ms\n", times[BENCH_SWIPES / 2] / 1e6);
+	printf("p99:    %.3f ms\n", times[BENCH_SWIPES * 99 / 100] / 1e6);
+	printf("top 1:  %.1f%%\n", 100.0 * top1 / BENCH_SWIPES);
+	printf("top 3:  %.1f%%\n", 100.0 * top3 / BENCH_SWIPES);
+
+	free_kd_tree(keyboard);
+	free_trie(trie->root, trie->free_func);
+	free(trie->tombs);
+	free(trie);
+	free(times);
+	free(words);
+}
+
+/**
+ * @brief Measures the lookups of random words, one by one and in batches of
+ * every group size, on a trie much bigger than the cache.
+ *
+ * @param words_no The number of words in the dictionary.
+ */
+static void bench_lookup(unsigned int words_no)
+{
+	char *words = generate_words(words_no);
+	char **keys = (char **)malloc(BENCH_LOOKUPS * sizeof(char *));
+	g_node_t **ends = (g_node_t **)malloc(BENCH_LOOKUPS * sizeof(g_node_t *));
+	struct timespec start;
+
+	g_tree_t *trie = create_generic_tree(sizeof(key_t), free_tnode);
+	DIE(!keys || !ends || !trie || init_trie(trie) < 0, MEMFAIL);
+
+	for (unsigned int i = 0; i < words_no; i++)
+		DIE(insert_and_update_trie(trie, words + (size_t)i * MAX_BUFF) < 0,
+			MEMFAIL);
+
+	/**
+	 * The words are picked at random, so consecutive lookups share nothing
+	 */
+	for (unsigned int i = 0; i < BENCH_LOOKUPS; i++)
+		keys[i] = words + (size_t)(next_random() % words_no) * MAX_BUFF;
+
+	printf("trie: %u words, %.0f MiB\n", words_no,
+		   trie->mem_used / (1024.0 * 1024.0));
+
+	u64_t found = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (unsigned int i = 0; i < BENCH_LOOKUPS; i++)
+		found += get_ending_node(trie->root, keys[i]) != NULL;
+	double ns = elapsed_ns(&start);
+	printf("%-10s %8.2f Mlookups/s (%lu found)\n", "one by one",
+		   BENCH_LOOKUPS / ns * 1e3, found);
+
+	for (unsigned int group = 1; group <= LOOKUP_GROUP_MAX; group *= 2) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		lookup_batch(trie->root, keys, BENCH_LOOKUPS, group, 0, ends);
+		ns = elapsed_ns(&start);
+
+		found = 0;
+		for (unsigned int i = 0; i < BENCH_LOOKUPS; i++)
+			found += ends[i] != NULL;
+
+		printf("group %-4u %8.2f Mlookups/s (%lu found)\n", group,
+			   BENCH_LOOKUPS / ns * 1e3, found);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (unsigned int i = 0; i < BENCH_LOOKUPS; i++)
+		DIE(insert_and_update_trie(trie, keys[i]) < 0, MEMFAIL);
+	ns = elapsed_ns(&start);
+	printf("%-10s %8.2f Mbumps/s\n", "walked", BENCH_LOOKUPS / ns * 1e3);
+
+	/**
+	 * The same lookups and uses, from the ids of the frozen vocabulary
+	 */
+	trie->ids = build_word_ids(trie);
+	DIE(!trie->ids, MEMFAIL);
+	printf("word ids: %u words, %.1f MiB\n", trie->ids->words_no,
+		   trie->ids->bytes / (1024.0 * 1024.0));
+
+	found = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (unsigned int i = 0; i < BENCH_LOOKUPS; i++) {
+		u32_t id = w_find(trie->ids, keys[i]);
+		found += id != W_NO_ID && trie->ids->freqs[id] != 0;
+	}
+	ns = elapsed_ns(&start);
+	printf("%-10s %8.2f Mlookups/s (%lu found)\n", "word ids",
+		   BENCH_LOOKUPS / ns * 1e3, found);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (unsigned int i = 0; i < BENCH_LOOKUPS; i++)
+		DIE(insert_and_update_trie(trie, keys[i]) < 0, MEMFAIL);
+	ns = elapsed_ns(&start);
+	printf("%-10s %8.2f Mbumps/s\n", "word ids", BENCH_LOOKUPS / ns * 1e3);
+
+	free_word_ids(trie->ids);
+	trie->ids = NULL;
+
+	free_trie(trie->root, trie->free_func);
+	free(trie->tombs);
+	free(trie);
+	free(ends);
+	free(keys);
+	free(words);
+}
+
+/**
+ * @brief Measures the memory of many per-user overlays over a shared trie,
+ * and the cost of completing a prefix through an overlay.
+ *
+ * @param users_no The number of users.
+ */
+static void bench_users(unsigned int users_no)
+{
+	char *words = generate_words(BENCH_WORDS);
+	char *own = generate_words(users_no);
+	char buff[MAX_BUFF], shortest[MAX_BUFF], frequent[MAX_BUFF];
+	struct timespec start;
+
+	g_tree_t *trie = create_generic_tree(sizeof(key_t), free_tnode);
+	o_table_t *table = create_overlays();
+	DIE(!trie || !table || init_trie(trie) < 0, MEMFAIL);
+
+	for (unsigned int i = 0; i < BENCH_WORDS; i++)
+		DIE(insert_and_update_trie(trie, words + (size_t)i * MAX_BUFF) < 0,
+			MEMFAIL);
+
+	/**
+	 * Every user has a word of its own, uses some shared words and removes
+	 * a few others
+	 */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (unsigned int i = 0; i < users_no; i++) {
+		DIE(overlay_insert(table, trie, i, own + (size_t)i * MAX_BUFF) < 0,
+			MEMFAIL);
+
+		for (unsigned int j = 1; j < BENCH_USER_CHANGES; j++) {
+			char *word = words + (size_t)(next_random() % BENCH_WORDS) *
+						 MAX_BUFF;
+			if (j % 4 == 0)
+				DIE(overlay_remove(table, trie, i, word) < 0, MEMFAIL);
+			else
+				DIE(overlay_insert(table, trie, i, word) < 0, MEMFAIL);
+		}
+	}
+	double ns = elapsed_ns(&start);
+
+	printf("shared trie: %u words, %.1f MiB\n", BENCH_WORDS,
+		   trie->mem_used / (1024.0 * 1024.0));
+	printf("overlays: %lu users, %.1f MiB, %.0f bytes per user, "
+		   "%.0f ns per change\n", table->users_no,
+		   table->bytes / (1024.0 * 1024.0),
+		   (double)table->bytes / users_no,
+		   ns / ((double)users_no * BENCH_USER_CHANGES));
+
+	/**
+	 * The same prefixes, completed by the shared trie and by random users
+	 */
+	double shared_ns = 0, planned_ns = 0, user_ns = 0;
+	for (unsigned int i = 0; i < BENCH_USER_QUERIES; i++) {
+		char *word = words + (size_t)(next_random() % BENCH_WORDS) * MAX_BUFF;
+		char prefix[3] = {word[0], word[1], '\0'};
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		g_node_t *end = get_end_of_prefix(trie->root, prefix, 0);
+		if (end) {
+			g_node_t *shortest_node = end, *frequent_node = NULL;
+			parallel_searching(end, &shortest_node, &frequent_node,
+							   trie->epoch);
+		}
+		shared_ns += elapsed_ns(&start);
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		end = get_end_of_prefix(trie->root, prefix, 0);
+		if (end) {
+			g_node_t *nodes[3];
+			q_plan_t plan;
+			plan_autocomplete(NULL, end, 0, trie->epoch, nodes, &plan);
+		}
+		planned_ns += elapsed_ns(&start);
+
+		o_pos_t pos;
+		o_overlay_t *overlay = get_overlay(table, next_random() % users_no);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		if (o_get_end_of_prefix(trie->root, overlay, prefix, &pos)) {
+			size_t shortest_len = INF;
+			u64_t max_score = 0;
+			strcpy(buff, prefix);
+			frequent[0] = '\0';
+			o_best_words(overlay, &pos, buff, trie->epoch, shortest,
+						 &shortest_len, frequent, &max_score);
+		}
+		user_ns += elapsed_ns(&start);
+	}
+
+	printf("%-12s %8.0f ns per AUTOCOMPLETE\n", "shared", shared_ns /
+		   BENCH_USER_QUERIES);
+	printf("%-12s %8.0f ns per AUTOCOMPLETE\n", "planned", planned_ns /
+		   BENCH_USER_QUERIES);
+	printf("%-12s %8.0f ns per AUTOCOMPLETE\n", "with overlay", user_ns /
+		   BENCH_USER_QUERIES);
+
+	free_overlays(table);
+	free_trie(trie->root, trie->free_func);
+	free(trie->tombs);
+	free(trie);
+	free(own);
+	free(words);
+}
+
+/**
+ * @brief Measures the bigrams of a generated text: the memory of a pair,
+ * and the time of a prediction, with one letter typed and with none.
+ *
+ * @param words_no The number of words in the dictionary.
+ */
+static void bench_predict(unsigned int words_no)
+{
+	char *words = generate_words(words_no);
+	u64_t *pairs = (u64_t *)malloc(BENCH_PREDICT_TOKENS * sizeof(u64_t));
+	struct timespec start;
+
+	g_tree_t *trie = create_generic_tree(sizeof(key_t), free_tnode);
+	DIE(!pairs || !trie || init_trie(trie) < 0, MEMFAIL);
+
+	for (unsigned int i = 0; i < words_no; i++)
+		DIE(insert_and_update_trie(trie, words + (size_t)i * MAX_BUFF) < 0,
+			MEMFAIL);
+
+	trie->ids = build_word_ids(trie);
+	DIE(!trie->ids, MEMFAIL);
+	u32_t ids_no = trie->ids->words_no;
+
+	/**
+	 * Every word is mostly followed by a few favourites, the first ones
+	 * more often, and sometimes by any word
+	 */
+	u32_t prev = next_random() % ids_no;
+	for (unsigned int i = 0; i < BENCH_PREDICT_TOKENS; i++) {
+		u32_t next = next_random() % ids_no;
+		if (next_random() % 4 != 0) {
+			unsigned int a = next_random() % BENCH_PREDICT_FAVOURITES;
+			unsigned int b = next_random() % BENCH_PREDICT_FAVOURITES;
+			next = (prev * 2654435761UL + (a < b ? a : b) * 40503UL) %
+				   ids_no;
+		}
+
+		pairs[i] = (u64_t)prev << 32 | next;
+		prev = next;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	b_model_t *model = build_bigrams(pairs, BENCH_PREDICT_TOKENS, ids_no);
+	double ns = elapsed_ns(&start);
+	DIE(!model, MEMFAIL);
+
+	printf("bigrams: %u words, %u tokens, %lu pairs, built in %.0f ms\n",
+		   ids_no, BENCH_PREDICT_TOKENS, model->pairs_no, ns / 1e6);
+	printf("memory: %.1f MiB, %.2f bytes per pair (12 as plain ids and "
+		   "counts)\n", model->bytes / (1024.0 * 1024.0),
+		   (double)model->bytes / model->pairs_no);
+
+	const char *prefixes[] = {"one letter", "no letter"};
+	for (unsigned int p = 0; p < 2; p++) {
+		u64_t given = 0;
+		ns = 0;
+		for (unsigned int i = 0; i < BENCH_PREDICT_QUERIES; i++) {
+			char *word = words + (size_t)(next_random() % words_no) *
+						 MAX_BUFF;
+			char *other = words + (size_t)(next_random() % words_no) *
+						  MAX_BUFF;
+			char prefix[2] = {p == 0 ? other[0] : '\0', '\0'};
+
+			b_candidate_t *found;
+			u32_t found_no = 0;
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			u32_t id = w_find(trie->ids, word);
+			if (id != W_NO_ID &&
+				get_end_of_prefix(trie->root, prefix, 0) &&
+				b_predict(model, trie->ids, id, prefix, &found,
+						  &found_no) == 0)
+				free(found);
+			ns += elapsed_ns(&start);
+
+			given += found_no < BENCH_PREDICT_N ? found_no : BENCH_PREDICT_N;
+		}
+
+		printf("%-12s %8.0f ns per PREDICT, %.2f words given\n",
+			   prefixes[p], ns / BENCH_PREDICT_QUERIES,
+			   (double)given / BENCH_PREDICT_QUERIES);
+	}
+
+	free_bigrams(model);
+	free_word_ids(trie->ids);
+	trie->ids = NULL;
+
+	free_trie(trie->root, trie->free_func);
+	free(trie->tombs);
+	free(trie);
+	free(pairs);
+	free(words);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int words_no = argc > 2 ? strtoul(argv[2], NULL, 10) : 0;
+
+	if (argc > 1 && strcmp(argv[1], "cow") == 0) {
+		bench_cow(words_no ? words_no : BENCH_WORDS);
+	} else if (argc > 1 && strcmp(argv[1], "swipe") == 0) {
+		bench_swipe(words_no ? words_no : BENCH_SWIPE_WORDS);
+	} else if (argc > 1 && strcmp(argv[1], "lookup") == 0) {
+		bench_lookup(words_no ? words_no : BENCH_LOOKUP_WORDS);
+	} else if (argc > 1 && strcmp(argv[1], "users") == 0) {
+		bench_users(words_no ? words_no : BENCH_USERS);
+	} else if (argc > 1 && strcmp(argv[1], "predict") == 0) {
+		bench_predict(words_no ? words_no : BENCH_WORDS);
+	} else {
+		fprintf(stderr, "Usage: %s cow|swipe|lookup|users|predict [n]\n",
+				argv[0]);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,324 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include "structs.h"
+#include "utils.h"
+#include "net.h"
+
+/**
+ * The load generator of the server. It opens many connections, keeps a
+ * number of commands in flight on each one, and measures the time from
+ * sending a command to reading the end of its reply.
+ *
+ *	mk_loadgen <address> [connections] [requests] [depth]
+ *
+ * The requests are per connection. The commands are a mix of updates and
+ * queries on generated words, always the same ones.
+ */
+
+static u64_t lg_state = 0x2545f4914f6cdd1dUL;
+
+/**
+ * @brief Gives the current time, in nanoseconds.
+ *
+ * @return u64_t The time.
+ */
+static u64_t now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (u64_t)now.tv_sec * 1000000000UL + now.tv_nsec;
+}
+
+/**
+ * @brief Gives the next pseudo-random number.
+ *
+ * @return unsigned int The number.
+ */
+static unsigned int next_random(void)
+{
+	lg_state = lg_state * 6364136223846793005UL + 1442695040888963407UL;
+	return lg_state >> 33;
+}
+
+/**
+ * @brief Writes the next command of the mix: 20% updates, the rest
+ * autocompletions and autocorrections.
+ *
+ * @param buff Where to write the command, with room for LG_REQ_MAX bytes.
+ * @return int The length of the command.
+ */
+static int make_request(char *buff)
+{
+	char word[MAX_BUFF];
+	unsigned int len = 3 + next_random() % 6;
+
+	/**
+	 * The letters are skewed towards the start of the alphabet, so the
+	 * words share prefixes like the real ones do
+	 */
+	for (unsigned int i = 0; i < len; i++) {
+		unsigned int a = next_random() % ALPH, b = next_random() % ALPH;
+		word[i] = 'a' + (a < b ? a : b);
+	}
+	word[len] = '\0';
+
+	switch (next_random() % 10) {
+	case 0:
+	case 1:
+		return snprintf(buff, LG_REQ_MAX, "INSERT %s\n", word);
+	case 2:
+		return snprintf(buff, LG_REQ_MAX, "REMOVE %s\n", word);
+	case 3:
+	case 4:
+	case 5:
+		word[2] = '\0';
+		return snprintf(buff, LG_REQ_MAX, "AUTOCOMPLETE %s 0\n", word);
+	case 6:
+		word[2] = '\0';
+		return snprintf(buff, LG_REQ_MAX, "AUTOCOMPLETE_FUZZY %s 1 3\n",
+						word);
+	default:
+		return snprintf(buff, LG_REQ_MAX, "AUTOCORRECT %s 1\n", word);
+	}
+}
+
+/**
+ * @brief Queues commands on a connection, until depth of them are in flight.
+ *
+ * @param conn The connection.
+ * @param requests The number of commands of the connection.
+ * @param depth The number of commands in flight.
+ */
+static void fill_requests(lg_conn_t *conn, u64_t requests, unsigned int depth)
+{
+	if (conn->out_sent == conn->out_len)
+		conn->out_len = conn->out_sent = 0;
+
+	while (conn->sent < requests && conn->sent - conn->done < depth) {
+		conn->out_len += make_request(conn->out + conn->out_len);
+		conn->sent_at[conn->sent % depth] = now_ns();
+		conn->sent++;
+	}
+}
+
+/**
+ * @brief Sends the queued commands, as many as the socket takes.
+ *
+ * @param conn The connection.
+ * @return int Returns 0 on success, or -1 if the server is gone.
+ */
+static int flush_requests(lg_conn_t *conn)
+{
+	while (conn->out_sent < conn->out_len) {
+		ssize_t ret = write(conn->fd, conn->out + conn->out_sent,
+							conn->out_len - conn->out_sent);
+		if (ret < 0 && errno == EINTR)
+			continue;
+
+		if (ret < 0 && errno == EAGAIN)
+			return 0;
+
+		if (ret < 0)
+			return -1;
+
+		conn->out_sent += ret;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Reads the replies, and records the latency of every command whose
+ * reply is complete.
+ *
+ * @param conn The connection.
+ * @param depth The number of commands in flight.
+ * @param latencies Where to record the latencies.
+ * @param latencies_no The number of recorded latencies.
+ * @param errors The number of commands that failed.
+ * @return int Returns 0 on success, or -1 if the server is gone.
+ */
+static int read_replies(lg_conn_t *conn, unsigned int depth, u64_t *latencies,
+						u64_t *latencies_no, u64_t *errors)
+{
+	ssize_t ret = read(conn->fd, conn->in + conn->in_len,
+					   SRV_LINE_MAX - conn->in_len);
+	if (ret < 0 && (errno == EAGAIN || errno == EINTR))
+		return 0;
+
+	if (ret <= 0)
+		return -1;
+
+	conn->in_len += ret;
+
+	size_t start = 0;
+	char *newline;
+	while ((newline = memchr(conn->in + start, '\n',
+							 conn->in_len - start))) {
+		char *line = conn->in + start;
+		start = newline - conn->in + 1;
+
+		/**
+		 * The words are lowercase, so only the end of a reply starts with
+		 * "OK" or "ERR"
+		 */
+		u8_t failed = strncmp(line, "ERR", 3) == 0;
+		if (!failed && strncmp(line, "OK\n", 3) != 0)
+			continue;
+
+		latencies[*latencies_no] = now_ns() - conn->sent_at[conn->done %
+															depth];
+		*latencies_no = *latencies_no + 1;
+		*errors = *errors + failed;
+		conn->done++;
+	}
+
+	memmove(conn->in, conn->in + start, conn->in_len - start);
+	conn->in_len -= start;
+	return 0;
+}
+
+/**
+ * @brief Compares 2 latencies, for sorting.
+ *
+ * @param a The first latency.
+ * @param b The second latency.
+ * @return int The order of the latencies.
+ */
+static int compare_latencies(const void *a, const void *b)
+{
+	u64_t x = *(const u64_t *)a, y = *(const u64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * @brief Prints the throughput and the latency percentiles.
+ *
+ * @param latencies The latencies of the commands.
+ * @param latencies_no The number of commands.
+ * @param errors The number of commands that failed.
+ * @param elapsed The time of the whole run, in nanoseconds.
+ */
+static void print_stats(u64_t *latencies, u64_t latencies_no, u64_t errors,
+						u64_t elapsed)
+{
+	printf("requests:   %lu (%lu errors)\n", latencies_no, errors);
+	printf("time:       %.3f s\n", elapsed / 1e9);
+	printf("throughput: %.0f req/s\n", latencies_no / (elapsed / 1e9));
+
+	if (latencies_no == 0)
+		return;
+
+	qsort(latencies, latencies_no, sizeof(u64_t), compare_latencies);
+
+	double percentiles[] = { 0.5, 0.9, 0.99, 0.999 };
+	const char *names[] = { "p50", "p90", "p99", "p99.9" };
+	for (unsigned int i = 0; i < 4; i++) {
+		u64_t idx = (u64_t)(percentiles[i] * (latencies_no - 1));
+		printf("%-11s %.1f us\n", names[i], latencies[idx] / 1e3);
+	}
+
+	printf("max:        %.1f us\n", latencies[latencies_no - 1] / 1e3);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <address> [connections] [requests] "
+				"[depth]\n", argv[0]);
+		return 1;
+	}
+
+	unsigned int conns_no = argc > 2 ? strtoul(argv[2], NULL, 10) : 64;
+	u64_t requests = argc > 3 ? strtoul(argv[3], NULL, 10) : 1000;
+	unsigned int depth = argc > 4 ? strtoul(argv[4], NULL, 10) : 8;
+	if (conns_no == 0 || depth == 0) {
+		fprintf(stderr, "The connections and the depth must be positive\n");
+		return 1;
+	}
+
+	u64_t *latencies = (u64_t *)malloc(conns_no * requests * sizeof(u64_t));
+	lg_conn_t *conns = (lg_conn_t *)calloc(conns_no, sizeof(lg_conn_t));
+	DIE(!latencies || !conns, MEMFAIL);
+
+	int epfd = epoll_create1(0);
+	DIE(epfd < 0, "epoll_create1");
+
+	for (unsigned int i = 0; i < conns_no; i++) {
+		conns[i].fd = open_connection(argv[1]);
+		DIE(conns[i].fd < 0, "open_connection");
+
+		conns[i].out = (char *)malloc((size_t)depth * LG_REQ_MAX);
+		conns[i].sent_at = (u64_t *)malloc(depth * sizeof(u64_t));
+		DIE(!conns[i].out || !conns[i].sent_at, MEMFAIL);
+
+		struct epoll_event ev;
+		ev.events = EPOLLIN | EPOLLOUT;
+		ev.data.ptr = &conns[i];
+		DIE(epoll_ctl(epfd, EPOLL_CTL_ADD, conns[i].fd, &ev) < 0,
+			"epoll_ctl");
+	}
+
+	u64_t latencies_no = 0, errors = 0;
+	unsigned int finished = 0;
+	struct epoll_event events[SRV_EVENTS];
+	u64_t start = now_ns();
+
+	while (finished < conns_no) {
+		int ready = epoll_wait(epfd, events, SRV_EVENTS, -1);
+		if (ready < 0 && errno == EINTR)
+			continue;
+		DIE(ready < 0, "epoll_wait");
+
+		for (int i = 0; i < ready; i++) {
+			lg_conn_t *conn = (lg_conn_t *)events[i].data.ptr;
+
+			int ret = 0;
+			if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+				ret = read_replies(conn, depth, latencies, &latencies_no,
+								   &errors);
+			DIE(ret < 0, "The server closed the connection");
+
+			fill_requests(conn, requests, depth);
+			DIE(flush_requests(conn) < 0, "write");
+
+			/**
+			 * Wait for the socket to be writable only while there are
+			 * commands to send
+			 */
+			struct epoll_event ev;
+			ev.events = EPOLLIN;
+			if (conn->out_sent < conn->out_len)
+				ev.events |= EPOLLOUT;
+			ev.data.ptr = conn;
+
+			if (conn->done == requests) {
+				epoll_ctl(epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+				finished++;
+			} else {
+				epoll_ctl(epfd, EPOLL_CTL_MOD, conn->fd, &ev);
+			}
+		}
+	}
+
+	print_stats(latencies, latencies_no, errors, now_ns() - start);
+
+	for (unsigned int i = 0; i < conns_no; i++) {
+		close(conns[i].fd);
+		free(conns[i].out);
+		free(conns[i].sent_at);
+	}
+
+	close(epfd);
+	free(conns);
+	free(latencies);
+
+	return 0;
+}
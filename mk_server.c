@@ -0,0 +1,452 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include "structs.h"
+#include "utils.h"
+#include "libmk.h"
+#include "commands.h"
+#include "net.h"
+
+/**
+ * The magic keyboard as a server: all the clients share one dictionary. A
+ * single thread multiplexes the connections with epoll, and the wide
+ * searches still run on the workers of the library.
+ *
+ *	mk_server <address> [journal directory]
+ *
+ * A client sends the commands of the interactive program, one per line, and
+ * it doesn't have to wait for a reply before sending the next command. The
+ * replies come in the order of the commands. Each one has the lines the
+ * interactive program would print, followed by a line with "OK", or with
+ * "ERR" and the message of the error.
+ */
+
+static volatile sig_atomic_t stopping;
+
+/**
+ * @brief Asks the server to stop, after the current events.
+ *
+ * @param signo The signal.
+ */
+static void handle_stop(int signo)
+{
+	(void)signo;
+	stopping = 1;
+}
+
+/**
+ * @brief Adds bytes to the replies of a connection.
+ *
+ * @param conn The connection.
+ * @param data The bytes.
+ * @param len The number of bytes.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+static int conn_append(srv_conn_t *conn, const char *data, size_t len)
+{
+	if (len == 0)
+		return 0;
+
+	/**
+	 * Move the unsent replies to the front, before growing the buffer
+	 */
+	if (conn->out_sent > 0) {
+		memmove(conn->out, conn->out + conn->out_sent,
+				conn->out_len - conn->out_sent);
+		conn->out_len -= conn->out_sent;
+		conn->out_sent = 0;
+	}
+
+	if (conn->out_len + len > conn->out_cap) {
+		size_t cap = conn->out_cap ? conn->out_cap : SRV_READ;
+		while (cap < conn->out_len + len)
+			cap *= 2;
+
+		char *out = (char *)realloc(conn->out, cap);
+		if (!out)
+			return -1;
+
+		conn->out = out;
+		conn->out_cap = cap;
+	}
+
+	memcpy(conn->out + conn->out_len, data, len);
+	conn->out_len += len;
+	return 0;
+}
+
+/**
+ * @brief Runs the command of a line, and adds its reply to the connection.
+ *
+ * @param trie The handle of the dictionary.
+ * @param conn The connection.
+ * @param line The line, without the '\n'.
+ * @param line_len The length of the line.
+ * @param result The buffer of the query results.
+ * @param result_len The size of the buffer.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+static int run_line(mk_trie_t *trie, srv_conn_t *conn, char *line,
+					size_t line_len, char **result, size_t *result_len)
+{
+	size_t i = 0;
+	while (i < line_len && (line[i] == ' ' || line[i] == '\t' ||
+							line[i] == '\r'))
+		i++;
+
+	if (i == line_len)
+		return 0;
+
+	char *text = NULL;
+	size_t text_len = 0;
+	FILE *in = fmemopen(line, line_len, "r");
+	FILE *out = open_memstream(&text, &text_len);
+	if (!in || !out) {
+		if (in)
+			fclose(in);
+		if (out)
+			fclose(out);
+		free(text);
+		return -1;
+	}
+
+	mk_err_t status;
+	unsigned int id = run_command(trie, in, out, NULL, result, result_len,
+								  &status);
+	fclose(in);
+	if (fclose(out) != 0) {
+		free(text);
+		return -1;
+	}
+
+	char end[MAX_STR];
+	if (id == 0)
+		snprintf(end, MAX_STR, "ERR Unknown command\n");
+	else if (status != MK_OK)
+		snprintf(end, MAX_STR, "ERR %s\n", mk_strerror(status));
+	else
+		snprintf(end, MAX_STR, "OK\n");
+
+	int ret = 0;
+	if (conn_append(conn, text, text_len) < 0 ||
+		conn_append(conn, end, strlen(end)) < 0)
+		ret = -1;
+
+	if (id == EXIT_ID)
+		conn->closing = 1;
+
+	free(text);
+	return ret;
+}
+
+/**
+ * @brief Runs the whole commands read from a connection. It stops early if
+ * too many replies are waiting, and the rest of the commands stay in the
+ * buffer until the client reads them.
+ *
+ * @param trie The handle of the dictionary.
+ * @param conn The connection.
+ * @param result The buffer of the query results.
+ * @param result_len The size of the buffer.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+static int run_lines(mk_trie_t *trie, srv_conn_t *conn, char **result,
+					 size_t *result_len)
+{
+	size_t start = 0;
+
+	while (!conn->closing && conn->out_len - conn->out_sent <= SRV_OUT_HIGH) {
+		char *newline = memchr(conn->in + start, '\n', conn->in_len - start);
+		if (!newline)
+			break;
+
+		size_t line_len = newline - (conn->in + start);
+		if (run_line(trie, conn, conn->in + start, line_len, result,
+					 result_len) < 0)
+			return -1;
+
+		start += line_len + 1;
+	}
+
+	memmove(conn->in, conn->in + start, conn->in_len - start);
+	conn->in_len -= start;
+
+	/**
+	 * A full buffer without a whole command can't become one
+	 */
+	if (conn->in_len == SRV_LINE_MAX && !conn->closing) {
+		const char *err = "ERR Line too long\n";
+		conn->closing = 1;
+		if (conn_append(conn, err, strlen(err)) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Reads what a client sent, as much as the buffer takes.
+ *
+ * @param conn The connection.
+ * @return int Returns 0 on success, or -1 if the client is gone.
+ */
+static int conn_read(srv_conn_t *conn)
+{
+	if (conn->in_len == SRV_LINE_MAX)
+		return 0;
+
+	ssize_t ret = read(conn->fd, conn->in + conn->in_len,
+					   SRV_LINE_MAX - conn->in_len);
+	if (ret < 0 && (errno == EAGAIN || errno == EINTR))
+		return 0;
+
+	if (ret <= 0)
+		return -1;
+
+	conn->in_len += ret;
+	return 0;
+}
+
+/**
+ * @brief Sends the waiting replies, as many as the socket takes.
+ *
+ * @param conn The connection.
+ * @return int Returns 0 on success, or -1 if the client is gone.
+ */
+static int conn_flush(srv_conn_t *conn)
+{
+	while (conn->out_sent < conn->out_len) {
+		ssize_t ret = write(conn->fd, conn->out + conn->out_sent,
+							conn->out_len - conn->out_sent);
+		if (ret < 0 && errno == EINTR)
+			continue;
+
+		if (ret < 0 && errno == EAGAIN)
+			return 0;
+
+		if (ret < 0)
+			return -1;
+
+		conn->out_sent += ret;
+	}
+
+	conn->out_len = 0;
+	conn->out_sent = 0;
+	return 0;
+}
+
+/**
+ * @brief Closes a connection and frees it.
+ *
+ * @param epfd The epoll instance.
+ * @param conn The connection.
+ */
+static void close_conn(int epfd, srv_conn_t *conn)
+{
+	epoll_ctl(epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+	close(conn->fd);
+	free(conn->out);
+	free(conn);
+}
+
+/**
+ * @brief Waits for the events a connection needs next: replies to send, and
+ * commands to read while the replies don't pile up.
+ *
+ * @param epfd The epoll instance.
+ * @param conn The connection.
+ * @return int Returns 0 on success, or -1 if the connection is done.
+ */
+static int conn_watch(int epfd, srv_conn_t *conn)
+{
+	size_t pending = conn->out_len - conn->out_sent;
+	if (conn->closing && pending == 0)
+		return -1;
+
+	u32_t events = 0;
+	if (pending > 0)
+		events |= EPOLLOUT;
+	if (!conn->closing && pending <= SRV_OUT_HIGH)
+		events |= EPOLLIN;
+
+	if (events == conn->events)
+		return 0;
+
+	struct epoll_event ev;
+	ev.events = events;
+	ev.data.ptr = conn;
+	if (epoll_ctl(epfd, EPOLL_CTL_MOD, conn->fd, &ev) < 0)
+		return -1;
+
+	conn->events = events;
+	return 0;
+}
+
+/**
+ * @brief Accepts all the waiting clients.
+ *
+ * @param epfd The epoll instance.
+ * @param listener The listening socket.
+ */
+static void accept_clients(int epfd, int listener)
+{
+	for (;;) {
+		int fd = accept(listener, NULL, NULL);
+		if (fd < 0)
+			return;
+
+		srv_conn_t *conn = (srv_conn_t *)calloc(1, sizeof(srv_conn_t));
+		struct epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.ptr = conn;
+
+		if (!conn || set_nonblocking(fd) < 0 ||
+			epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+			free(conn);
+			close(fd);
+			continue;
+		}
+
+		conn->fd = fd;
+		conn->events = EPOLLIN;
+	}
+}
+
+/**
+ * @brief Serves the clients, until the server is asked to stop.
+ *
+ * @param trie The handle of the dictionary.
+ * @param listener The listening socket.
+ * @return int Returns 0 on success, or -1 on error.
+ */
+static int serve(mk_trie_t *trie, int listener)
+{
+	int epfd = epoll_create1(0);
+	if (epfd < 0)
+		return -1;
+
+	struct epoll_event ev, events[SRV_EVENTS];
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, listener, &ev) < 0) {
+		close(epfd);
+		return -1;
+	}
+
+	size_t result_len = 3 * MK_WORD_MAX + 1;
+	char *result = (char *)malloc(result_len);
+	if (!result) {
+		close(epfd);
+		return -1;
+	}
+
+	while (!stopping) {
+		/**
+		 * The journal groups the updates, so the ones of a group that isn't
+		 * full are synced before waiting for the next commands
+		 */
+		int ready = epoll_wait(epfd, events, SRV_EVENTS, 0);
+		if (ready == 0) {
+			mk_err_t err = mk_sync(trie);
+			if (err != MK_OK)
+				report(err, stderr);
+
+			ready = epoll_wait(epfd, events, SRV_EVENTS, -1);
+		}
+		if (ready < 0 && errno == EINTR)
+			continue;
+
+		if (ready < 0)
+			break;
+
+		for (int i = 0; i < ready; i++) {
+			srv_conn_t *conn = (srv_conn_t *)events[i].data.ptr;
+			if (!conn) {
+				accept_clients(epfd, listener);
+				continue;
+			}
+
+			int ret = 0;
+			if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+				ret = conn_read(conn);
+
+			if (ret == 0)
+				ret = run_lines(trie, conn, &result, &result_len);
+			if (ret == 0)
+				ret = conn_flush(conn);
+
+			/**
+			 * Sending replies may make room for the commands that waited
+			 */
+			if (ret == 0 && conn->in_len > 0)
+				ret = run_lines(trie, conn, &result, &result_len);
+			if (ret == 0)
+				ret = conn_flush(conn);
+			if (ret == 0)
+				ret = conn_watch(epfd, conn);
+
+			if (ret < 0)
+				close_conn(epfd, conn);
+		}
+	}
+
+	/**
+	 * The clients still connected are dropped with the server
+	 */
+	free(result);
+	close(epfd);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <socket path | tcp:port> [journal]\n",
+				argv[0]);
+		return 1;
+	}
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE, &sa, NULL);
+	sa.sa_handler = handle_stop;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	mk_trie_t *trie;
+	mk_err_t err = mk_create(&trie, 0);
+	DIE(err != MK_OK, mk_strerror(err));
+
+	if (argc > 2) {
+		err = mk_open_journal(trie, argv[2]);
+		if (err != MK_OK) {
+			report(err, stderr);
+			mk_destroy(trie);
+			return 1;
+		}
+	}
+
+	int listener = open_listener(argv[1]);
+	if (listener < 0) {
+		perror("open_listener");
+		mk_destroy(trie);
+		return 1;
+	}
+
+	int ret = serve(trie, listener);
+	if (ret < 0)
+		perror("serve");
+
+	close(listener);
+	if (strncmp(argv[1], "tcp:", 4) != 0)
+		unlink(argv[1]);
+
+	mk_destroy(trie);
+
+	return ret < 0 ? 1 : 0;
+}
@@ -0,0 +1,99 @@
+#include "net.h"
+
+int parse_address(const char *address, struct sockaddr_storage *addr,
+				  socklen_t *addr_len)
+{
+	memset(addr, 0, sizeof(struct sockaddr_storage));
+
+	if (strncmp(address, "tcp:", 4) == 0) {
+		char *end;
+		unsigned long port = strtoul(address + 4, &end, 10);
+		if (*end != '\0' || port == 0 || port > 65535)
+			return -1;
+
+		struct sockaddr_in *in = (struct sockaddr_in *)addr;
+		in->sin_family = AF_INET;
+		in->sin_port = htons(port);
+		in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		*addr_len = sizeof(struct sockaddr_in);
+		return AF_INET;
+	}
+
+	struct sockaddr_un *un = (struct sockaddr_un *)addr;
+	if (address[0] == '\0' || strlen(address) >= sizeof(un->sun_path))
+		return -1;
+
+	un->sun_family = AF_UNIX;
+	strcpy(un->sun_path, address);
+	*addr_len = sizeof(struct sockaddr_un);
+	return AF_UNIX;
+}
+
+int set_nonblocking(int fd)
+{
+	int flags = fcntl(fd, F_GETFL);
+	if (flags < 0)
+		return -1;
+
+	return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+int open_listener(const char *address)
+{
+	struct sockaddr_storage addr;
+	socklen_t addr_len;
+	int family = parse_address(address, &addr, &addr_len);
+	if (family < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	int fd = socket(family, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+
+	int one = 1;
+	if (family == AF_UNIX)
+		unlink(address);
+	else
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	if (bind(fd, (struct sockaddr *)&addr, addr_len) < 0 ||
+		listen(fd, SRV_BACKLOG) < 0 || set_nonblocking(fd) < 0) {
+		int err = errno;
+		close(fd);
+		errno = err;
+		return -1;
+	}
+
+	return fd;
+}
+
+int open_connection(const char *address)
+{
+	struct sockaddr_storage addr;
+	socklen_t addr_len;
+	int family = parse_address(address, &addr, &addr_len);
+	if (family < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	int fd = socket(family, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+
+	/**
+	 * The connection is made while the socket still blocks, so it is ready
+	 * when it is returned
+	 */
+	if (connect(fd, (struct sockaddr *)&addr, addr_len) < 0 ||
+		set_nonblocking(fd) < 0) {
+		int err = errno;
+		close(fd);
+		errno = err;
+		return -1;
+	}
+
+	return fd;
+}
@@ -0,0 +1,57 @@
+#ifndef NET_H_
+#define NET_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "utils.h"
+
+/**
+ * The addresses of the server are either the path of a Unix domain socket,
+ * or "tcp:<port>", for a TCP socket on the loopback interface only.
+ */
+
+/**
+ * @brief Fills a socket address from the text of an address.
+ *
+ * @param address The text of the address.
+ * @param addr Where to store the socket address.
+ * @param addr_len Where to store the size of the socket address.
+ * @return int The family of the address, or -1 if the address isn't valid.
+ */
+int parse_address(const char *address, struct sockaddr_storage *addr,
+				  socklen_t *addr_len);
+
+/**
+ * @brief Opens a non-blocking socket that listens on an address. A Unix
+ * socket left by a previous run is replaced.
+ *
+ * @param address The text of the address.
+ * @return int The socket, or -1 on error, with errno set.
+ */
+int open_listener(const char *address);
+
+/**
+ * @brief Opens a connection to an address, and makes it non-blocking.
+ *
+ * @param address The text of the address.
+ * @return int The socket, or -1 on error, with errno set.
+ */
+int open_connection(const char *address);
+
+/**
+ * @brief Makes a socket non-blocking.
+ *
+ * @param fd The socket.
+ * @return int Returns 0 on success, or -1 on error.
+ */
+int set_nonblocking(int fd);
+
+#endif  // NET_H_
@@ -0,0 +1,329 @@
+#include "overlay.h"
+
+/**
+ * @brief Hashes the id of a user, with FNV-1a over its bytes.
+ *
+ * @param user The id of the user.
+ * @return u32_t The hash.
+ */
+static u32_t hash_user(u64_t user)
+{
+	u32_t hash = FNV_BASIS;
+
+	for (unsigned int i = 0; i < sizeof(u64_t); i++) {
+		hash ^= (user >> (8 * i)) & 0xff;
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+/**
+ * @brief Doubles the number of buckets, and moves the overlays to their new
+ * buckets. If there is no memory left, the table stays as it is, only
+ * slower.
+ *
+ * @param table The table.
+ */
+static void grow_table(o_table_t *table)
+{
+	u64_t buckets_no = table->buckets_no * 2;
+	o_overlay_t **buckets = (o_overlay_t **)calloc(buckets_no,
+												   sizeof(o_overlay_t *));
+	if (!buckets)
+		return;
+
+	for (u64_t i = 0; i < table->buckets_no; i++) {
+		o_overlay_t *overlay = table->buckets[i];
+		while (overlay) {
+			o_overlay_t *next = overlay->next;
+			u64_t idx = hash_user(overlay->user) & (buckets_no - 1);
+			overlay->next = buckets[idx];
+			buckets[idx] = overlay;
+			overlay = next;
+		}
+	}
+
+	table->bytes += (buckets_no - table->buckets_no) * sizeof(o_overlay_t *);
+	free(table->buckets);
+	table->buckets = buckets;
+	table->buckets_no = buckets_no;
+}
+
+/**
+ * @brief Finds the overlay of a user, or creates an empty one.
+ *
+ * @param table The table.
+ * @param user The id of the user.
+ * @return o_overlay_t* The overlay, or NULL if there is no memory left.
+ */
+static o_overlay_t *make_overlay(o_table_t *table, u64_t user)
+{
+	o_overlay_t *overlay = get_overlay(table, user);
+	if (overlay)
+		return overlay;
+
+	overlay = (o_overlay_t *)malloc(sizeof(o_overlay_t));
+	if (!overlay)
+		return NULL;
+
+	overlay->user = user;
+	overlay->entries = NULL;
+	overlay->entries_no = 0;
+	overlay->cap = 0;
+
+	if (table->users_no >= table->buckets_no)
+		grow_table(table);
+
+	u64_t idx = hash_user(user) & (table->buckets_no - 1);
+	overlay->next = table->buckets[idx];
+	table->buckets[idx] = overlay;
+	table->users_no++;
+	table->bytes += sizeof(o_overlay_t);
+
+	return overlay;
+}
+
+/**
+ * @brief Frees an overlay, with its words.
+ *
+ * @param overlay The overlay.
+ */
+static void free_overlay(o_overlay_t *overlay)
+{
+	for (u32_t i = 0; i < overlay->entries_no; i++)
+		free(overlay->entries[i].word);
+
+	free(overlay->entries);
+	free(overlay);
+}
+
+/**
+ * @brief Inserts an empty entry for a word, keeping the entries sorted.
+ *
+ * @param table The table.
+ * @param overlay The overlay.
+ * @param word The word.
+ * @param idx The index of the entry, from o_find_entry.
+ * @return o_entry_t* The entry, or NULL if there is no memory left.
+ */
+static o_entry_t *add_entry(o_table_t *table, o_overlay_t *overlay,
+							char *word, u32_t idx)
+{
+	if (overlay->entries_no == overlay->cap) {
+		u32_t cap = overlay->cap ? 2 * overlay->cap : OVERLAY_MIN_CAP;
+		o_entry_t *entries = (o_entry_t *)realloc(overlay->entries, cap *
+												  sizeof(o_entry_t));
+		if (!entries)
+			return NULL;
+
+		table->bytes += (cap - overlay->cap) * sizeof(o_entry_t);
+		overlay->entries = entries;
+		overlay->cap = cap;
+	}
+
+	size_t len = strlen(word) + 1;
+	char *copy = (char *)malloc(len);
+	if (!copy)
+		return NULL;
+
+	memcpy(copy, word, len);
+	table->bytes += len;
+
+	memmove(&overlay->entries[idx + 1], &overlay->entries[idx],
+			(overlay->entries_no - idx) * sizeof(o_entry_t));
+	overlay->entries_no++;
+
+	o_entry_t *entry = &overlay->entries[idx];
+	entry->word = copy;
+	entry->freq = 0;
+	entry->score = 0;
+	entry->epoch = 0;
+	entry->state = NOT_END;
+	return entry;
+}
+
+o_table_t *create_overlays(void)
+{
+	o_table_t *table = (o_table_t *)malloc(sizeof(o_table_t));
+	if (!table)
+		return NULL;
+
+	table->buckets = (o_overlay_t **)calloc(OVERLAY_BUCKETS,
+											sizeof(o_overlay_t *));
+	if (!table->buckets) {
+		free(table);
+		return NULL;
+	}
+
+	table->buckets_no = OVERLAY_BUCKETS;
+	table->users_no = 0;
+	table->bytes = sizeof(o_table_t) + OVERLAY_BUCKETS * sizeof(o_overlay_t *);
+
+	return table;
+}
+
+void free_overlays(o_table_t *table)
+{
+	if (!table)
+		return;
+
+	for (u64_t i = 0; i < table->buckets_no; i++) {
+		o_overlay_t *overlay = table->buckets[i];
+		while (overlay) {
+			o_overlay_t *next = overlay->next;
+			free_overlay(overlay);
+			overlay = next;
+		}
+	}
+
+	free(table->buckets);
+	free(table);
+}
+
+o_overlay_t *get_overlay(o_table_t *table, u64_t user)
+{
+	if (!table)
+		return NULL;
+
+	o_overlay_t *overlay = table->buckets[hash_user(user) &
+										  (table->buckets_no - 1)];
+	while (overlay && overlay->user != user)
+		overlay = overlay->next;
+
+	return overlay;
+}
+
+void drop_overlay(o_table_t *table, u64_t user)
+{
+	o_overlay_t **link = &table->buckets[hash_user(user) &
+										 (table->buckets_no - 1)];
+	while (*link && (*link)->user != user)
+		link = &(*link)->next;
+
+	o_overlay_t *overlay = *link;
+	if (!overlay)
+		return;
+
+	*link = overlay->next;
+	table->users_no--;
+	table->bytes -= sizeof(o_overlay_t) + overlay->cap * sizeof(o_entry_t);
+	for (u32_t i = 0; i < overlay->entries_no; i++)
+		table->bytes -= strlen(overlay->entries[i].word) + 1;
+
+	free_overlay(overlay);
+}
+
+u8_t o_find_entry(o_overlay_t *overlay, char *word, u32_t *idx)
+{
+	u32_t lo = 0, hi = overlay->entries_no;
+
+	while (lo < hi) {
+		u32_t mid = lo + (hi - lo) / 2;
+		if (strcmp(overlay->entries[mid].word, word) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	*idx = lo;
+	return lo < overlay->entries_no &&
+		   strcmp(overlay->entries[lo].word, word) == 0;
+}
+
+int overlay_insert(o_table_t *table, g_tree_t *trie, u64_t user, char *word)
+{
+	o_overlay_t *overlay = make_overlay(table, user);
+	if (!overlay)
+		return -1;
+
+	u32_t idx;
+	o_entry_t *entry = NULL;
+	if (o_find_entry(overlay, word, &idx))
+		entry = &overlay->entries[idx];
+
+	if (!entry) {
+		entry = add_entry(table, overlay, word, idx);
+		if (!entry) {
+			if (overlay->entries_no == 0)
+				drop_overlay(table, user);
+			return -1;
+		}
+
+		/**
+		 * A shared word keeps its past uses, and the user's new ones are
+		 * counted on top of them
+		 */
+		g_node_t *end = find_key(trie, word);
+		if (end) {
+			entry->freq = ((key_t *)end->data)->freq;
+			entry->score = ((key_t *)end->data)->score;
+			entry->epoch = ((key_t *)end->data)->epoch;
+		}
+	} else if (entry->state == TOMB) {
+		/**
+		 * Like in the trie, a removed word starts again from zero
+		 */
+		entry->freq = 0;
+		entry->score = 0;
+	}
+
+	entry->state = END;
+
+	key_t data;
+	data.freq = entry->freq;
+	data.score = entry->score;
+	data.epoch = entry->epoch;
+	bump_key(&data, trie->epoch);
+
+	entry->freq = data.freq;
+	entry->score = data.score;
+	entry->epoch = data.epoch;
+	return 0;
+}
+
+int overlay_remove(o_table_t *table, g_tree_t *trie, u64_t user, char *word)
+{
+	u8_t shared = find_key(trie, word) != NULL;
+	o_overlay_t *overlay = get_overlay(table, user);
+
+	u32_t idx;
+	if (overlay && o_find_entry(overlay, word, &idx)) {
+		o_entry_t *entry = &overlay->entries[idx];
+		if (shared) {
+			entry->state = TOMB;
+			return 0;
+		}
+
+		/**
+		 * Nothing below the entry to hide, so it goes away
+		 */
+		table->bytes -= strlen(entry->word) + 1;
+		free(entry->word);
+		memmove(entry, entry + 1, (overlay->entries_no - idx - 1) *
+				sizeof(o_entry_t));
+		overlay->entries_no--;
+
+		if (overlay->entries_no == 0)
+			drop_overlay(table, user);
+		return 0;
+	}
+
+	if (!shared)
+		return 0;
+
+	overlay = make_overlay(table, user);
+	if (!overlay)
+		return -1;
+
+	o_find_entry(overlay, word, &idx);
+	o_entry_t *entry = add_entry(table, overlay, word, idx);
+	if (!entry) {
+		if (overlay->entries_no == 0)
+			drop_overlay(table, user);
+		return -1;
+	}
+
+	entry->state = TOMB;
+	return 0;
+}
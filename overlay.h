@@ -0,0 +1,89 @@
+#ifndef OVERLAY_H_
+#define OVERLAY_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "structs.h"
+#include "utils.h"
+#include "generic_tree.h"
+
+/**
+ * An overlay holds the changes of one user to the shared trie, and nothing
+ * else: the words the user inserted or used, with the user's own
+ * frequencies, and the words the user removed, as TOMB entries. The entries
+ * are kept in a sorted array, so the entries under a prefix are adjacent,
+ * and a search narrows them letter by letter while it walks the trie. An
+ * overlay costs a few bytes per change, so a process can hold the overlays
+ * of many users. They are found by the id of the user, in a hash table.
+ */
+
+/**
+ * @brief Creates an empty table of overlays.
+ *
+ * @return o_table_t* The table, or NULL if there is no memory left.
+ */
+o_table_t *create_overlays(void);
+
+/**
+ * @brief Frees a table and all its overlays.
+ *
+ * @param table The table, it can be NULL.
+ */
+void free_overlays(o_table_t *table);
+
+/**
+ * @brief Finds the overlay of a user.
+ *
+ * @param table The table, it can be NULL.
+ * @param user The id of the user.
+ * @return o_overlay_t* The overlay, or NULL if the user has no changes.
+ */
+o_overlay_t *get_overlay(o_table_t *table, u64_t user);
+
+/**
+ * @brief Frees the overlay of a user, so the user sees the shared trie again.
+ *
+ * @param table The table.
+ * @param user The id of the user.
+ */
+void drop_overlay(o_table_t *table, u64_t user);
+
+/**
+ * @brief Finds the entry of a word, by binary search.
+ *
+ * @param overlay The overlay.
+ * @param word The word.
+ * @param idx Where to store the index of the entry, or the index where it
+ * should be inserted.
+ * @return u8_t 1 if the word has an entry, 0 otherwise.
+ */
+u8_t o_find_entry(o_overlay_t *overlay, char *word, u32_t *idx);
+
+/**
+ * @brief Inserts a word for a user, or counts one more use of it. A word of
+ * the shared trie starts from its shared frequency.
+ *
+ * @param table The table.
+ * @param trie The shared trie.
+ * @param user The id of the user.
+ * @param word The word.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+int overlay_insert(o_table_t *table, g_tree_t *trie, u64_t user, char *word);
+
+/**
+ * @brief Removes a word for a user. A word of the shared trie gets a TOMB
+ * entry, a word of the user alone loses its entry.
+ *
+ * @param table The table.
+ * @param trie The shared trie.
+ * @param user The id of the user.
+ * @param word The word.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+int overlay_remove(o_table_t *table, g_tree_t *trie, u64_t user, char *word);
+
+#endif  // OVERLAY_H_
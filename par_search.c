@@ -0,0 +1,192 @@
+#include "par_search.h"
+
+int plan_tasks(g_node_t *node, p_task_t *tmpl, size_t split_keys,
+			   p_task_t **tasks, unsigned int *tasks_no,
+			   unsigned int *tasks_cap)
+{
+	/**
+	 * The same pruning as in search_kdiff_words, so the tasks don't start
+	 * in branches that can't match
+	 */
+	if (tmpl->word) {
+		if (tmpl->depth > tmpl->wordlen)
+			return 0;
+
+		if (!k_different_word(tmpl->prefix, tmpl->depth, tmpl->word,
+							  tmpl->wordlen, tmpl->k))
+			return 0;
+	}
+
+	u8_t split = ((key_t *)node->data)->subkeys > split_keys &&
+				 tmpl->depth < PAR_SPLIT_DEPTH && node->children_num > 0;
+
+	/**
+	 * There is nothing to split once the whole word was matched
+	 */
+	if (tmpl->word && tmpl->depth >= tmpl->wordlen)
+		split = 0;
+
+	if (*tasks_no == *tasks_cap) {
+		unsigned int cap = *tasks_cap ? 2 * *tasks_cap : 64;
+		p_task_t *aux = (p_task_t *)realloc(*tasks, cap * sizeof(p_task_t));
+		if (!aux)
+			return -1;
+
+		*tasks = aux;
+		*tasks_cap = cap;
+	}
+
+	p_task_t *task = &(*tasks)[*tasks_no];
+	*task = *tmpl;
+	task->node = node;
+	task->whole = !split;
+	(*tasks_no)++;
+
+	if (!split)
+		return 0;
+
+	for (unsigned int i = 0; i < ALPH; i++) {
+		if (!has_live_keys(node->children[i]))
+			continue;
+
+		tmpl->prefix[tmpl->depth] = i + 'a';
+		tmpl->depth++;
+		int ret = plan_tasks(node->children[i], tmpl, split_keys, tasks,
+							 tasks_no, tasks_cap);
+		tmpl->depth--;
+
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+void kdiff_task(void *arg)
+{
+	p_task_t *task = (p_task_t *)arg;
+
+	/**
+	 * If there is no memory for the buffer, the task is left undone, and
+	 * the merge will search its subtrie again
+	 */
+	task->out = NULL;
+	task->stream = open_memstream(&task->out, &task->out_len);
+	if (!task->stream)
+		return;
+
+	/**
+	 * A node that was split can't be a result: the split stops before the
+	 * depth of the word, and only the keys as long as the word match
+	 */
+	if (task->whole) {
+		char buff[MAX_BUFF];
+		memcpy(buff, task->prefix, task->depth);
+		search_kdiff_words(task->node, buff, task->depth, task->word,
+						   task->wordlen, task->k, &task->found,
+						   task->stream);
+	}
+
+	fclose(task->stream);
+}
+
+p_task_t *run_tasks(pool_t *pool, g_node_t *root, p_task_t *tmpl,
+					void (*run)(void *), unsigned int *tasks_no)
+{
+	p_task_t *tasks = NULL;
+	unsigned int tasks_cap = 0;
+	*tasks_no = 0;
+
+	/**
+	 * Aim for a few tasks per worker, the stealing takes care of the rest
+	 */
+	size_t split_keys = ((key_t *)root->data)->subkeys /
+						(pool->threads_no * PAR_TASKS_PER_THREAD);
+	if (plan_tasks(root, tmpl, split_keys, &tasks, tasks_no, &tasks_cap) < 0) {
+		free(tasks);
+		return NULL;
+	}
+
+	p_job_t *jobs = (p_job_t *)malloc((*tasks_no + 1) * sizeof(p_job_t));
+	if (!jobs) {
+		free(tasks);
+		return NULL;
+	}
+
+	for (unsigned int i = 0; i < *tasks_no; i++) {
+		jobs[i].run = run;
+		jobs[i].arg = &tasks[i];
+	}
+
+	int ret = pool_run(pool, jobs, *tasks_no);
+	free(jobs);
+
+	if (ret < 0) {
+		free(tasks);
+		return NULL;
+	}
+
+	return tasks;
+}
+
+u8_t worth_parallel(pool_t *pool, g_node_t *root)
+{
+	if (!pool || pool->threads_no < 2)
+		return 0;
+
+	if (((key_t *)root->data)->subkeys < PAR_MIN_KEYS)
+		return 0;
+
+	return 1;
+}
+
+unsigned int par_search_kdiff(pool_t *pool, g_node_t *root, char *word,
+							  unsigned int k, FILE *out)
+{
+	unsigned int found = 0;
+	char buff[MAX_BUFF];
+	p_task_t *tasks = NULL;
+	unsigned int tasks_no;
+
+	if (worth_parallel(pool, root)) {
+		p_task_t tmpl;
+		memset(&tmpl, 0, sizeof(tmpl));
+		tmpl.word = word;
+		tmpl.wordlen = strlen(word);
+		tmpl.k = k;
+
+		tasks = run_tasks(pool, root, &tmpl, kdiff_task, &tasks_no);
+	}
+
+	/**
+	 * A small query, or the pool couldn't take it
+	 */
+	if (!tasks) {
+		search_kdiff_words(root, buff, 0, word, strlen(word), k, &found,
+						   out);
+		return found;
+	}
+
+	/**
+	 * The tasks are in lexicographic order, so their buffers are too
+	 */
+	for (unsigned int i = 0; i < tasks_no; i++) {
+		if (!tasks[i].stream) {
+			tasks[i].found = 0;
+			if (tasks[i].whole) {
+				memcpy(buff, tasks[i].prefix, tasks[i].depth);
+				search_kdiff_words(tasks[i].node, buff, tasks[i].depth,
+								   word, tasks[i].wordlen, k,
+								   &tasks[i].found, out);
+			}
+		} else {
+			fwrite(tasks[i].out, 1, tasks[i].out_len, out);
+		}
+
+		found += tasks[i].found;
+		free(tasks[i].out);
+	}
+
+	free(tasks);
+	return found;
+}
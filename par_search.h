@@ -0,0 +1,85 @@
+#ifndef PAR_SEARCH_H_
+#define PAR_SEARCH_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "structs.h"
+#include "utils.h"
+#include "generic_tree.h"
+#include "magic_keyboard.h"
+#include "pool.h"
+
+/**
+ * @brief Splits the top levels of a subtrie into tasks, in lexicographic
+ * order. A node is split only if it has more than split_keys live keys, so
+ * the big subtries get more, smaller tasks. A split node gets a task of its
+ * own, that checks just the node, placed before the tasks of its children.
+ *
+ * @param node The node we want to split.
+ * @param tmpl A task with the query parameters, copied into every new task.
+ * If tmpl->word is set, the branches that can't match it are left out.
+ * @param split_keys The number of live keys over which a node is split.
+ * @param tasks The address of the tasks array, it grows as needed.
+ * @param tasks_no The number of tasks in the array.
+ * @param tasks_cap The capacity of the array.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+int plan_tasks(g_node_t *node, p_task_t *tmpl, size_t split_keys,
+			   p_task_t **tasks, unsigned int *tasks_no,
+			   unsigned int *tasks_cap);
+
+/**
+ * @brief The job of an AUTOCORRECT task. It writes the words it finds in its
+ * own buffer, so the workers never share the output. If the buffer can't be
+ * created, the stream of the task is left NULL.
+ *
+ * @param arg The p_task_t of the job.
+ */
+void kdiff_task(void *arg);
+
+/**
+ * @brief Splits a search into tasks and runs them on the pool. It is the
+ * common part of the parallel searches.
+ *
+ * @param pool The pool.
+ * @param root The root of the subtrie we search.
+ * @param tmpl The query parameters.
+ * @param run The job of a task.
+ * @param tasks_no Where to store the number of tasks.
+ * @return p_task_t* The tasks, in lexicographic order, with their results,
+ * or NULL if the pool couldn't run them. The search must be done on the
+ * calling thread then.
+ */
+p_task_t *run_tasks(pool_t *pool, g_node_t *root, p_task_t *tmpl,
+					void (*run)(void *), unsigned int *tasks_no);
+
+/**
+ * @brief Checks if a search is worth running on the pool: there must be more
+ * than one worker, and at least PAR_MIN_KEYS live keys in the subtrie.
+ *
+ * @param pool The pool, it can be NULL.
+ * @param root The root of the subtrie we search.
+ * @return u8_t Returns 1 if the search should be parallel, or 0 otherwise.
+ */
+u8_t worth_parallel(pool_t *pool, g_node_t *root);
+
+/**
+ * @brief The parallel version of search_kdiff_words. The results are merged
+ * in the order of the tasks, so they are printed in the same lexicographic
+ * order as the sequential search. The small queries run on the calling
+ * thread, and so do the ones the pool can't take.
+ *
+ * @param pool The pool, it can be NULL.
+ * @param root The root of the trie.
+ * @param word The word we want to find the k-different words.
+ * @param k The maximum number of different letters.
+ * @param out The file where the words are printed.
+ * @return unsigned int The number of words found.
+ */
+unsigned int par_search_kdiff(pool_t *pool, g_node_t *root, char *word,
+							  unsigned int k, FILE *out);
+
+#endif  // PAR_SEARCH_H_
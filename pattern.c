@@ -0,0 +1,188 @@
+#include "pattern.h"
+
+/**
+ * @brief Parses a character class, after its '['.
+ *
+ * @param pattern The pattern, at the first character of the class.
+ * @param letters Where to store the letters of the class.
+ * @return const char* The pattern after the ']', or NULL if the class is
+ * invalid or empty.
+ */
+static const char *parse_class(const char *pattern, u32_t *letters)
+{
+	u8_t negated = 0;
+	if (*pattern == '^') {
+		negated = 1;
+		pattern++;
+	}
+
+	*letters = 0;
+	while (*pattern != ']') {
+		if (*pattern < 'a' || *pattern > 'z')
+			return NULL;
+
+		char first = *pattern, last = *pattern;
+		if (pattern[1] == '-' && pattern[2] != ']') {
+			last = pattern[2];
+			if (last < first || last > 'z')
+				return NULL;
+
+			pattern += 2;
+		}
+
+		for (char c = first; c <= last; c++)
+			*letters |= 1u << (c - 'a');
+
+		pattern++;
+	}
+
+	if (negated)
+		*letters = ~*letters & MATCH_ALL_LETTERS;
+
+	/**
+	 * A state that accepts no letter would never lead to a match, and the
+	 * search relies on every state leading to one
+	 */
+	if (*letters == 0)
+		return NULL;
+
+	return pattern + 1;
+}
+
+int compile_pattern(const char *pattern, m_pattern_t *compiled)
+{
+	compiled->tokens_no = 0;
+	compiled->stars = 0;
+
+	if (*pattern == '\0')
+		return -1;
+
+	while (*pattern != '\0') {
+		unsigned int idx = compiled->tokens_no;
+		char c = *pattern;
+
+		/**
+		 * Many '*' in a row are the same as one
+		 */
+		if (c == '*' && idx > 0 && (compiled->stars >> (idx - 1)) & 1) {
+			pattern++;
+			continue;
+		}
+
+		if (idx == MATCH_MAX_TOKENS)
+			return -1;
+
+		if (c == '*') {
+			compiled->classes[idx] = MATCH_ALL_LETTERS;
+			compiled->stars |= 1UL << idx;
+			pattern++;
+		} else if (c == '?') {
+			compiled->classes[idx] = MATCH_ALL_LETTERS;
+			pattern++;
+		} else if (c == '[') {
+			pattern = parse_class(pattern + 1, &compiled->classes[idx]);
+			if (!pattern)
+				return -1;
+		} else if (c >= 'a' && c <= 'z') {
+			compiled->classes[idx] = 1u << (c - 'a');
+			pattern++;
+		} else {
+			return -1;
+		}
+
+		compiled->tokens_no++;
+	}
+
+	return 0;
+}
+
+u64_t m_closure(m_pattern_t *pattern, u64_t set)
+{
+	/**
+	 * A '*' can match nothing, so the state after it is reached too. The
+	 * states are visited in order, so a chain of skips is followed in a
+	 * single pass.
+	 */
+	for (unsigned int i = 0; i < pattern->tokens_no; i++) {
+		if ((set >> i) & (pattern->stars >> i) & 1)
+			set |= 1UL << (i + 1);
+	}
+
+	return set;
+}
+
+u64_t m_start(m_pattern_t *pattern)
+{
+	return m_closure(pattern, 1);
+}
+
+u64_t m_step(m_pattern_t *pattern, u64_t set, char c)
+{
+	u32_t letter = 1u << (c - 'a');
+	u64_t next = 0;
+
+	for (unsigned int i = 0; i < pattern->tokens_no; i++) {
+		if (!((set >> i) & 1) || !(pattern->classes[i] & letter))
+			continue;
+
+		/**
+		 * A '*' stays where it is, to eat more letters
+		 */
+		if ((pattern->stars >> i) & 1)
+			next |= 1UL << i;
+		else
+			next |= 1UL << (i + 1);
+	}
+
+	return m_closure(pattern, next);
+}
+
+u32_t m_letters(m_pattern_t *pattern, u64_t set)
+{
+	u32_t letters = 0;
+
+	for (unsigned int i = 0; i < pattern->tokens_no; i++) {
+		if ((set >> i) & 1)
+			letters |= pattern->classes[i];
+	}
+
+	return letters;
+}
+
+u8_t m_accepts(m_pattern_t *pattern, u64_t set)
+{
+	return (set >> pattern->tokens_no) & 1;
+}
+
+void search_pattern(g_node_t *root, m_search_t *search, u64_t set,
+					size_t depth)
+{
+	if (((key_t *)root->data)->ending == END &&
+		m_accepts(search->pattern, set)) {
+		search->buff[depth] = '\0';
+		search->found++;
+
+		if (search->found_func(search->buff, search->found_arg) != 0 ||
+			search->found == search->limit) {
+			search->stop = 1;
+			return;
+		}
+	}
+
+	/**
+	 * Only the letters some state accepts are tried, so a leaf, or a set
+	 * with nothing left to match, ends the walk right away
+	 */
+	u32_t letters = m_letters(search->pattern, set);
+	if (root->children_num == 0 || letters == 0)
+		return;
+
+	for (unsigned int i = 0; i < ALPH && !search->stop; i++) {
+		if (!((letters >> i) & 1) || !has_live_keys(root->children[i]))
+			continue;
+
+		search->buff[depth] = i + 'a';
+		search_pattern(root->children[i], search,
+					   m_step(search->pattern, set, i + 'a'), depth + 1);
+	}
+}
@@ -0,0 +1,91 @@
+#ifndef PATTERN_H_
+#define PATTERN_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "structs.h"
+#include "utils.h"
+#include "generic_tree.h"
+
+/**
+ * A pattern is a word with wildcards: '?' stands for any letter, '*' for
+ * any number of letters, none included, and a class like [aeiou], [a-f] or
+ * [^xyz] for one letter of the class. It is compiled into a small NFA,
+ * with one state before every token and an accepting state after the last
+ * one, so a set of states fits in a 64-bit mask. The search walks the trie
+ * and the NFA together, and a child is visited only if some state accepts
+ * its letter, so no subtrie whose path can't start a match is ever entered.
+ */
+
+/**
+ * @brief Compiles a pattern.
+ *
+ * @param pattern The pattern.
+ * @param compiled Where to store the NFA.
+ * @return int Returns 0 on success, or -1 if the pattern is invalid or has
+ * more than MATCH_MAX_TOKENS tokens.
+ */
+int compile_pattern(const char *pattern, m_pattern_t *compiled);
+
+/**
+ * @brief Adds to a set the states reached without reading a letter, by
+ * skipping the '*' tokens.
+ *
+ * @param pattern The NFA.
+ * @param set The set of states.
+ * @return u64_t The closed set.
+ */
+u64_t m_closure(m_pattern_t *pattern, u64_t set);
+
+/**
+ * @brief Gives the set of states before any letter.
+ *
+ * @param pattern The NFA.
+ * @return u64_t The set of states.
+ */
+u64_t m_start(m_pattern_t *pattern);
+
+/**
+ * @brief Moves a set of states over a letter.
+ *
+ * @param pattern The NFA.
+ * @param set The set of states.
+ * @param c The letter.
+ * @return u64_t The new set, 0 if no state accepts the letter.
+ */
+u64_t m_step(m_pattern_t *pattern, u64_t set, char c);
+
+/**
+ * @brief Gives the letters that some state of a set accepts.
+ *
+ * @param pattern The NFA.
+ * @param set The set of states.
+ * @return u32_t The letters, as a bitmask.
+ */
+u32_t m_letters(m_pattern_t *pattern, u64_t set);
+
+/**
+ * @brief Checks if a set holds the accepting state.
+ *
+ * @param pattern The NFA.
+ * @param set The set of states.
+ * @return u8_t 1 if it does, 0 otherwise.
+ */
+u8_t m_accepts(m_pattern_t *pattern, u64_t set);
+
+/**
+ * @brief Finds the keys of a subtrie that match a pattern, in lexicographic
+ * order, and gives them to the search's found_func as they are found.
+ *
+ * @param root The root of the subtrie.
+ * @param search The search, with the letters of the path to root in buff.
+ * @param set The states of the NFA after the path to root.
+ * @param depth The length of the path to root.
+ */
+void search_pattern(g_node_t *root, m_search_t *search, u64_t set,
+					size_t depth);
+
+#endif  // PATTERN_H_
@@ -0,0 +1,543 @@
+#include "planner.h"
+
+/**
+ * @brief Records a strategy that ran.
+ *
+ * @param plan The plan.
+ * @param strategy The strategy.
+ * @param visited The nodes it visited.
+ * @param tasks The tasks it ran on the pool, 0 if it ran on this thread.
+ */
+static void add_step(q_plan_t *plan, q_strategy_t strategy, u64_t visited,
+					 unsigned int tasks)
+{
+	plan->strategies[plan->steps_no] = strategy;
+	plan->visited[plan->steps_no] = visited;
+	plan->tasks[plan->steps_no] = tasks;
+	plan->steps_no++;
+}
+
+/**
+ * @brief Raises the best score shared by the tasks of a search.
+ *
+ * @param floor The shared score.
+ * @param score The score of a key found by a task.
+ */
+static void raise_floor(u64_t *floor, u64_t score)
+{
+	u64_t seen = __atomic_load_n(floor, __ATOMIC_RELAXED);
+	while (seen < score &&
+		   !__atomic_compare_exchange_n(floor, &seen, score, 1,
+										__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+/**
+ * @brief Finds the first key of a subtrie, like get_first_combination.
+ *
+ * @param root The root of the subtrie, with live keys.
+ * @param visited Where to store the number of nodes visited.
+ * @return g_node_t* The ending node of the first key.
+ */
+static g_node_t *descent_search(g_node_t *root, u64_t *visited)
+{
+	*visited = 1;
+
+	while (((key_t *)root->data)->ending != END) {
+		unsigned int i;
+		for (i = 0; i < ALPH; i++) {
+			if (has_live_keys(root->children[i]))
+				break;
+		}
+
+		if (i == ALPH)
+			break;
+
+		root = root->children[i];
+		(*visited)++;
+	}
+
+	return root;
+}
+
+/**
+ * @brief Finds the shortest key of a subtrie, level by level. The children
+ * are queued in lexicographic order, so the first key found is also the
+ * first one of its length, like in parallel_searching.
+ *
+ * @param root The root of the subtrie, with live keys.
+ * @param visited Where to store the number of nodes visited.
+ * @return g_node_t* The ending node of the shortest key, or NULL if there is
+ * no memory left for the queue.
+ */
+static g_node_t *levels_search(g_node_t *root, u64_t *visited)
+{
+	u64_t cap = PLAN_MIN_CAP, head = 0, tail = 0;
+	g_node_t **queue = (g_node_t **)malloc(cap * sizeof(g_node_t *));
+	g_node_t *found = NULL;
+
+	if (!queue)
+		return NULL;
+
+	*visited = 0;
+	queue[tail++] = root;
+
+	while (head < tail) {
+		g_node_t *node = queue[head++];
+		(*visited)++;
+
+		if (((key_t *)node->data)->ending == END) {
+			found = node;
+			break;
+		}
+
+		for (unsigned int i = 0; i < ALPH; i++) {
+			if (!has_live_keys(node->children[i]))
+				continue;
+
+			/**
+			 * The visited nodes are dropped from the front first, the queue
+			 * grows only if it is still more than half full
+			 */
+			if (tail == cap && head >= cap / 2) {
+				memmove(queue, queue + head,
+						(tail - head) * sizeof(g_node_t *));
+				tail -= head;
+				head = 0;
+			} else if (tail == cap) {
+				g_node_t **bigger = (g_node_t **)realloc(queue, 2 * cap *
+														 sizeof(g_node_t *));
+				if (!bigger) {
+					free(queue);
+					return NULL;
+				}
+
+				queue = bigger;
+				cap *= 2;
+			}
+
+			queue[tail++] = node->children[i];
+		}
+	}
+
+	free(queue);
+	return found;
+}
+
+/**
+ * @brief Walks a subtrie in lexicographic order, for the most frequent key,
+ * and skips the children that can't hold a better one.
+ *
+ * @param node The current node.
+ * @param search The state of the search.
+ */
+static void bounded_walk(g_node_t *node, q_bounded_t *search)
+{
+	key_t *key = (key_t *)node->data;
+	search->visited++;
+
+	/**
+	 * A key with the same score as the best one wins only if it comes first,
+	 * and only the guess can be beaten like that, before the walk reaches it
+	 */
+	if (node == search->seed) {
+		search->passed = 1;
+	} else if (key->ending == END) {
+		u64_t score = key_score(key, search->epoch);
+		if (score > search->best_score ||
+			(score == search->best_score && search->best == search->seed &&
+			 !search->passed)) {
+			search->best = node;
+			search->best_score = score;
+			if (search->floor)
+				raise_floor(search->floor, score);
+		}
+	}
+
+	for (unsigned int i = 0; i < ALPH; i++) {
+		g_node_t *child = node->children[i];
+		if (!has_live_keys(child))
+			continue;
+
+		/**
+		 * Another task may hold a better key, but only a strictly better
+		 * one: the ties are settled when the tasks are merged
+		 */
+		u64_t bound = key_bound((key_t *)child->data, search->epoch);
+		u8_t ties = search->best == search->seed && !search->passed;
+		if (bound < search->best_score ||
+			(bound == search->best_score && !ties) ||
+			(search->floor &&
+			 bound < __atomic_load_n(search->floor, __ATOMIC_RELAXED)))
+			continue;
+
+		bounded_walk(child, search);
+	}
+}
+
+/**
+ * @brief Guesses the most frequent key of a subtrie: it follows the best
+ * bound down, until a key beats the bounds of all the children of its node.
+ * A node of a live subtrie without live children is the end of a key, so
+ * the guess is always a key, never the prefix.
+ *
+ * @param root The root of the subtrie, with live keys.
+ * @param epoch The current decay epoch of the trie.
+ * @param visited Where to store the number of nodes visited.
+ * @return g_node_t* The ending node of the guess.
+ */
+static g_node_t *seed_descent(g_node_t *root, unsigned int epoch,
+							  u64_t *visited)
+{
+	g_node_t *seed = root;
+	*visited = 0;
+
+	for (;;) {
+		key_t *key = (key_t *)seed->data;
+		g_node_t *next = NULL;
+		u64_t next_bound = 0;
+		(*visited)++;
+
+		for (unsigned int i = 0; i < ALPH; i++) {
+			if (!has_live_keys(seed->children[i]))
+				continue;
+
+			u64_t bound = key_bound((key_t *)seed->children[i]->data, epoch);
+			if (!next || bound > next_bound) {
+				next = seed->children[i];
+				next_bound = bound;
+			}
+		}
+
+		if (!next ||
+			(key->ending == END && key_score(key, epoch) >= next_bound))
+			return seed;
+
+		seed = next;
+	}
+}
+
+/**
+ * @brief Finds the most frequent key of a subtrie, like parallel_searching:
+ * the first key in lexicographic order with the best score, even when all
+ * the scores decayed to 0.
+ *
+ * @param root The root of the subtrie, with live keys.
+ * @param epoch The current decay epoch of the trie.
+ * @param floor The best score found by the other tasks of the search, or
+ * NULL for a search without tasks.
+ * @param visited Where to store the number of nodes visited.
+ * @return g_node_t* The ending node of the most frequent key. In a task,
+ * if a better key is elsewhere, it may be a worse one, or NULL.
+ */
+static g_node_t *bounded_search(g_node_t *root, unsigned int epoch,
+								u64_t *floor, u64_t *visited)
+{
+	q_bounded_t search;
+	u64_t descent;
+
+	/**
+	 * A task that can't even tie the best score of the others has nothing
+	 * to offer
+	 */
+	if (floor && key_bound((key_t *)root->data, epoch) <
+				 __atomic_load_n(floor, __ATOMIC_RELAXED)) {
+		*visited = 1;
+		return NULL;
+	}
+
+	/**
+	 * The walk starts with a good score, to skip the rest
+	 */
+	g_node_t *seed = seed_descent(root, epoch, &descent);
+
+	search.seed = seed;
+	search.best = seed;
+	search.best_score = key_score((key_t *)seed->data, epoch);
+	search.passed = 0;
+	search.epoch = epoch;
+	search.visited = descent;
+	search.floor = floor;
+	if (floor)
+		raise_floor(floor, search.best_score);
+
+	bounded_walk(root, &search);
+	*visited = search.visited;
+
+	return search.best;
+}
+
+/**
+ * @brief Walks a whole subtrie for the shortest and the most frequent keys,
+ * like parallel_searching, and counts the nodes.
+ *
+ * @param root The root of the subtrie.
+ * @param shortest Where the shortest key so far is stored.
+ * @param frequent Where the most frequent key so far is stored, NULL at
+ * first.
+ * @param epoch The current decay epoch of the trie.
+ * @param visited The number of nodes visited so far.
+ */
+static void scan_search(g_node_t *root, g_node_t **shortest,
+						g_node_t **frequent, unsigned int epoch,
+						u64_t *visited)
+{
+	key_t *key = (key_t *)root->data;
+	(*visited)++;
+
+	if (key->ending == END) {
+		if (!*frequent || key_score(key, epoch) >
+						  key_score((key_t *)(*frequent)->data, epoch))
+			*frequent = root;
+
+		if (key->key_len < ((key_t *)(*shortest)->data)->key_len)
+			*shortest = root;
+	}
+
+	for (unsigned int i = 0; i < ALPH; i++) {
+		if (has_live_keys(root->children[i]))
+			scan_search(root->children[i], shortest, frequent, epoch,
+						visited);
+	}
+}
+
+/**
+ * @brief The job of a bounded task. A node that was split only offers its
+ * own key, its children have tasks of their own.
+ *
+ * @param arg The p_task_t of the job.
+ */
+static void bounded_task(void *arg)
+{
+	p_task_t *task = (p_task_t *)arg;
+
+	task->frequent = NULL;
+	task->visited = 1;
+
+	if (task->whole)
+		task->frequent = bounded_search(task->node, task->epoch, task->floor,
+										&task->visited);
+	else if (((key_t *)task->node->data)->ending == END)
+		task->frequent = task->node;
+}
+
+/**
+ * @brief The job of a scan task, like bounded_task.
+ *
+ * @param arg The p_task_t of the job.
+ */
+static void scan_task(void *arg)
+{
+	p_task_t *task = (p_task_t *)arg;
+
+	task->shortest = task->node;
+	task->frequent = NULL;
+	task->visited = 1;
+
+	if (task->whole) {
+		task->visited = 0;
+		scan_search(task->node, &task->shortest, &task->frequent, task->epoch,
+					&task->visited);
+	} else if (((key_t *)task->node->data)->ending == END) {
+		task->frequent = task->node;
+	}
+}
+
+/**
+ * @brief Runs a search of a big subtrie as tasks on the pool.
+ *
+ * @param pool The pool, it can be NULL.
+ * @param root The root of the subtrie.
+ * @param epoch The current decay epoch of the trie.
+ * @param floor The best score shared by the tasks, 0 at first, or NULL.
+ * @param run The job of a task.
+ * @param tasks_no Where to store the number of tasks, 0 if the search has
+ * to run on the calling thread.
+ * @return p_task_t* The tasks, in lexicographic order, or NULL if the
+ * subtrie is too small or the pool couldn't take them.
+ */
+static p_task_t *run_planned(pool_t *pool, g_node_t *root, unsigned int epoch,
+							 u64_t *floor, void (*run)(void *),
+							 unsigned int *tasks_no)
+{
+	p_task_t *tasks = NULL;
+
+	if (worth_parallel(pool, root)) {
+		p_task_t tmpl;
+		memset(&tmpl, 0, sizeof(tmpl));
+		tmpl.epoch = epoch;
+		tmpl.floor = floor;
+
+		tasks = run_tasks(pool, root, &tmpl, run, tasks_no);
+	}
+
+	if (!tasks)
+		*tasks_no = 0;
+
+	return tasks;
+}
+
+/**
+ * @brief Finds the most frequent key of a subtrie, on the pool if it is big
+ * enough. The tasks share the best score, to skip the branches that can't
+ * reach it, and their keys are merged in lexicographic order, with strict
+ * comparisons, so the ties go to the same key as in bounded_search.
+ *
+ * @param pool The pool, it can be NULL.
+ * @param root The root of the subtrie, with live keys.
+ * @param epoch The current decay epoch of the trie.
+ * @param visited Where to store the number of nodes visited.
+ * @param tasks_no Where to store the number of tasks.
+ * @return g_node_t* The ending node of the most frequent key.
+ */
+static g_node_t *par_bounded_search(pool_t *pool, g_node_t *root,
+									unsigned int epoch, u64_t *visited,
+									unsigned int *tasks_no)
+{
+	u64_t descent;
+	if (!worth_parallel(pool, root)) {
+		*tasks_no = 0;
+		return bounded_search(root, epoch, NULL, visited);
+	}
+
+	/**
+	 * The guess of the whole subtrie lets most of the tasks stop at once
+	 */
+	u64_t floor = key_score((key_t *)seed_descent(root, epoch,
+												 &descent)->data, epoch);
+	p_task_t *tasks = run_planned(pool, root, epoch, &floor, bounded_task,
+								  tasks_no);
+	if (!tasks)
+		return bounded_search(root, epoch, NULL, visited);
+
+	g_node_t *frequent = NULL;
+	u64_t max_score = 0;
+	*visited = descent;
+
+	for (unsigned int i = 0; i < *tasks_no; i++) {
+		*visited += tasks[i].visited;
+		if (!tasks[i].frequent)
+			continue;
+
+		u64_t score = key_score((key_t *)tasks[i].frequent->data, epoch);
+		if (!frequent || score > max_score) {
+			frequent = tasks[i].frequent;
+			max_score = score;
+		}
+	}
+
+	free(tasks);
+	return frequent;
+}
+
+/**
+ * @brief Walks a whole subtrie for the shortest and the most frequent keys,
+ * like scan_search, on the pool if it is big enough.
+ *
+ * @param pool The pool, it can be NULL.
+ * @param root The root of the subtrie.
+ * @param shortest Where to store the shortest key.
+ * @param frequent Where to store the most frequent key.
+ * @param epoch The current decay epoch of the trie.
+ * @param visited Where to store the number of nodes visited.
+ * @param tasks_no Where to store the number of tasks.
+ */
+static void par_scan_search(pool_t *pool, g_node_t *root, g_node_t **shortest,
+							g_node_t **frequent, unsigned int epoch,
+							u64_t *visited, unsigned int *tasks_no)
+{
+	p_task_t *tasks = run_planned(pool, root, epoch, NULL, scan_task,
+								  tasks_no);
+
+	*shortest = root;
+	*frequent = NULL;
+	*visited = 0;
+
+	if (!tasks) {
+		scan_search(root, shortest, frequent, epoch, visited);
+		return;
+	}
+
+	for (unsigned int i = 0; i < *tasks_no; i++) {
+		*visited += tasks[i].visited;
+
+		size_t len = ((key_t *)tasks[i].shortest->data)->key_len;
+		if (len < ((key_t *)(*shortest)->data)->key_len)
+			*shortest = tasks[i].shortest;
+
+		if (!tasks[i].frequent)
+			continue;
+
+		u64_t score = key_score((key_t *)tasks[i].frequent->data, epoch);
+		if (!*frequent || score > key_score((key_t *)(*frequent)->data,
+											epoch))
+			*frequent = tasks[i].frequent;
+	}
+
+	free(tasks);
+}
+
+unsigned int plan_autocomplete(pool_t *pool, g_node_t *root,
+							   unsigned int mode, unsigned int epoch,
+							   g_node_t **nodes, q_plan_t *plan)
+{
+	unsigned int count = 0, tasks_no;
+	u64_t visited;
+
+	plan->steps_no = 0;
+
+	if (mode == 0 || mode == 1) {
+		nodes[count] = descent_search(root, &visited);
+		add_step(plan, Q_DESCENT, visited, 0);
+		count++;
+	}
+
+	if (mode == 1)
+		return count;
+
+	/**
+	 * A small subtrie is walked once for both keys, that costs less than 2
+	 * searches. The scan is also the way out if the queue of the levels
+	 * can't get memory.
+	 */
+	g_node_t *shortest = root, *frequent = NULL;
+	u8_t scan = mode == 0 && ((key_t *)root->data)->subkeys <= PLAN_SCAN_KEYS;
+
+	if (!scan && mode != 3) {
+		shortest = levels_search(root, &visited);
+		if (shortest)
+			add_step(plan, Q_LEVELS, visited, 0);
+		else
+			scan = 1;
+	}
+
+	if (scan) {
+		par_scan_search(pool, root, &shortest, &frequent, epoch, &visited,
+						&tasks_no);
+		add_step(plan, Q_SCAN, visited, tasks_no);
+	} else if (mode != 2) {
+		frequent = par_bounded_search(pool, root, epoch, &visited, &tasks_no);
+		add_step(plan, Q_BOUNDED, visited, tasks_no);
+	}
+
+	if (mode == 0 || mode == 2) {
+		nodes[count] = shortest;
+		count++;
+	}
+
+	if (mode == 0 || mode == 3) {
+		nodes[count] = frequent;
+		count++;
+	}
+
+	return count;
+}
+
+const char *q_strategy_name(q_strategy_t strategy)
+{
+	static const char *names[Q_STRATEGIES] = {
+		"descent", "levels", "bounded", "scan"
+	};
+
+	return names[strategy];
+}
@@ -0,0 +1,50 @@
+#ifndef PLANNER_H_
+#define PLANNER_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "structs.h"
+#include "utils.h"
+#include "generic_tree.h"
+#include "par_search.h"
+
+/**
+ * The planner picks how AUTOCOMPLETE searches the subtrie of a prefix, for
+ * every mode, instead of walking all of it. The first word is found by going
+ * down the first live child. The shortest one is found level by level, and
+ * the search stops at the first level with a key. The most frequent one is
+ * found by following the best bounds down to a first guess, then by a walk
+ * that skips every child whose bound can't beat the best key so far. A
+ * small subtrie that needs both is walked once, like before. The walks of
+ * a subtrie with at least PAR_MIN_KEYS keys are split into tasks for the
+ * pool, like the other wide searches. The words are the same as the ones of
+ * get_first_combination and parallel_searching, with the same ties.
+ */
+
+/**
+ * @brief Completes a prefix, like AUTOCOMPLETE.
+ *
+ * @param pool The pool of the wide searches, it can be NULL.
+ * @param root The ending node of the prefix, with live keys under it.
+ * @param mode The mode, from 0 to 3.
+ * @param epoch The current decay epoch of the trie.
+ * @param nodes Where to store the ending nodes of the words, room for 3.
+ * @param plan Where to store the strategies that ran.
+ * @return unsigned int The number of words.
+ */
+unsigned int plan_autocomplete(pool_t *pool, g_node_t *root,
+							   unsigned int mode, unsigned int epoch,
+							   g_node_t **nodes, q_plan_t *plan);
+
+/**
+ * @brief Gives the name of a strategy.
+ *
+ * @param strategy The strategy.
+ * @return const char* The name.
+ */
+const char *q_strategy_name(q_strategy_t strategy);
+
+#endif  // PLANNER_H_
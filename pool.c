@@ -0,0 +1,270 @@
+#include "pool.h"
+
+pool_t *create_pool(unsigned int threads_no)
+{
+	pool_t *pool = (pool_t *)malloc(sizeof(pool_t));
+	if (!pool)
+		return NULL;
+
+	if (threads_no == 0) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		threads_no = cpus > 0 ? (unsigned int)cpus : 1;
+	}
+
+	pool->deques = (w_deque_t *)malloc(threads_no * sizeof(w_deque_t));
+	pool->threads = (pthread_t *)malloc(threads_no * sizeof(pthread_t));
+	pool->workers = (p_worker_t *)malloc(threads_no * sizeof(p_worker_t));
+	if (!pool->deques || !pool->threads || !pool->workers) {
+		free(pool->deques);
+		free(pool->threads);
+		free(pool->workers);
+		free(pool);
+		return NULL;
+	}
+
+	pool->threads_no = threads_no;
+	pool->generation = 0;
+	pool->remaining = 0;
+	pool->stop = 0;
+
+	pthread_mutex_init(&pool->busy, NULL);
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work, NULL);
+	pthread_cond_init(&pool->done, NULL);
+
+	for (unsigned int i = 0; i < threads_no; i++) {
+		pool->deques[i].jobs = NULL;
+		pool->deques[i].head = 0;
+		pool->deques[i].tail = 0;
+		pool->deques[i].cap = 0;
+		pthread_mutex_init(&pool->deques[i].lock, NULL);
+	}
+
+	/**
+	 * The caller is the last worker, so it doesn't need a thread. If a
+	 * thread can't be started, the pool just works with fewer workers.
+	 */
+	for (unsigned int i = 0; i + 1 < threads_no; i++) {
+		pool->workers[i].pool = pool;
+		pool->workers[i].id = i;
+
+		if (pthread_create(&pool->threads[i], NULL, pool_thread,
+						   &pool->workers[i]) != 0) {
+			pool->threads_no = i + 1;
+			break;
+		}
+	}
+
+	/**
+	 * The caller takes the deque that follows the started threads
+	 */
+	for (unsigned int i = pool->threads_no; i < threads_no; i++)
+		pthread_mutex_destroy(&pool->deques[i].lock);
+
+	return pool;
+}
+
+int deque_reserve(w_deque_t *deque, unsigned int jobs_no)
+{
+	if (deque->cap >= jobs_no)
+		return 0;
+
+	p_job_t *jobs = (p_job_t *)realloc(deque->jobs,
+									   jobs_no * sizeof(p_job_t));
+	if (!jobs)
+		return -1;
+
+	deque->jobs = jobs;
+	deque->cap = jobs_no;
+
+	return 0;
+}
+
+void deque_push(w_deque_t *deque, p_job_t job)
+{
+	pthread_mutex_lock(&deque->lock);
+	deque->jobs[deque->tail] = job;
+	deque->tail++;
+	pthread_mutex_unlock(&deque->lock);
+}
+
+u8_t deque_pop(w_deque_t *deque, p_job_t *job)
+{
+	u8_t ret = 0;
+
+	pthread_mutex_lock(&deque->lock);
+	if (deque->head < deque->tail) {
+		deque->tail--;
+		*job = deque->jobs[deque->tail];
+		ret = 1;
+	}
+	pthread_mutex_unlock(&deque->lock);
+
+	return ret;
+}
+
+u8_t deque_steal(w_deque_t *deque, p_job_t *job)
+{
+	u8_t ret = 0;
+
+	pthread_mutex_lock(&deque->lock);
+	if (deque->head < deque->tail) {
+		*job = deque->jobs[deque->head];
+		deque->head++;
+		ret = 1;
+	}
+	pthread_mutex_unlock(&deque->lock);
+
+	return ret;
+}
+
+void pool_work(pool_t *pool, unsigned int id)
+{
+	p_job_t job;
+
+	while (1) {
+		u8_t got = deque_pop(&pool->deques[id], &job);
+
+		/**
+		 * Look for a victim, starting with the next worker, so the thieves
+		 * don't all go after the same deque
+		 */
+		for (unsigned int i = 1; !got && i < pool->threads_no; i++) {
+			unsigned int victim = (id + i) % pool->threads_no;
+			got = deque_steal(&pool->deques[victim], &job);
+		}
+
+		if (!got)
+			return;
+
+		job.run(job.arg);
+
+		pthread_mutex_lock(&pool->lock);
+		pool->remaining--;
+		if (pool->remaining == 0)
+			pthread_cond_broadcast(&pool->done);
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+void *pool_thread(void *arg)
+{
+	p_worker_t *worker = (p_worker_t *)arg;
+	pool_t *pool = worker->pool;
+	u64_t seen = 0;
+
+	while (1) {
+		pthread_mutex_lock(&pool->lock);
+		while (!pool->stop && pool->generation == seen)
+			pthread_cond_wait(&pool->work, &pool->lock);
+
+		if (pool->stop) {
+			pthread_mutex_unlock(&pool->lock);
+			return NULL;
+		}
+
+		seen = pool->generation;
+		pthread_mutex_unlock(&pool->lock);
+
+		pool_work(pool, worker->id);
+	}
+}
+
+int pool_run(pool_t *pool, p_job_t *jobs, unsigned int jobs_no)
+{
+	if (jobs_no == 0)
+		return 0;
+
+	/**
+	 * One batch at a time. Another thread that wants the pool meanwhile
+	 * gets an error, and it is better for it to work alone than to wait.
+	 */
+	if (pthread_mutex_trylock(&pool->busy) != 0)
+		return -1;
+
+	/**
+	 * Every deque is empty between batches, so it can start again from the
+	 * beginning of its array. The arrays are grown before any job is pushed,
+	 * so the batch either runs entirely or not at all.
+	 */
+	for (unsigned int w = 0; w < pool->threads_no; w++) {
+		unsigned int from = (u64_t)jobs_no * w / pool->threads_no;
+		unsigned int to = (u64_t)jobs_no * (w + 1) / pool->threads_no;
+
+		pthread_mutex_lock(&pool->deques[w].lock);
+		pool->deques[w].head = 0;
+		pool->deques[w].tail = 0;
+		int ret = deque_reserve(&pool->deques[w], to - from);
+		pthread_mutex_unlock(&pool->deques[w].lock);
+
+		if (ret < 0) {
+			pthread_mutex_unlock(&pool->busy);
+			return -1;
+		}
+	}
+
+	/**
+	 * The counter is set before any job is visible, so a worker that is
+	 * still looking for jobs from the previous batch can take them safely
+	 */
+	pthread_mutex_lock(&pool->lock);
+	pool->remaining = jobs_no;
+	pthread_mutex_unlock(&pool->lock);
+
+	/**
+	 * Neighbour jobs are neighbour subtries, so every worker gets a
+	 * contiguous chunk
+	 */
+	for (unsigned int w = 0; w < pool->threads_no; w++) {
+		unsigned int from = (u64_t)jobs_no * w / pool->threads_no;
+		unsigned int to = (u64_t)jobs_no * (w + 1) / pool->threads_no;
+
+		/**
+		 * The owner pops from the tail, so push the chunk in reverse, to
+		 * have the first job popped first
+		 */
+		for (unsigned int i = to; i > from; i--)
+			deque_push(&pool->deques[w], jobs[i - 1]);
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->generation++;
+	pthread_cond_broadcast(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+
+	pool_work(pool, pool->threads_no - 1);
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->remaining > 0)
+		pthread_cond_wait(&pool->done, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+
+	pthread_mutex_unlock(&pool->busy);
+	return 0;
+}
+
+void free_pool(pool_t *pool)
+{
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (unsigned int i = 0; i + 1 < pool->threads_no; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	for (unsigned int i = 0; i < pool->threads_no; i++) {
+		free(pool->deques[i].jobs);
+		pthread_mutex_destroy(&pool->deques[i].lock);
+	}
+
+	pthread_mutex_destroy(&pool->busy);
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->work);
+	pthread_cond_destroy(&pool->done);
+
+	free(pool->deques);
+	free(pool->workers);
+	free(pool->threads);
+	free(pool);
+}
@@ -0,0 +1,100 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "structs.h"
+#include "utils.h"
+
+/**
+ * @brief Creates a work-stealing pool. The thread that runs a batch works
+ * too, so only threads_no - 1 threads are started.
+ *
+ * @param threads_no The number of workers, or 0 to use one per online CPU.
+ * @return pool_t* The newly created pool, with idle workers, or NULL if there
+ * is no memory left. If some threads can't be started, the pool has fewer
+ * workers.
+ */
+pool_t *create_pool(unsigned int threads_no);
+
+/**
+ * @brief Makes room for a number of jobs in a deque.
+ *
+ * @param deque The deque.
+ * @param jobs_no The number of jobs.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+int deque_reserve(w_deque_t *deque, unsigned int jobs_no);
+
+/**
+ * @brief Pushes a job at the owner's end of a deque. The room for it must be
+ * reserved first.
+ *
+ * @param deque The deque.
+ * @param job The job we want to push.
+ */
+void deque_push(w_deque_t *deque, p_job_t job);
+
+/**
+ * @brief Pops the last pushed job of a deque. It is called by the owner.
+ *
+ * @param deque The deque.
+ * @param job Where to store the job.
+ * @return u8_t Returns 1 if there was a job, or 0 if the deque is empty.
+ */
+u8_t deque_pop(w_deque_t *deque, p_job_t *job);
+
+/**
+ * @brief Steals the oldest job of a deque. It is called by the other workers,
+ * so the owner and the thief work at different ends.
+ *
+ * @param deque The deque.
+ * @param job Where to store the job.
+ * @return u8_t Returns 1 if there was a job, or 0 if the deque is empty.
+ */
+u8_t deque_steal(w_deque_t *deque, p_job_t *job);
+
+/**
+ * @brief Runs jobs until there is nothing left: first from the worker's own
+ * deque, then stolen from the others.
+ *
+ * @param pool The pool.
+ * @param id The index of the worker's deque.
+ */
+void pool_work(pool_t *pool, unsigned int id);
+
+/**
+ * @brief The loop of a worker thread: it sleeps until a new batch comes, then
+ * it works until the batch runs out of jobs.
+ *
+ * @param arg The p_worker_t of the thread.
+ * @return void* Always NULL.
+ */
+void *pool_thread(void *arg);
+
+/**
+ * @brief Runs a batch of jobs and waits for all of them. The jobs are spread
+ * in contiguous chunks over the deques, and the workers that finish early
+ * steal from the others, so the skewed jobs don't keep the rest waiting.
+ *
+ * @param pool The pool.
+ * @param jobs The jobs.
+ * @param jobs_no The number of jobs.
+ * @return int Returns 0 if all the jobs ran, or -1 if none did, because the
+ * pool is running another batch or there is no memory left. The caller
+ * should do the work by itself then.
+ */
+int pool_run(pool_t *pool, p_job_t *jobs, unsigned int jobs_no);
+
+/**
+ * @brief Stops the workers and frees the pool.
+ *
+ * @param pool The pool we want to free.
+ */
+void free_pool(pool_t *pool);
+
+#endif  // POOL_H_
@@ -1,15 +1,20 @@
 #ifndef STRUCTS_H_
 #define STRUCTS_H_
 
+#include <stdio.h>
 #include <inttypes.h>
+#include <pthread.h>
+
+#include "utils.h"
 
 // I wanted to use some types from inttypes, but the coding style checker is
 // against me
 typedef unsigned char u8_t;
 typedef signed int s32_t;
+typedef unsigned int u32_t;
 typedef unsigned long u64_t;
 
-enum state { END, NOT_END, ROOT };
+enum state { END, NOT_END, ROOT, TOMB };
 typedef enum state state_t;
 
 typedef struct g_node_t g_node_t;
@@ -20,13 +25,30 @@ struct g_node_t {
 	u8_t children_num; // number of children of the node
 };
 
+typedef struct w_index_t w_index_t;
+
 typedef struct g_tree_t g_tree_t;
 struct g_tree_t {
 	g_node_t *root;	// root of the generic tree
 	u64_t data_size; // the size of the data stored in the nodes
 	u64_t keys_no; // the number of keys stored in the tree
+	unsigned int epoch; // the current decay epoch, every epoch halves scores
+	u64_t decay_period; // insertions between 2 automatic decays, 0 = never
+	u64_t since_decay; // insertions since the last decay
+	g_node_t **tombs; // ending nodes of the keys removed since the last sweep
+	u64_t tombs_no; // the number of tombstoned keys waiting for a sweep
+	u64_t tombs_cap; // the capacity of the tombs array
+	u64_t mem_used; // the bytes of all the nodes of the trie
+	u64_t mem_limit; // the ceiling of mem_used, 0 = no limit
+	u64_t evicted; // the keys evicted to stay under the ceiling
+	char recent[EVICT_RECENT][MAX_BUFF]; // the last evicted keys, as a ring
+	u64_t rand_state; // the generator that samples the eviction victims
+	void (*evict_func)(void *arg, char *key); // told about every evicted
+											  // key, or NULL
+	void *evict_arg; // the first argument of evict_func
 	void (*free_func)(void *data);	// function that frees the data
 									// within the node
+	w_index_t *ids; // the ids of the frozen vocabulary, or NULL
 };
 
 typedef struct key_t key_t;
@@ -34,8 +56,154 @@ struct key_t {
 	char key; // the actual letter within the node
 	state_t ending; // a state variable, to check if the node is the end of
 					// a key
-	s32_t freq;	// frequency of the key
+	u64_t freq;	// frequency of the key
+	u64_t score; // decayed frequency, in SCORE_ONE units, as of epoch
+	unsigned int epoch; // the decay epoch when score was last normalised
+	unsigned int bound_epoch; // the decay epoch when bound was last set
+	u64_t bound; // an upper bound of the scores in the subtrie of the node,
+				 // as of bound_epoch
 	size_t key_len;	// the length of the key
+	size_t subkeys; // the number of live keys in the subtrie of the node
+	size_t shadowed; // in a delta, the keys of the lower tiers that the
+					 // subtrie hides, by a TOMB or by a newer END
+	u32_t id; // the id of the key in the frozen vocabulary, or W_NO_ID
+};
+
+typedef struct h_entry_t h_entry_t;
+struct h_entry_t {
+	g_node_t *node; // the ending node of a key
+	u64_t score; // the score used to rank the key
+	u64_t seq; // the order the key was offered in, it breaks the ties
+};
+
+typedef struct heap_t heap_t;
+struct heap_t {
+	h_entry_t *entries; // the entries, with the worst one on top
+	unsigned int cap; // the maximum number of entries kept
+	unsigned int size; // the current number of entries
+	u64_t seq; // the number of entries offered so far
+};
+
+typedef struct p_job_t p_job_t;
+struct p_job_t {
+	void (*run)(void *arg); // the function that does the job
+	void *arg; // the argument of the function
+};
+
+typedef struct w_deque_t w_deque_t;
+struct w_deque_t {
+	p_job_t *jobs; // the jobs of a worker
+	unsigned int head; // the first job, where the other workers steal from
+	unsigned int tail; // after the last job, where the owner pops from
+	unsigned int cap; // the capacity of the jobs array
+	pthread_mutex_t lock; // protects the deque
+};
+
+typedef struct p_worker_t p_worker_t;
+typedef struct pool_t pool_t;
+struct pool_t {
+	pthread_t *threads; // the worker threads, the caller is not one of them
+	p_worker_t *workers; // the arguments of the worker threads
+	unsigned int threads_no; // the number of workers, caller included
+	w_deque_t *deques; // one deque per worker, the last one is the caller's
+	pthread_mutex_t busy; // held by the thread that runs a batch
+	pthread_mutex_t lock; // protects the fields below
+	pthread_cond_t work; // signaled when a new batch of jobs comes
+	pthread_cond_t done; // signaled when the last job of a batch is done
+	u64_t generation; // the number of batches started so far
+	u64_t remaining; // the jobs of the current batch that aren't done yet
+	u8_t stop; // set when the pool is destroyed
+};
+
+struct p_worker_t {
+	pool_t *pool; // the pool the worker belongs to
+	unsigned int id; // the index of the worker's deque
+};
+
+typedef struct p_task_t p_task_t;
+struct p_task_t {
+	g_node_t *node; // the node where the task starts
+	char prefix[MAX_BUFF]; // the letters on the path from the root to node
+	size_t depth; // the length of the prefix
+	u8_t whole; // 1 to search the whole subtrie, 0 to check just the node
+	char *word; // AUTOCORRECT: the word we correct
+	size_t wordlen; // AUTOCORRECT: the length of the word
+	unsigned int k; // AUTOCORRECT: the maximum number of different letters
+	unsigned int epoch; // AUTOCOMPLETE: the decay epoch of the trie
+	FILE *stream; // AUTOCORRECT: the task's own buffer, written as a file
+	char *out; // AUTOCORRECT: the words found by the task, one per line
+	size_t out_len; // AUTOCORRECT: the length of out
+	unsigned int found; // AUTOCORRECT: the number of words found
+	g_node_t *shortest; // AUTOCOMPLETE: the shortest key of the task
+	g_node_t *frequent; // AUTOCOMPLETE: the most frequent key of the task
+	u64_t visited; // AUTOCOMPLETE: the nodes visited by the task
+	u64_t *floor; // AUTOCOMPLETE: the best score found by all the tasks
+};
+
+enum j_op { J_INSERT = 1, J_REMOVE, J_DECAY, J_DECAY_PERIOD };
+typedef enum j_op j_op_t;
+
+typedef struct journal_t journal_t;
+struct journal_t {
+	char *dir; // the directory with the journal and the snapshot
+	int fd; // the journal file, opened for appending
+	u64_t gen; // the generation of the journal file
+	u8_t *buff; // the records that weren't written yet
+	size_t buff_len; // the length of buff
+	unsigned int pending; // the number of records in buff
+	u64_t records; // the records written since the last checkpoint
+};
+
+typedef struct v_node_t v_node_t;
+struct v_node_t {
+	v_node_t *children[ALPH]; // the children, shared between versions
+	u64_t freq; // the frequency of the key that ends here, if there is one
+	u32_t refs; // the parents and versions that point to the node
+	u8_t ending; // 1 if a key ends in the node, 0 otherwise
+	u8_t children_num; // the number of children of the node
+};
+
+typedef struct v_version_t v_version_t;
+struct v_version_t {
+	v_node_t *root; // the root of the version, it is never NULL
+	u64_t id; // the number of the version, they are published in order
+	u64_t keys_no; // the number of keys in the version
+	u32_t pins; // the readers of the version, plus 1 while it is current
+};
+
+typedef struct v_trie_t v_trie_t;
+struct v_trie_t {
+	v_version_t *current; // the latest published version
+	pthread_mutex_t pin_lock; // protects current and the pins
+	pthread_mutex_t write_lock; // lets a single writer copy paths
+	u64_t nodes; // the nodes of all the live versions
+	u64_t versions; // the live versions
+};
+
+typedef struct srv_conn_t srv_conn_t;
+struct srv_conn_t {
+	int fd; // the socket of the client
+	char in[SRV_LINE_MAX]; // the bytes read after the last whole command
+	size_t in_len; // the number of bytes in in
+	char *out; // the replies waiting to be sent
+	size_t out_len; // the number of bytes in out
+	size_t out_sent; // the bytes of out that were already sent
+	size_t out_cap; // the capacity of out
+	u32_t events; // the epoll events the connection waits for
+	u8_t closing; // 1 if the connection is closed once out is sent
+};
+
+typedef struct lg_conn_t lg_conn_t;
+struct lg_conn_t {
+	int fd; // the socket of the connection
+	char in[SRV_LINE_MAX]; // the bytes read after the last whole reply line
+	size_t in_len; // the number of bytes in in
+	char *out; // the requests waiting to be sent
+	size_t out_len; // the number of bytes in out
+	size_t out_sent; // the bytes of out that were already sent
+	u64_t *sent_at; // the send times of the requests in flight, as a ring
+	u64_t sent; // the requests sent on the connection
+	u64_t done; // the requests answered on the connection
 };
 
 typedef struct kd_node_t kd_node_t;
@@ -54,4 +222,207 @@ struct kd_tree_t {
 	size_t nnodes;	// number of nodes = number of points
 };
 
+typedef struct kd_point_t kd_point_t;
+struct kd_point_t {
+	double coords[KD_MAX_DIM]; // the coordinates of the point
+	char key; // the key whose centre is the point
+};
+
+typedef struct sw_state_t sw_state_t;
+struct sw_state_t {
+	g_node_t *node; // the node of the last letter matched
+	unsigned int sample; // the touch sample the last letter was matched to
+	double cost; // the spatial cost of the path, lower is better
+};
+
+typedef struct c_node_t c_node_t;
+struct c_node_t {
+	u64_t freq; // the frequency of the key that ends here, if there is one
+	u64_t score; // the decayed frequency of the key, as of epoch
+	u32_t first; // the index of the first child, the children are adjacent
+	u32_t subkeys; // the number of keys in the subtrie of the node
+	u32_t epoch; // the decay epoch when score was last normalised
+	char key; // the letter of the node
+	u8_t children_no; // the number of children of the node
+	u8_t ending; // 1 if a key ends in the node, 0 otherwise
+};
+
+typedef struct c_trie_t c_trie_t;
+struct c_trie_t {
+	c_node_t *nodes; // the nodes in breadth-first order, the root first
+	u32_t nodes_no; // the number of nodes
+};
+
+typedef struct t_pos_t t_pos_t;
+struct t_pos_t {
+	s32_t base; // the node of the base, or -1 if the base has no such prefix
+	g_node_t *deltas[TIER_DELTAS]; // the nodes of the deltas, or NULL
+	unsigned int levels; // the number of deltas looked at
+};
+
+typedef struct t_dict_t t_dict_t;
+struct t_dict_t {
+	c_trie_t *base; // the frozen tier, with its nodes in a single array
+	g_tree_t *deltas[TIER_DELTAS]; // the mutable tiers, the newest last; only
+								   // the newest takes updates, the one
+								   // below it is being merged
+	unsigned int deltas_no; // the number of deltas
+	u64_t keys_no; // the number of keys of the whole dictionary
+	u64_t merge_at; // the bytes of the newest delta that start a merge
+	u64_t merges; // the number of merges installed so far
+	unsigned int epoch; // the current decay epoch
+	u64_t decay_period; // insertions between 2 automatic decays, 0 = never
+	u64_t since_decay; // insertions since the last decay
+};
+
+typedef struct o_entry_t o_entry_t;
+struct o_entry_t {
+	char *word; // the word changed by the user
+	u64_t freq; // END: the user's own frequency of the word
+	u64_t score; // END: the user's decayed frequency, as of epoch
+	unsigned int epoch; // END: the decay epoch when score was normalised
+	state_t state; // END for a word of the user, TOMB for a removed one
+};
+
+typedef struct o_overlay_t o_overlay_t;
+struct o_overlay_t {
+	u64_t user; // the id of the user
+	o_entry_t *entries; // the changes of the user, sorted by word
+	u32_t entries_no; // the number of entries
+	u32_t cap; // the capacity of the entries array
+	o_overlay_t *next; // the next overlay in the same bucket
+};
+
+typedef struct o_table_t o_table_t;
+struct o_table_t {
+	o_overlay_t **buckets; // the overlays, chained by the hash of the user
+	u64_t buckets_no; // the number of buckets, a power of 2
+	u64_t users_no; // the number of overlays
+	u64_t bytes; // the memory of all the overlays and their words
+};
+
+typedef struct o_pos_t o_pos_t;
+struct o_pos_t {
+	g_node_t *node; // the node of the base, or NULL if it has no such prefix
+	u32_t lo; // the first entry of the overlay that starts with the prefix
+	u32_t hi; // after the last entry that starts with the prefix
+	size_t depth; // the length of the prefix
+};
+
+typedef struct m_pattern_t m_pattern_t;
+struct m_pattern_t {
+	u32_t classes[MATCH_MAX_TOKENS]; // the letters every token accepts, as
+									 // a bitmask, 'a' is bit 0
+	u64_t stars; // bit i is set if token i is a '*'
+	unsigned int tokens_no; // the number of tokens, the accepting state is
+							// the one after the last token
+};
+
+typedef struct m_search_t m_search_t;
+struct m_search_t {
+	m_pattern_t *pattern; // the compiled pattern
+	char buff[MAX_BUFF]; // the letters of the path to the current node
+	u64_t limit; // the maximum number of words, 0 = no limit
+	u64_t found; // the words found so far
+	u8_t stop; // set when the search must end
+	int (*found_func)(const char *word, void *arg); // gets every word found,
+													// and stops the search
+													// by returning non-zero
+	void *found_arg; // the second argument of found_func
+};
+
+typedef struct sx_post_t sx_post_t;
+struct sx_post_t {
+	u32_t id; // the id of the word
+	u32_t offset; // where the suffix starts in the word
+};
+
+typedef struct sx_node_t sx_node_t;
+struct sx_node_t {
+	sx_node_t **children; // the children, sorted by letter
+	sx_post_t *posts; // the words that have the path of the node as suffix
+	u32_t posts_no; // the number of posts
+	u32_t posts_cap; // the capacity of the posts array
+	u8_t children_no; // the number of children
+	char key; // the letter of the node
+};
+
+typedef struct sx_index_t sx_index_t;
+struct sx_index_t {
+	sx_node_t *root; // the root of the trie of all the suffixes
+	char **words; // the words, by id, NULL for a free id
+	u32_t words_no; // the number of ids given so far
+	u32_t words_cap; // the capacity of the words array
+	u32_t *free_ids; // the ids of the removed words, to be given again
+	u32_t free_no; // the number of free ids
+	u64_t nodes; // the number of nodes
+	u64_t posts; // the number of posts, one for every suffix of every word
+	u64_t bytes; // the memory of the whole index
+};
+
+struct w_index_t {
+	u32_t words_no; // the words of the frozen vocabulary, with ids from 0
+	u32_t buckets_no; // the buckets of the first level of the hash
+	u32_t *seeds; // the seed of every bucket, that sends its words to
+				  // free slots, the slot of a word being its id
+	char *words; // the frozen words, one after another, with their '\0'
+	u32_t *offsets; // where the word of every id starts in words
+	u8_t *lens; // the length of the word of every id
+	u64_t *freqs; // the uses of every id, 0 if the word isn't in the trie
+	g_node_t **nodes; // the ending node of every id, NULL if it has none
+	u64_t bytes; // the memory of the whole index
+};
+
+typedef struct b_model_t b_model_t;
+struct b_model_t {
+	u32_t words_no; // the ids of the frozen vocabulary it was built for
+	u32_t *starts; // where the successors of every id start in lists, and
+				   // where the ones of the last id end
+	u8_t *lists; // the successors of every id, sorted, as varint gaps
+				 // between their ids, each one with its quantised count
+	u64_t pairs_no; // the number of bigrams
+	u64_t bytes; // the memory of the whole model
+};
+
+typedef struct b_candidate_t b_candidate_t;
+struct b_candidate_t {
+	u32_t id; // the id of the successor
+	u8_t count; // its quantised count
+	u64_t freq; // its uses, for the ties
+	char *word; // its word, for the ties left
+};
+
+enum q_strategy { Q_DESCENT, Q_LEVELS, Q_BOUNDED, Q_SCAN, Q_STRATEGIES };
+typedef enum q_strategy q_strategy_t;
+
+typedef struct q_plan_t q_plan_t;
+struct q_plan_t {
+	q_strategy_t strategies[3]; // the strategies that ran, in order
+	u64_t visited[3]; // the nodes that every one of them visited
+	unsigned int tasks[3]; // the tasks every one of them ran on the pool, 0
+						   // if it ran on the calling thread
+	unsigned int steps_no; // the number of strategies that ran
+};
+
+typedef struct q_bounded_t q_bounded_t;
+struct q_bounded_t {
+	g_node_t *seed; // the first guess, found by following the best bounds
+	g_node_t *best; // the most frequent key so far
+	u64_t best_score; // its score
+	u8_t passed; // 1 once the walk went past seed, in lexicographic order
+	unsigned int epoch; // the decay epoch of the trie
+	u64_t visited; // the nodes visited so far
+	u64_t *floor; // the best score found by all the tasks, or NULL
+};
+
+typedef struct i_cursor_t i_cursor_t;
+struct i_cursor_t {
+	g_node_t *path[MAX_BUFF]; // the nodes from the root to the current one
+	u8_t next[MAX_BUFF]; // for every node of path, 0 if its own key is
+						 // still to be given, or 1 + the next child to visit
+	char buff[MAX_BUFF]; // the letters of path, then the key given last
+	size_t depth; // the letters of path, so path[depth] is the current node
+	u8_t done; // 1 once there are no keys left
+};
+
 #endif	// STRUCTS_H_
@@ -0,0 +1,535 @@
+#include "suffix.h"
+
+/**
+ * @brief Creates a node without children and posts.
+ *
+ * @param index The index.
+ * @param key The letter of the node.
+ * @return sx_node_t* The node, or NULL if there is no memory left.
+ */
+static sx_node_t *new_node(sx_index_t *index, char key)
+{
+	sx_node_t *node = (sx_node_t *)malloc(sizeof(sx_node_t));
+	if (!node)
+		return NULL;
+
+	node->children = NULL;
+	node->posts = NULL;
+	node->posts_no = 0;
+	node->posts_cap = 0;
+	node->children_no = 0;
+	node->key = key;
+
+	index->nodes++;
+	index->bytes += sizeof(sx_node_t);
+	return node;
+}
+
+/**
+ * @brief Frees a node and everything under it.
+ *
+ * @param index The index.
+ * @param node The node.
+ */
+static void free_node(sx_index_t *index, sx_node_t *node)
+{
+	for (unsigned int i = 0; i < node->children_no; i++)
+		free_node(index, node->children[i]);
+
+	index->nodes--;
+	index->posts -= node->posts_no;
+	index->bytes -= sizeof(sx_node_t) + node->children_no *
+					sizeof(sx_node_t *) + node->posts_cap * sizeof(sx_post_t);
+
+	free(node->children);
+	free(node->posts);
+	free(node);
+}
+
+/**
+ * @brief Finds the child of a node with a given letter.
+ *
+ * @param node The node.
+ * @param c The letter.
+ * @return sx_node_t* The child, or NULL if there is none.
+ */
+static sx_node_t *get_child(sx_node_t *node, char c)
+{
+	for (unsigned int i = 0; i < node->children_no; i++) {
+		if (node->children[i]->key == c)
+			return node->children[i];
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Finds the child of a node with a given letter, or creates it. The
+ * children array has no spare room, because most nodes have a single child.
+ *
+ * @param index The index.
+ * @param node The node.
+ * @param c The letter.
+ * @return sx_node_t* The child, or NULL if there is no memory left.
+ */
+static sx_node_t *make_child(sx_index_t *index, sx_node_t *node, char c)
+{
+	sx_node_t *child = get_child(node, c);
+	if (child)
+		return child;
+
+	sx_node_t **children = (sx_node_t **)realloc(node->children,
+												 (node->children_no + 1) *
+												 sizeof(sx_node_t *));
+	if (!children)
+		return NULL;
+
+	node->children = children;
+	child = new_node(index, c);
+	if (!child)
+		return NULL;
+
+	/**
+	 * Keep the children sorted, so the searches go in lexicographic order
+	 */
+	unsigned int pos = node->children_no;
+	while (pos > 0 && children[pos - 1]->key > c) {
+		children[pos] = children[pos - 1];
+		pos--;
+	}
+
+	children[pos] = child;
+	node->children_no++;
+	index->bytes += sizeof(sx_node_t *);
+	return child;
+}
+
+/**
+ * @brief Removes the post of a suffix of a word, and the nodes it leaves
+ * empty.
+ *
+ * @param index The index.
+ * @param node The node where the rest of the suffix starts.
+ * @param suffix The rest of the suffix.
+ * @param id The id of the word.
+ * @param offset Where the suffix starts in the word.
+ * @return u8_t 1 if the node is left without posts and children, 0
+ * otherwise.
+ */
+static u8_t remove_suffix(sx_index_t *index, sx_node_t *node, char *suffix,
+						  u32_t id, u32_t offset)
+{
+	if (*suffix == '\0') {
+		for (u32_t i = 0; i < node->posts_no; i++) {
+			if (node->posts[i].id != id || node->posts[i].offset != offset)
+				continue;
+
+			memmove(&node->posts[i], &node->posts[i + 1],
+					(node->posts_no - i - 1) * sizeof(sx_post_t));
+			node->posts_no--;
+			index->posts--;
+			break;
+		}
+	} else {
+		sx_node_t *child = get_child(node, *suffix);
+		if (child && remove_suffix(index, child, suffix + 1, id, offset)) {
+			unsigned int i = 0;
+			while (node->children[i] != child)
+				i++;
+
+			memmove(&node->children[i], &node->children[i + 1],
+					(node->children_no - i - 1) * sizeof(sx_node_t *));
+			free_node(index, child);
+			node->children_no--;
+			index->bytes -= sizeof(sx_node_t *);
+		}
+	}
+
+	return node->posts_no == 0 && node->children_no == 0;
+}
+
+/**
+ * @brief Removes the posts of the first suffixes of a word.
+ *
+ * @param index The index.
+ * @param word The word.
+ * @param id The id of the word.
+ * @param count The number of suffixes, from the longest one.
+ */
+static void remove_posts(sx_index_t *index, char *word, u32_t id,
+						 u32_t count)
+{
+	for (u32_t offset = 0; offset < count; offset++)
+		remove_suffix(index, index->root, word + offset, id, offset);
+}
+
+/**
+ * @brief Gives an id to a word, and keeps a copy of it.
+ *
+ * @param index The index.
+ * @param word The word.
+ * @return s32_t The id, or -1 if there is no memory left.
+ */
+static s32_t new_id(sx_index_t *index, char *word)
+{
+	if (index->free_no == 0 && index->words_no == index->words_cap) {
+		u32_t cap = index->words_cap ? 2 * index->words_cap : SX_MIN_WORDS;
+		char **words = (char **)realloc(index->words, cap * sizeof(char *));
+		if (!words)
+			return -1;
+		index->words = words;
+
+		u32_t *free_ids = (u32_t *)realloc(index->free_ids, cap *
+										   sizeof(u32_t));
+		if (!free_ids)
+			return -1;
+		index->free_ids = free_ids;
+
+		index->bytes += (cap - index->words_cap) * (sizeof(char *) +
+													sizeof(u32_t));
+		index->words_cap = cap;
+	}
+
+	size_t len = strlen(word) + 1;
+	char *copy = (char *)malloc(len);
+	if (!copy)
+		return -1;
+
+	memcpy(copy, word, len);
+	index->bytes += len;
+
+	u32_t id;
+	if (index->free_no > 0) {
+		index->free_no--;
+		id = index->free_ids[index->free_no];
+	} else {
+		id = index->words_no;
+		index->words_no++;
+	}
+
+	index->words[id] = copy;
+	return id;
+}
+
+/**
+ * @brief Frees the copy of a word, and lets its id be given again.
+ *
+ * @param index The index.
+ * @param id The id of the word.
+ */
+static void free_id(sx_index_t *index, u32_t id)
+{
+	index->bytes -= strlen(index->words[id]) + 1;
+	free(index->words[id]);
+	index->words[id] = NULL;
+
+	index->free_ids[index->free_no] = id;
+	index->free_no++;
+}
+
+/**
+ * @brief Finds the id of a word in an index.
+ *
+ * @param index The index.
+ * @param word The word.
+ * @param id Where to store the id.
+ * @return u8_t 1 if the word is in the index, 0 otherwise.
+ */
+static u8_t find_id(sx_index_t *index, char *word, u32_t *id)
+{
+	sx_node_t *node = index->root;
+	for (char *c = word; node && *c != '\0'; c++)
+		node = get_child(node, *c);
+
+	if (!node)
+		return 0;
+
+	/**
+	 * The word is the only one with a post of offset 0 in its own node
+	 */
+	for (u32_t i = 0; i < node->posts_no; i++) {
+		if (node->posts[i].offset == 0) {
+			*id = node->posts[i].id;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Adds the keys of a subtrie to an index.
+ *
+ * @param index The index.
+ * @param root The root of the subtrie.
+ * @param buff The letters of the path to root.
+ * @param len The number of letters.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+static int add_subtrie(sx_index_t *index, g_node_t *root, char *buff,
+					   size_t len)
+{
+	if (((key_t *)root->data)->ending == END) {
+		buff[len] = '\0';
+		if (sx_add_word(index, buff) < 0)
+			return -1;
+	}
+
+	for (unsigned int i = 0; i < ALPH; i++) {
+		if (!has_live_keys(root->children[i]))
+			continue;
+
+		buff[len] = i + 'a';
+		if (add_subtrie(index, root->children[i], buff, len + 1) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Adds a word to the matches of a query.
+ *
+ * @param matches The address of the matches.
+ * @param len The number of matches.
+ * @param cap The capacity of the matches.
+ * @param word The word.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+static int push_match(char ***matches, u64_t *len, u64_t *cap, char *word)
+{
+	if (*len == *cap) {
+		u64_t new_cap = *cap ? 2 * *cap : 16;
+		char **bigger = (char **)realloc(*matches, new_cap * sizeof(char *));
+		if (!bigger)
+			return -1;
+
+		*matches = bigger;
+		*cap = new_cap;
+	}
+
+	(*matches)[*len] = word;
+	*len = *len + 1;
+
+	return 0;
+}
+
+/**
+ * @brief Collects the words with a post under a node, for the first
+ * occurrence of the string in them.
+ *
+ * @param index The index.
+ * @param node The node.
+ * @param str The string.
+ * @param matches The address of the matches.
+ * @param len The number of matches.
+ * @param cap The capacity of the matches.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+static int find_infix(sx_index_t *index, sx_node_t *node, char *str,
+					  char ***matches, u64_t *len, u64_t *cap)
+{
+	for (u32_t i = 0; i < node->posts_no; i++) {
+		char *word = index->words[node->posts[i].id];
+
+		/**
+		 * The other occurrences of the string in the word have posts of
+		 * their own, so only the first one counts
+		 */
+		if ((u32_t)(strstr(word, str) - word) != node->posts[i].offset)
+			continue;
+
+		if (push_match(matches, len, cap, word) < 0)
+			return -1;
+	}
+
+	for (unsigned int i = 0; i < node->children_no; i++) {
+		if (find_infix(index, node->children[i], str, matches, len, cap) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Orders 2 matches in lexicographic order.
+ *
+ * @param a The first match.
+ * @param b The second match.
+ * @return int The order of the matches.
+ */
+static int compare_matches(const void *a, const void *b)
+{
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+sx_index_t *create_suffix_index(void)
+{
+	sx_index_t *index = (sx_index_t *)malloc(sizeof(sx_index_t));
+	if (!index)
+		return NULL;
+
+	index->words = NULL;
+	index->words_no = 0;
+	index->words_cap = 0;
+	index->free_ids = NULL;
+	index->free_no = 0;
+	index->nodes = 0;
+	index->posts = 0;
+	index->bytes = sizeof(sx_index_t);
+
+	index->root = new_node(index, '\0');
+	if (!index->root) {
+		free(index);
+		return NULL;
+	}
+
+	return index;
+}
+
+void free_suffix_index(sx_index_t *index)
+{
+	if (!index)
+		return;
+
+	free_node(index, index->root);
+	for (u32_t i = 0; i < index->words_no; i++)
+		free(index->words[i]);
+
+	free(index->words);
+	free(index->free_ids);
+	free(index);
+}
+
+int sx_add_word(sx_index_t *index, char *word)
+{
+	u32_t old_id;
+	if (find_id(index, word, &old_id))
+		return 0;
+
+	s32_t id = new_id(index, word);
+	if (id < 0)
+		return -1;
+
+	u32_t len = strlen(word);
+	for (u32_t offset = 0; offset < len; offset++) {
+		sx_node_t *node = index->root;
+		for (char *c = word + offset; node && *c != '\0'; c++)
+			node = make_child(index, node, *c);
+
+		if (node && node->posts_no == node->posts_cap) {
+			u32_t cap = node->posts_cap ? 2 * node->posts_cap : 1;
+			sx_post_t *posts = (sx_post_t *)realloc(node->posts, cap *
+													sizeof(sx_post_t));
+			if (posts) {
+				index->bytes += (cap - node->posts_cap) * sizeof(sx_post_t);
+				node->posts = posts;
+				node->posts_cap = cap;
+			} else {
+				node = NULL;
+			}
+		}
+
+		/**
+		 * The suffixes added so far are taken back, and so are the empty
+		 * nodes of the one that failed
+		 */
+		if (!node) {
+			remove_posts(index, word, id, offset + 1);
+			free_id(index, id);
+			return -1;
+		}
+
+		node->posts[node->posts_no].id = id;
+		node->posts[node->posts_no].offset = offset;
+		node->posts_no++;
+		index->posts++;
+	}
+
+	return 0;
+}
+
+void sx_remove_word(sx_index_t *index, char *word)
+{
+	u32_t id;
+	if (!find_id(index, word, &id))
+		return;
+
+	remove_posts(index, word, id, strlen(word));
+	free_id(index, id);
+}
+
+int sx_rebuild(sx_index_t *index, g_tree_t *trie)
+{
+	/**
+	 * Empty the index, but keep its arrays, they will be filled again
+	 */
+	for (u32_t i = 0; i < index->root->children_no; i++)
+		free_node(index, index->root->children[i]);
+
+	index->bytes -= index->root->children_no * sizeof(sx_node_t *) +
+					index->root->posts_cap * sizeof(sx_post_t);
+	free(index->root->children);
+	free(index->root->posts);
+	index->root->children = NULL;
+	index->root->posts = NULL;
+	index->root->children_no = 0;
+	index->root->posts_no = 0;
+	index->root->posts_cap = 0;
+
+	for (u32_t i = 0; i < index->words_no; i++) {
+		if (index->words[i])
+			index->bytes -= strlen(index->words[i]) + 1;
+		free(index->words[i]);
+	}
+
+	index->words_no = 0;
+	index->free_no = 0;
+
+	char buff[MAX_BUFF];
+	return add_subtrie(index, trie->root, buff, 0);
+}
+
+int sx_find(sx_index_t *index, char *str, u8_t infix, u64_t limit,
+			int (*found_func)(const char *word, void *arg), void *found_arg,
+			u64_t *found)
+{
+	sx_node_t *node = index->root;
+	for (char *c = str; node && *c != '\0'; c++)
+		node = get_child(node, *c);
+
+	*found = 0;
+	if (!node)
+		return 0;
+
+	/**
+	 * The posts are in the order the words came in, so all of them are
+	 * gathered and sorted before the first one is given back. A word has a
+	 * single suffix of a given length, so the posts of the node are all
+	 * different words.
+	 */
+	char **matches = NULL;
+	u64_t len = 0, cap = 0;
+	int ret = 0;
+
+	if (infix) {
+		ret = find_infix(index, node, str, &matches, &len, &cap);
+	} else {
+		for (u32_t i = 0; i < node->posts_no && ret == 0; i++)
+			ret = push_match(&matches, &len, &cap,
+							 index->words[node->posts[i].id]);
+	}
+
+	if (ret == 0) {
+		qsort(matches, len, sizeof(char *), compare_matches);
+
+		for (u64_t i = 0; i < len; i++) {
+			(*found)++;
+			if (found_func(matches[i], found_arg) != 0 || *found == limit)
+				break;
+		}
+	}
+
+	free(matches);
+	return ret;
+}
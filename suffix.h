@@ -0,0 +1,87 @@
+#ifndef SUFFIX_H_
+#define SUFFIX_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "structs.h"
+#include "utils.h"
+#include "generic_tree.h"
+
+/**
+ * The suffix index is a trie of all the suffixes of all the words. The node
+ * of a suffix posts the ids of the words that end with it, with the place
+ * where it starts. A word ends with s if it has a post in the node of s, and
+ * it contains s if it has a post anywhere under that node, so both queries
+ * walk the letters of s and then read just the posts they give back. A word
+ * that contains s more than once is given back only for its first
+ * occurrence. The words are given back in lexicographic order.
+ */
+
+/**
+ * @brief Creates an empty suffix index.
+ *
+ * @return sx_index_t* The index, or NULL if there is no memory left.
+ */
+sx_index_t *create_suffix_index(void);
+
+/**
+ * @brief Frees a suffix index.
+ *
+ * @param index The index, it can be NULL.
+ */
+void free_suffix_index(sx_index_t *index);
+
+/**
+ * @brief Adds a word, with all its suffixes. A word that is in the index
+ * already is ignored.
+ *
+ * @param index The index.
+ * @param word The word.
+ * @return int Returns 0 on success, or -1 if there is no memory left. The
+ * index is left without the word in that case.
+ */
+int sx_add_word(sx_index_t *index, char *word);
+
+/**
+ * @brief Removes a word, and the nodes that are left without posts. A
+ * missing word is ignored.
+ *
+ * @param index The index.
+ * @param word The word.
+ */
+void sx_remove_word(sx_index_t *index, char *word);
+
+/**
+ * @brief Empties an index and adds all the keys of a trie to it.
+ *
+ * @param index The index.
+ * @param trie The trie.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+int sx_rebuild(sx_index_t *index, g_tree_t *trie);
+
+/**
+ * @brief Finds the words that end with a string, or that contain it, and
+ * gives them to a callback, in lexicographic order. All of them are sorted
+ * first, even when only a few are asked for.
+ *
+ * @param index The index.
+ * @param str The string.
+ * @param infix 1 for the words that contain the string, 0 for the words that
+ * end with it.
+ * @param limit The maximum number of words, 0 for all of them.
+ * @param found_func The callback, that gets every word and found_arg. It
+ * ends the search by returning non-zero.
+ * @param found_arg The second argument of the callback.
+ * @param found Where to store the number of words given to the callback.
+ * @return int Returns 0 on success, or -1 if there is no memory left to sort
+ * the words. No word is given then.
+ */
+int sx_find(sx_index_t *index, char *str, u8_t infix, u64_t limit,
+			int (*found_func)(const char *word, void *arg), void *found_arg,
+			u64_t *found);
+
+#endif  // SUFFIX_H_
@@ -0,0 +1,325 @@
+#include "swipe.h"
+
+void get_key_centre(char c, double *centre)
+{
+	const char *rows[] = { "qwertyuiop", "asdfghjkl", "zxcvbnm" };
+	const double shifts[] = { 0, 0.5, 1.5 };
+
+	for (unsigned int row = 0; row < 3; row++) {
+		const char *pos = strchr(rows[row], c);
+		if (pos) {
+			centre[0] = shifts[row] + (pos - rows[row]);
+			centre[1] = row;
+			return;
+		}
+	}
+
+	centre[0] = 0;
+	centre[1] = 0;
+}
+
+kd_tree_t *create_keyboard(void)
+{
+	kd_point_t keys[ALPH];
+	for (unsigned int i = 0; i < ALPH; i++) {
+		keys[i].key = 'a' + i;
+		get_key_centre(keys[i].key, keys[i].coords);
+	}
+
+	return create_kd_tree(keys, ALPH, 2);
+}
+
+u32_t get_candidate_keys(kd_tree_t *keyboard, const double *sample)
+{
+	kd_point_t *keys[ALPH];
+	double dists[PTS];
+	u32_t mask = 0;
+
+	unsigned int found = kd_nearest(keyboard, sample, PTS, keys, dists);
+	for (unsigned int i = 0; i < found; i++)
+		mask |= 1u << (keys[i]->key - 'a');
+
+	found = kd_radius(keyboard, sample, SWIPE_RADIUS, keys, ALPH);
+	for (unsigned int i = 0; i < found; i++)
+		mask |= 1u << (keys[i]->key - 'a');
+
+	return mask;
+}
+
+double segment_distance(const double *p, const double *a, const double *b)
+{
+	double dx = b[0] - a[0], dy = b[1] - a[1];
+	double len = dx * dx + dy * dy;
+
+	/**
+	 * Project the point on the segment, and clamp it between the ends
+	 */
+	double t = 0;
+	if (len > 0)
+		t = ((p[0] - a[0]) * dx + (p[1] - a[1]) * dy) / len;
+	if (t < 0)
+		t = 0;
+	if (t > 1)
+		t = 1;
+
+	double proj[2] = { a[0] + t * dx, a[1] + t * dy };
+	return kd_distance(p, proj, 2);
+}
+
+int push_state(sw_state_t **states, size_t *len, size_t *cap, g_node_t *node,
+			   unsigned int sample, double cost)
+{
+	if (*len == *cap) {
+		size_t new_cap = *cap ? 2 * *cap : SWIPE_BEAM;
+		sw_state_t *bigger = (sw_state_t *)realloc(*states, new_cap *
+												   sizeof(sw_state_t));
+		if (!bigger)
+			return -1;
+
+		*states = bigger;
+		*cap = new_cap;
+	}
+
+	(*states)[*len].node = node;
+	(*states)[*len].sample = sample;
+	(*states)[*len].cost = cost;
+	*len = *len + 1;
+
+	return 0;
+}
+
+int compare_paths(g_node_t *x, g_node_t *y)
+{
+	unsigned int x_depth = 0, y_depth = 0;
+	for (g_node_t *node = x; node->parent; node = node->parent)
+		x_depth++;
+	for (g_node_t *node = y; node->parent; node = node->parent)
+		y_depth++;
+
+	/**
+	 * Climb to the same depth, a prefix of a path comes before it
+	 */
+	g_node_t *xs = x, *ys = y;
+	for (unsigned int d = x_depth; d > y_depth; d--)
+		xs = xs->parent;
+	for (unsigned int d = y_depth; d > x_depth; d--)
+		ys = ys->parent;
+
+	if (xs == ys)
+		return (x_depth > y_depth) - (x_depth < y_depth);
+
+	/**
+	 * The paths split under the first common node, and their letters there
+	 * decide
+	 */
+	while (xs->parent != ys->parent) {
+		xs = xs->parent;
+		ys = ys->parent;
+	}
+
+	char x_key = ((key_t *)xs->data)->key, y_key = ((key_t *)ys->data)->key;
+	return (x_key > y_key) - (x_key < y_key);
+}
+
+int compare_states(const void *a, const void *b)
+{
+	const sw_state_t *x = (const sw_state_t *)a, *y = (const sw_state_t *)b;
+	int paths = compare_paths(x->node, y->node);
+
+	if (paths)
+		return paths;
+
+	if (x->sample != y->sample)
+		return (x->sample > y->sample) - (x->sample < y->sample);
+
+	return (x->cost > y->cost) - (x->cost < y->cost);
+}
+
+int compare_costs(const void *a, const void *b)
+{
+	const sw_state_t *x = (const sw_state_t *)a, *y = (const sw_state_t *)b;
+
+	/**
+	 * The paths with the same cost are kept in the order of their letters
+	 * and samples, so the beam cuts them the same way on every run
+	 */
+	if (x->cost != y->cost)
+		return (x->cost > y->cost) - (x->cost < y->cost);
+
+	int paths = compare_paths(x->node, y->node);
+	if (paths)
+		return paths;
+
+	return (x->sample > y->sample) - (x->sample < y->sample);
+}
+
+size_t prune_states(sw_state_t *states, size_t len, unsigned int width)
+{
+	if (len == 0)
+		return 0;
+
+	/**
+	 * The paths that reach the same letter on the same sample have the same
+	 * future, so only the cheapest one is kept
+	 */
+	qsort(states, len, sizeof(sw_state_t), compare_states);
+
+	size_t kept = 1;
+	for (size_t i = 1; i < len; i++) {
+		if (states[i].node != states[kept - 1].node ||
+			states[i].sample != states[kept - 1].sample) {
+			states[kept] = states[i];
+			kept++;
+		}
+	}
+
+	if (kept > width) {
+		qsort(states, kept, sizeof(sw_state_t), compare_costs);
+		kept = width;
+	}
+
+	return kept;
+}
+
+int expand_state(sw_state_t *state, const double *samples,
+				 unsigned int samples_no, u32_t *masks, sw_state_t **next,
+				 size_t *next_len, size_t *next_cap)
+{
+	g_node_t *node = state->node;
+	char letter = ((key_t *)node->data)->key;
+	double from[2], to[2];
+	get_key_centre(letter, from);
+
+	for (unsigned int c = 0; c < ALPH; c++) {
+		g_node_t *child = node->children[c];
+		if (!has_live_keys(child))
+			continue;
+
+		get_key_centre('a' + c, to);
+		u32_t bit = 1u << c;
+
+		/**
+		 * A double letter is typed by staying on the key, so it matches the
+		 * same sample again
+		 */
+		if (letter == (char)('a' + c) && (masks[state->sample] & bit)) {
+			double cost = kd_distance(samples + 2 * state->sample, to, 2);
+			if (push_state(next, next_len, next_cap, child, state->sample,
+						   state->cost + cost) < 0)
+				return -1;
+		}
+
+		double stray = 0;
+		for (unsigned int j = state->sample + 1; j < samples_no; j++) {
+			if (j - 1 > state->sample) {
+				double dist = segment_distance(samples + 2 * (j - 1), from,
+											   to);
+				if (dist > stray)
+					stray = dist;
+			}
+
+			if (stray > SWIPE_MAX_DEV * SWIPE_MAX_DEV)
+				break;
+
+			if (!(masks[j] & bit))
+				continue;
+
+			double cost = kd_distance(samples + 2 * j, to, 2) + stray;
+			if (push_state(next, next_len, next_cap, child, j,
+						   state->cost + cost) < 0)
+				return -1;
+		}
+	}
+
+	return 0;
+}
+
+g_node_t **decode_swipe(g_node_t *root, kd_tree_t *keyboard,
+						const double *samples, unsigned int samples_no,
+						unsigned int n, unsigned int epoch,
+						unsigned int *count)
+{
+	/**
+	 * No more words than the live keys can be found
+	 */
+	if (n > ((key_t *)root->data)->subkeys)
+		n = ((key_t *)root->data)->subkeys;
+
+	u32_t *masks = (u32_t *)malloc(samples_no * sizeof(u32_t));
+	g_node_t **best = (g_node_t **)malloc(((size_t)n + 1) *
+										  sizeof(g_node_t *));
+	heap_t *heap = create_heap(n);
+	sw_state_t *cur = NULL, *next = NULL;
+	size_t cur_len = 0, cur_cap = 0, next_len = 0, next_cap = 0;
+	u8_t failed = !masks || !best || !heap;
+
+	for (unsigned int j = 0; !failed && j < samples_no; j++)
+		masks[j] = get_candidate_keys(keyboard, samples + 2 * j);
+
+	/**
+	 * The first letter is where the swipe starts
+	 */
+	for (unsigned int c = 0; !failed && c < ALPH; c++) {
+		if (!(masks[0] & (1u << c)) || !has_live_keys(root->children[c]))
+			continue;
+
+		double centre[2];
+		get_key_centre('a' + c, centre);
+		if (push_state(&next, &next_len, &next_cap, root->children[c], 0,
+					   kd_distance(samples, centre, 2)) < 0)
+			failed = 1;
+	}
+
+	while (!failed && next_len > 0) {
+		sw_state_t *tmp = cur;
+		cur = next;
+		next = tmp;
+
+		size_t tmp_cap = cur_cap;
+		cur_cap = next_cap;
+		next_cap = tmp_cap;
+
+		cur_len = prune_states(cur, next_len, SWIPE_BEAM);
+		next_len = 0;
+
+		for (size_t i = 0; !failed && i < cur_len; i++) {
+			key_t *key = (key_t *)cur[i].node->data;
+
+			/**
+			 * The cheaper paths get the bigger scores, and the frequency
+			 * breaks the ties
+			 */
+			if (key->ending == END && cur[i].sample == samples_no - 1) {
+				u64_t cost = cur[i].cost * SCORE_ONE;
+				u64_t freq = key_score(key, epoch);
+				if (cost > 0x7fffffffUL)
+					cost = 0x7fffffffUL;
+				if (freq > 0xffffffffUL)
+					freq = 0xffffffffUL;
+
+				heap_offer(heap, cur[i].node, (0x7fffffffUL - cost) << 32 |
+							freq);
+			}
+
+			if (expand_state(&cur[i], samples, samples_no, masks, &next,
+							 &next_len, &next_cap) < 0)
+				failed = 1;
+		}
+	}
+
+	if (!failed)
+		*count = heap_drain(heap, best);
+
+	free(masks);
+	free(cur);
+	free(next);
+	if (heap)
+		free_heap(heap);
+
+	if (failed) {
+		free(best);
+		return NULL;
+	}
+
+	return best;
+}
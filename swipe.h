@@ -0,0 +1,160 @@
+#ifndef SWIPE_H_
+#define SWIPE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "structs.h"
+#include "utils.h"
+#include "generic_tree.h"
+#include "heap.h"
+#include "kd_tree.h"
+
+/**
+ * The swipes are decoded on a QWERTY layout, measured in key widths: the
+ * centre of 'q' is at (0, 0), the rows are 1 key apart, and the second and
+ * the third rows are shifted by half a key and by one and a half keys. A
+ * swipe is a list of touch samples, from the first letter of the word to
+ * its last one.
+ */
+
+/**
+ * @brief Gives the centre of a key.
+ *
+ * @param c The letter of the key.
+ * @param centre Where to store the coordinates of the centre.
+ */
+void get_key_centre(char c, double *centre);
+
+/**
+ * @brief Creates the k-d tree of the key centres.
+ *
+ * @return kd_tree_t* The tree, or NULL if there is no memory left.
+ */
+kd_tree_t *create_keyboard(void);
+
+/**
+ * @brief Finds the keys a touch sample may stand for: the PTS nearest keys,
+ * and all the keys within SWIPE_RADIUS.
+ *
+ * @param keyboard The k-d tree of the keys.
+ * @param sample The coordinates of the sample.
+ * @return u32_t The keys, as a bit mask of letters.
+ */
+u32_t get_candidate_keys(kd_tree_t *keyboard, const double *sample);
+
+/**
+ * @brief Computes the squared distance from a point to a segment.
+ *
+ * @param p The point.
+ * @param a One end of the segment.
+ * @param b The other end of the segment.
+ * @return double The squared distance.
+ */
+double segment_distance(const double *p, const double *a, const double *b);
+
+/**
+ * @brief Adds a state to the next step of the beam.
+ *
+ * @param states The address of the states.
+ * @param len The number of states.
+ * @param cap The capacity of the states.
+ * @param node The node of the last letter matched.
+ * @param sample The sample it was matched to.
+ * @param cost The cost of the path.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+int push_state(sw_state_t **states, size_t *len, size_t *cap, g_node_t *node,
+			   unsigned int sample, double cost);
+
+/**
+ * @brief Orders 2 nodes of a trie by the letters of their paths from the
+ * root, like their keys in lexicographic order.
+ *
+ * @param x The first node.
+ * @param y The second node.
+ * @return int The order of the nodes.
+ */
+int compare_paths(g_node_t *x, g_node_t *y);
+
+/**
+ * @brief Orders the states by their letters and sample, and the cheapest
+ * first among the same ones. The letters decide, never the addresses of the
+ * nodes, so the order is the same on every run.
+ *
+ * @param a The first state.
+ * @param b The second state.
+ * @return int The order of the states.
+ */
+int compare_states(const void *a, const void *b);
+
+/**
+ * @brief Orders the states by cost, the cheapest first. The ties are broken
+ * by the letters and then by the sample, so the beam is cut the same way on
+ * every run.
+ *
+ * @param a The first state.
+ * @param b The second state.
+ * @return int The order of the states.
+ */
+int compare_costs(const void *a, const void *b);
+
+/**
+ * @brief Keeps the cheapest path to each node and sample, and then only the
+ * width cheapest paths.
+ *
+ * @param states The states.
+ * @param len The number of states.
+ * @param width The width of the beam.
+ * @return size_t The number of states kept, at the front of the array.
+ */
+size_t prune_states(sw_state_t *states, size_t len, unsigned int width);
+
+/**
+ * @brief Extends a path of the beam with every next letter the trie allows,
+ * matched to a later sample that may stand for it. The samples skipped
+ * between the 2 letters must stay near the line between their keys, so a
+ * turn of the swipe can't be skipped; the search stops as soon as they
+ * stray too far.
+ *
+ * @param state The path.
+ * @param samples The coordinates of the samples.
+ * @param samples_no The number of samples.
+ * @param masks The candidate keys of every sample.
+ * @param next The address of the next step of the beam.
+ * @param next_len The number of states in the next step.
+ * @param next_cap The capacity of the next step.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+int expand_state(sw_state_t *state, const double *samples,
+				 unsigned int samples_no, u32_t *masks, sw_state_t **next,
+				 size_t *next_len, size_t *next_cap);
+
+/**
+ * @brief Decodes a swipe into the n best words. A beam search goes down the
+ * trie one letter at a time, matching every letter to a touch sample, in
+ * order. A path costs the squared distances from its samples to its keys,
+ * plus the squared strays of the skipped samples. Only the SWIPE_BEAM
+ * cheapest paths survive each letter, and only the letters of live
+ * branches are tried. A word must start on the first sample and end on the
+ * last one. The cheapest words win, and the frequent ones break the ties.
+ *
+ * @param root The root of the trie.
+ * @param keyboard The k-d tree of the keys.
+ * @param samples The coordinates of the samples, x and y for each one.
+ * @param samples_no The number of samples, at least 1.
+ * @param n The number of words wanted. More than the live keys of the trie
+ * are never kept.
+ * @param epoch The current decay epoch of the trie.
+ * @param count Where to store the number of words found, at most n.
+ * @return g_node_t** The ending nodes of the words, the best first, in an
+ * array the caller frees, or NULL if there is no memory left.
+ */
+g_node_t **decode_swipe(g_node_t *root, kd_tree_t *keyboard,
+						const double *samples, unsigned int samples_no,
+						unsigned int n, unsigned int epoch,
+						unsigned int *count);
+
+#endif  // SWIPE_H_
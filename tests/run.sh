@@ -0,0 +1,47 @@
+#!/bin/sh
+#
+# Runs the command files of the tests through mk, and compares what they
+# print with the expected output. A test NAME is either NAME.in, run on its
+# own, or NAME.1.in, NAME.2.in, ..., runs that share a journal directory, so
+# every run after the first starts from what the ones before it left. The
+# output of all the runs is compared with NAME.out.
+#
+# Usage: tests/run.sh [mk binary], from any directory. The command files
+# name their data files from the root of the repository.
+
+cd "$(dirname "$0")/.." || exit 1
+
+MK=${1:-./mk}
+failed=0
+passed=0
+
+for expected in tests/*.out; do
+	name=${expected%.out}
+	actual=$(mktemp)
+	status=0
+
+	if [ -f "$name.in" ]; then
+		"$MK" < "$name.in" > "$actual" 2> /dev/null || status=$?
+	else
+		dir=$(mktemp -d)
+		for run in "$name".[0-9]*.in; do
+			"$MK" "$dir" < "$run" >> "$actual" 2> /dev/null || status=$?
+		done
+		rm -rf "$dir"
+	fi
+
+	if [ "$status" -ne 0 ]; then
+		echo "FAIL ${name#tests/}: mk exited with $status"
+		failed=$((failed + 1))
+	elif ! diff -u "$expected" "$actual"; then
+		echo "FAIL ${name#tests/}"
+		failed=$((failed + 1))
+	else
+		passed=$((passed + 1))
+	fi
+
+	rm -f "$actual"
+done
+
+echo "$passed passed, $failed failed"
+[ "$failed" -eq 0 ]
@@ -0,0 +1,578 @@
+#include "tier.h"
+
+/**
+ * @brief Creates an empty delta.
+ *
+ * @return g_tree_t* The delta, or NULL if there is no memory left.
+ */
+static g_tree_t *new_delta(void)
+{
+	g_tree_t *delta = create_generic_tree(sizeof(key_t), free_tnode);
+	if (!delta)
+		return NULL;
+
+	if (init_trie(delta) < 0) {
+		free(delta);
+		return NULL;
+	}
+
+	return delta;
+}
+
+/**
+ * @brief Frees a delta.
+ *
+ * @param delta The delta.
+ */
+static void free_delta(g_tree_t *delta)
+{
+	free_trie(delta->root, delta->free_func);
+	free(delta->tombs);
+	free(delta);
+}
+
+/**
+ * @brief Finds the node of a key in a delta, whatever its state.
+ *
+ * @param delta The delta.
+ * @param key The key.
+ * @param create 1 to create the missing nodes of the path, 0 otherwise.
+ * @return g_node_t* The node, or NULL if it is missing, or if there is no
+ * memory left.
+ */
+static g_node_t *delta_node(g_tree_t *delta, char *key, u8_t create)
+{
+	g_node_t *node = delta->root;
+
+	for (; *key != '\0'; key++) {
+		unsigned int idx = *key - 'a';
+		if (!node->children[idx]) {
+			if (!create)
+				return NULL;
+
+			g_node_t *child = init_tnode(*key, NOT_END, 0);
+			if (!child)
+				return NULL;
+
+			child->parent = node;
+			node->children[idx] = child;
+			node->children_num++;
+			delta->mem_used += tnode_size();
+		}
+
+		node = node->children[idx];
+	}
+
+	return node;
+}
+
+/**
+ * @brief Adds to the counters of a node and of all the nodes above it. The
+ * counters are unsigned, so adding (size_t)-1 takes one away.
+ *
+ * @param node The node.
+ * @param keys What to add to subkeys.
+ * @param shadowed What to add to shadowed.
+ */
+static void count_path(g_node_t *node, size_t keys, size_t shadowed)
+{
+	for (; node; node = node->parent) {
+		((key_t *)node->data)->subkeys += keys;
+		((key_t *)node->data)->shadowed += shadowed;
+	}
+}
+
+c_trie_t *build_base(c_trie_t *base, g_tree_t **deltas, unsigned int levels)
+{
+	c_trie_t *new_base = (c_trie_t *)malloc(sizeof(c_trie_t));
+	u32_t cap = 1024;
+	c_node_t *nodes = (c_node_t *)malloc(cap * sizeof(c_node_t));
+	t_pos_t *queue = (t_pos_t *)malloc(cap * sizeof(t_pos_t));
+	if (!new_base || !nodes || !queue)
+		goto fail;
+
+	/**
+	 * The nodes are numbered in breadth-first order, so the children of a
+	 * node are adjacent, and the node array is its own queue
+	 */
+	t_root(base, deltas, levels, &queue[0]);
+	memset(&nodes[0], 0, sizeof(c_node_t));
+	nodes[0].subkeys = t_live(base, &queue[0]);
+	u32_t count = 1;
+
+	for (u32_t i = 0; i < count; i++) {
+		nodes[i].first = count;
+		nodes[i].children_no = 0;
+
+		for (unsigned int j = 0; j < ALPH; j++) {
+			t_pos_t child;
+			if (!t_child(base, &queue[i], j + 'a', &child))
+				continue;
+
+			u64_t live = t_live(base, &child);
+			if (live == 0)
+				continue;
+
+			if (count == cap) {
+				cap *= 2;
+				c_node_t *more_nodes = (c_node_t *)realloc(nodes, cap *
+														   sizeof(c_node_t));
+				if (more_nodes)
+					nodes = more_nodes;
+
+				t_pos_t *more_queue = (t_pos_t *)realloc(queue, cap *
+														 sizeof(t_pos_t));
+				if (more_queue)
+					queue = more_queue;
+
+				if (!more_nodes || !more_queue)
+					goto fail;
+			}
+
+			key_t rec;
+			c_node_t *node = &nodes[count];
+			memset(node, 0, sizeof(c_node_t));
+			node->key = j + 'a';
+			node->subkeys = live;
+			node->ending = t_get_key(base, &child, &rec);
+			if (node->ending) {
+				node->freq = rec.freq;
+				node->score = rec.score;
+				node->epoch = rec.epoch;
+			}
+
+			queue[count] = child;
+			count++;
+			nodes[i].children_no++;
+		}
+	}
+
+	free(queue);
+
+	/**
+	 * The base never grows, so it gives back the spare room
+	 */
+	c_node_t *exact = (c_node_t *)realloc(nodes, count * sizeof(c_node_t));
+	new_base->nodes = exact ? exact : nodes;
+	new_base->nodes_no = count;
+	return new_base;
+
+fail:
+	free(new_base);
+	free(nodes);
+	free(queue);
+	return NULL;
+}
+
+void free_base(c_trie_t *base)
+{
+	if (!base)
+		return;
+
+	free(base->nodes);
+	free(base);
+}
+
+t_dict_t *create_tiers(g_tree_t *trie, u64_t merge_at)
+{
+	t_dict_t *dict = (t_dict_t *)malloc(sizeof(t_dict_t));
+	if (!dict)
+		return NULL;
+
+	/**
+	 * The trie is read as a delta with nothing below it
+	 */
+	dict->base = build_base(NULL, &trie, 1);
+	dict->deltas[0] = new_delta();
+	if (!dict->base || !dict->deltas[0]) {
+		free_base(dict->base);
+		if (dict->deltas[0])
+			free_delta(dict->deltas[0]);
+		free(dict);
+		return NULL;
+	}
+
+	dict->deltas_no = 1;
+	dict->keys_no = dict->base->nodes[0].subkeys;
+	dict->merge_at = merge_at;
+	dict->merges = 0;
+	dict->epoch = trie->epoch;
+	dict->decay_period = trie->decay_period;
+	dict->since_decay = trie->since_decay;
+
+	return dict;
+}
+
+void free_tiers(t_dict_t *dict)
+{
+	free_base(dict->base);
+	for (unsigned int i = 0; i < dict->deltas_no; i++)
+		free_delta(dict->deltas[i]);
+
+	free(dict);
+}
+
+u8_t tiers_need_merge(t_dict_t *dict)
+{
+	/**
+	 * 2 deltas and no merge means that the last merge failed, so the frozen
+	 * delta is still waiting
+	 */
+	if (dict->deltas_no == TIER_DELTAS)
+		return 1;
+
+	return dict->deltas[dict->deltas_no - 1]->mem_used >= dict->merge_at;
+}
+
+int push_delta(t_dict_t *dict)
+{
+	g_tree_t *delta = new_delta();
+	if (!delta)
+		return -1;
+
+	dict->deltas[dict->deltas_no] = delta;
+	dict->deltas_no++;
+	return 0;
+}
+
+void install_base(t_dict_t *dict, c_trie_t *base)
+{
+	free_base(dict->base);
+	free_delta(dict->deltas[0]);
+
+	/**
+	 * The newer delta was written over the base and the frozen delta, which
+	 * is just what the new base holds, so its TOMBs and copies stay right
+	 */
+	for (unsigned int i = 1; i < dict->deltas_no; i++)
+		dict->deltas[i - 1] = dict->deltas[i];
+
+	dict->deltas_no--;
+	dict->base = base;
+	dict->merges++;
+}
+
+void t_root(c_trie_t *base, g_tree_t **deltas, unsigned int levels,
+			t_pos_t *pos)
+{
+	pos->base = base ? 0 : -1;
+	pos->levels = levels;
+
+	for (unsigned int i = 0; i < levels; i++)
+		pos->deltas[i] = deltas[i]->root;
+}
+
+u8_t t_child(c_trie_t *base, t_pos_t *pos, char c, t_pos_t *child)
+{
+	child->base = -1;
+	child->levels = pos->levels;
+
+	/**
+	 * The children of a base node are sorted, and there are just a few of
+	 * them, next to each other
+	 */
+	if (pos->base >= 0) {
+		c_node_t *node = &base->nodes[pos->base];
+		for (u32_t i = node->first; i < node->first + node->children_no;
+			 i++) {
+			if (base->nodes[i].key == c) {
+				child->base = i;
+				break;
+			}
+		}
+	}
+
+	u8_t found = child->base >= 0;
+	for (unsigned int i = 0; i < pos->levels; i++) {
+		child->deltas[i] = NULL;
+		if (pos->deltas[i])
+			child->deltas[i] = pos->deltas[i]->children[c - 'a'];
+
+		if (child->deltas[i])
+			found = 1;
+	}
+
+	return found;
+}
+
+u64_t t_live(c_trie_t *base, t_pos_t *pos)
+{
+	/**
+	 * Every delta adds its own keys, and takes away the keys of the tiers
+	 * below that it hides. The sum can't be negative, so the unsigned
+	 * arithmetic gives the right result.
+	 */
+	u64_t live = pos->base >= 0 ? base->nodes[pos->base].subkeys : 0;
+
+	for (unsigned int i = 0; i < pos->levels; i++) {
+		if (!pos->deltas[i])
+			continue;
+
+		live += ((key_t *)pos->deltas[i]->data)->subkeys;
+		live -= ((key_t *)pos->deltas[i]->data)->shadowed;
+	}
+
+	return live;
+}
+
+u8_t t_get_key(c_trie_t *base, t_pos_t *pos, key_t *rec)
+{
+	for (unsigned int i = pos->levels; i > 0; i--) {
+		if (!pos->deltas[i - 1])
+			continue;
+
+		key_t *data = (key_t *)pos->deltas[i - 1]->data;
+		if (data->ending == TOMB)
+			return 0;
+
+		if (data->ending == END) {
+			*rec = *data;
+			return 1;
+		}
+	}
+
+	if (pos->base < 0 || !base->nodes[pos->base].ending)
+		return 0;
+
+	c_node_t *node = &base->nodes[pos->base];
+	rec->freq = node->freq;
+	rec->score = node->score;
+	rec->epoch = node->epoch;
+	return 1;
+}
+
+u8_t t_find(c_trie_t *base, g_tree_t **deltas, unsigned int levels,
+			char *key, key_t *rec)
+{
+	t_pos_t pos;
+	t_root(base, deltas, levels, &pos);
+
+	for (; *key != '\0'; key++) {
+		t_pos_t child;
+		if (!t_child(base, &pos, *key, &child))
+			return 0;
+
+		pos = child;
+	}
+
+	return t_get_key(base, &pos, rec);
+}
+
+int tier_insert(t_dict_t *dict, char *key)
+{
+	unsigned int below = dict->deltas_no - 1;
+	g_node_t *node = delta_node(dict->deltas[below], key, 1);
+	if (!node)
+		return -1;
+
+	key_t *data = (key_t *)node->data;
+	if (data->ending != END) {
+		/**
+		 * A live key of a lower tier is copied, to keep its past uses. A
+		 * TOMB already hides the lower key, and the key starts again from
+		 * zero, like a removed key does in a single trie.
+		 */
+		key_t rec;
+		if (data->ending == NOT_END &&
+			t_find(dict->base, dict->deltas, below, key, &rec)) {
+			data->freq = rec.freq;
+			data->score = rec.score;
+			data->epoch = rec.epoch;
+			count_path(node, 1, 1);
+		} else {
+			data->freq = 0;
+			data->score = 0;
+			count_path(node, 1, 0);
+			dict->keys_no++;
+		}
+
+		data->ending = END;
+		data->key_len = strlen(key);
+	}
+
+	bump_key(data, dict->epoch);
+
+	if (dict->decay_period) {
+		dict->since_decay++;
+		if (dict->since_decay >= dict->decay_period)
+			tier_decay(dict);
+	}
+
+	return 0;
+}
+
+int tier_remove(t_dict_t *dict, char *key)
+{
+	unsigned int below = dict->deltas_no - 1;
+	g_node_t *node = delta_node(dict->deltas[below], key, 0);
+	if (node && ((key_t *)node->data)->ending == TOMB)
+		return 0;
+
+	key_t rec;
+	u8_t hidden = t_find(dict->base, dict->deltas, below, key, &rec);
+
+	/**
+	 * A key of the delta becomes a TOMB if it also hides a lower key, or
+	 * just stops being a key otherwise
+	 */
+	if (node && ((key_t *)node->data)->ending == END) {
+		((key_t *)node->data)->ending = hidden ? TOMB : NOT_END;
+		count_path(node, (size_t)-1, 0);
+		dict->keys_no--;
+		return 0;
+	}
+
+	if (!hidden)
+		return 0;
+
+	node = delta_node(dict->deltas[below], key, 1);
+	if (!node)
+		return -1;
+
+	((key_t *)node->data)->ending = TOMB;
+	count_path(node, 0, 1);
+	dict->keys_no--;
+	return 0;
+}
+
+int tier_apply_file(t_dict_t *dict, char *filename, u8_t remove)
+{
+	char buff[MAX_BUFF];
+	FILE *file = fopen(filename, "rt");
+	if (!file)
+		return -1;
+
+	int ret = 0, read;
+	while (ret == 0 && (read = read_word(file, buff)) != EOF) {
+		if (!read)
+			continue;
+
+		if (remove)
+			ret = tier_remove(dict, buff);
+		else
+			ret = tier_insert(dict, buff);
+	}
+
+	fclose(file);
+	return ret;
+}
+
+void tier_decay(t_dict_t *dict)
+{
+	dict->epoch++;
+	dict->since_decay = 0;
+}
+
+u8_t tier_end_of_prefix(t_dict_t *dict, char *prefix, t_pos_t *pos)
+{
+	t_root(dict->base, dict->deltas, dict->deltas_no, pos);
+
+	for (; *prefix != '\0'; prefix++) {
+		t_pos_t child;
+		if (!t_child(dict->base, pos, *prefix, &child) ||
+			t_live(dict->base, &child) == 0)
+			return 0;
+
+		*pos = child;
+	}
+
+	return 1;
+}
+
+void t_search_kdiff(c_trie_t *base, t_pos_t *pos, char *buff, size_t bufflen,
+					char *word, size_t wordlen, unsigned int k,
+					unsigned int *found, FILE *out)
+{
+	u8_t difference = k_different_word(buff, bufflen, word, wordlen, k);
+	if (difference == 0)
+		return;
+
+	if (bufflen > wordlen)
+		return;
+
+	key_t rec;
+	if (t_get_key(base, pos, &rec)) {
+		buff[bufflen] = '\0';
+
+		if (difference == 1 && bufflen == wordlen) {
+			fprintf(out, "%s\n", buff);
+			*found = *found + 1;
+			return;
+		}
+	}
+
+	for (unsigned int i = 0; i < ALPH; i++) {
+		t_pos_t child;
+		if (t_child(base, pos, i + 'a', &child) && t_live(base, &child)) {
+			buff[bufflen] = i + 'a';
+			t_search_kdiff(base, &child, buff, bufflen + 1, word, wordlen, k,
+						   found, out);
+		}
+	}
+}
+
+void t_first_word(c_trie_t *base, t_pos_t *pos, char *buff, size_t bufflen)
+{
+	key_t rec;
+	buff[bufflen] = '\0';
+	if (t_get_key(base, pos, &rec))
+		return;
+
+	for (unsigned int i = 0; i < ALPH; i++) {
+		t_pos_t child;
+		if (t_child(base, pos, i + 'a', &child) && t_live(base, &child)) {
+			buff[bufflen] = i + 'a';
+			t_first_word(base, &child, buff, bufflen + 1);
+			return;
+		}
+	}
+}
+
+void t_best_words(c_trie_t *base, t_pos_t *pos, char *buff, size_t bufflen,
+				  unsigned int epoch, char *shortest, size_t *shortest_len,
+				  char *frequent, u64_t *max_score)
+{
+	key_t rec;
+	if (t_get_key(base, pos, &rec)) {
+		buff[bufflen] = '\0';
+		u64_t score = key_score(&rec, epoch);
+
+		/**
+		 * The first word is taken as it is, then only a strictly better word
+		 * replaces the best one, so the first one in lexicographic order
+		 * wins the ties
+		 */
+		if (frequent[0] == '\0' || score > *max_score) {
+			*max_score = score;
+			strcpy(frequent, buff);
+		}
+
+		if (bufflen < *shortest_len) {
+			*shortest_len = bufflen;
+			strcpy(shortest, buff);
+		}
+	}
+
+	for (unsigned int i = 0; i < ALPH; i++) {
+		t_pos_t child;
+		if (t_child(base, pos, i + 'a', &child) && t_live(base, &child)) {
+			buff[bufflen] = i + 'a';
+			t_best_words(base, &child, buff, bufflen + 1, epoch, shortest,
+						 shortest_len, frequent, max_score);
+		}
+	}
+}
+
+u64_t tiers_size(t_dict_t *dict, u64_t *base_nodes, u64_t *delta_nodes)
+{
+	*base_nodes = dict->base->nodes_no;
+	*delta_nodes = 0;
+
+	u64_t bytes = dict->base->nodes_no * sizeof(c_node_t);
+	for (unsigned int i = 0; i < dict->deltas_no; i++) {
+		*delta_nodes += dict->deltas[i]->mem_used / tnode_size();
+		bytes += dict->deltas[i]->mem_used;
+	}
+
+	return bytes;
+}
@@ -0,0 +1,249 @@
+#ifndef TIER_H_
+#define TIER_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "structs.h"
+#include "utils.h"
+#include "generic_tree.h"
+#include "magic_keyboard.h"
+
+/**
+ * A tiered dictionary keeps most of its keys in a frozen base, whose nodes
+ * sit in a single array, in breadth-first order, and the recent updates in
+ * small tries on top of it, the deltas. An update touches only the newest
+ * delta: a new key is an END node, a removed key of a lower tier is a TOMB
+ * node that hides it, and a key of a lower tier that is used again is copied
+ * into the delta, where it counts its new uses. A search walks all the tiers
+ * at the same time, and the newest one that knows a key decides about it.
+ *
+ * When the newest delta grows past a threshold, a new delta is started on
+ * top of it, and the base and the old delta, which don't change anymore, are
+ * merged into a new base, in the background.
+ */
+
+/**
+ * @brief Builds a base from a base and the deltas above it.
+ *
+ * @param base The old base, or NULL.
+ * @param deltas The deltas, the oldest first.
+ * @param levels The number of deltas.
+ * @return c_trie_t* The new base, or NULL if there is no memory left.
+ */
+c_trie_t *build_base(c_trie_t *base, g_tree_t **deltas, unsigned int levels);
+
+/**
+ * @brief Frees a base.
+ *
+ * @param base The base, it can be NULL.
+ */
+void free_base(c_trie_t *base);
+
+/**
+ * @brief Freezes a trie into the base of a new tiered dictionary, with an
+ * empty delta on top of it. The trie isn't changed.
+ *
+ * @param trie The trie.
+ * @param merge_at The bytes of the newest delta that start a merge.
+ * @return t_dict_t* The dictionary, or NULL if there is no memory left.
+ */
+t_dict_t *create_tiers(g_tree_t *trie, u64_t merge_at);
+
+/**
+ * @brief Frees a tiered dictionary, with all its tiers.
+ *
+ * @param dict The dictionary.
+ */
+void free_tiers(t_dict_t *dict);
+
+/**
+ * @brief Checks if the newest delta should be merged into the base.
+ *
+ * @param dict The dictionary.
+ * @return u8_t 1 if it should, 0 otherwise.
+ */
+u8_t tiers_need_merge(t_dict_t *dict);
+
+/**
+ * @brief Freezes the newest delta, and starts an empty one on top of it, that
+ * takes the updates while the frozen one is merged.
+ *
+ * @param dict The dictionary, with a single delta.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+int push_delta(t_dict_t *dict);
+
+/**
+ * @brief Replaces the base and the frozen delta with the base built from
+ * them, and frees them.
+ *
+ * @param dict The dictionary, with 2 deltas.
+ * @param base The base built from the old base and the first delta.
+ */
+void install_base(t_dict_t *dict, c_trie_t *base);
+
+/**
+ * @brief Gets the position of the root, in a base and some deltas.
+ *
+ * @param base The base, or NULL.
+ * @param deltas The deltas, the oldest first.
+ * @param levels The number of deltas.
+ * @param pos Where to store the position.
+ */
+void t_root(c_trie_t *base, g_tree_t **deltas, unsigned int levels,
+			t_pos_t *pos);
+
+/**
+ * @brief Moves from a position to one of its children.
+ *
+ * @param base The base of the position.
+ * @param pos The position.
+ * @param c The letter of the child.
+ * @param child Where to store the position of the child.
+ * @return u8_t 1 if some tier has the child, 0 otherwise.
+ */
+u8_t t_child(c_trie_t *base, t_pos_t *pos, char c, t_pos_t *child);
+
+/**
+ * @brief Counts the live keys under a position, in all the tiers together.
+ *
+ * @param base The base of the position.
+ * @param pos The position.
+ * @return u64_t The number of keys.
+ */
+u64_t t_live(c_trie_t *base, t_pos_t *pos);
+
+/**
+ * @brief Gets the key that ends at a position, from the newest tier that
+ * knows about it.
+ *
+ * @param base The base of the position.
+ * @param pos The position.
+ * @param rec Where to store the frequency and the score of the key.
+ * @return u8_t 1 if a live key ends at the position, 0 otherwise.
+ */
+u8_t t_get_key(c_trie_t *base, t_pos_t *pos, key_t *rec);
+
+/**
+ * @brief Looks a key up in a base and some deltas.
+ *
+ * @param base The base, or NULL.
+ * @param deltas The deltas, the oldest first.
+ * @param levels The number of deltas.
+ * @param key The key.
+ * @param rec Where to store the frequency and the score of the key.
+ * @return u8_t 1 if the key is live, 0 otherwise.
+ */
+u8_t t_find(c_trie_t *base, g_tree_t **deltas, unsigned int levels,
+			char *key, key_t *rec);
+
+/**
+ * @brief Inserts a key, or counts one more use of it, in the newest delta.
+ *
+ * @param dict The dictionary.
+ * @param key The key.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+int tier_insert(t_dict_t *dict, char *key);
+
+/**
+ * @brief Removes a key. A key of a lower tier gets a TOMB in the newest
+ * delta.
+ *
+ * @param dict The dictionary.
+ * @param key The key.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+int tier_remove(t_dict_t *dict, char *key);
+
+/**
+ * @brief Inserts or removes all the words of a text file. What isn't a word
+ * is skipped.
+ *
+ * @param dict The dictionary.
+ * @param filename The name of the file.
+ * @param remove 1 to remove the words, 0 to insert them.
+ * @return int Returns 0 on success, or -1 if the file can't be opened or
+ * there is no memory left.
+ */
+int tier_apply_file(t_dict_t *dict, char *filename, u8_t remove);
+
+/**
+ * @brief Halves the weight of all the past uses of the keys, in O(1).
+ *
+ * @param dict The dictionary.
+ */
+void tier_decay(t_dict_t *dict);
+
+/**
+ * @brief Gets the position of the end of a prefix.
+ *
+ * @param dict The dictionary.
+ * @param prefix The prefix.
+ * @param pos Where to store the position.
+ * @return u8_t 1 if some live key starts with the prefix, 0 otherwise.
+ */
+u8_t tier_end_of_prefix(t_dict_t *dict, char *prefix, t_pos_t *pos);
+
+/**
+ * @brief Searches for k-different words in all the tiers, like
+ * search_kdiff_words.
+ *
+ * @param base The base of the position.
+ * @param pos The position where the search starts.
+ * @param buff A buffer, with the letters of the path to the position.
+ * @param bufflen The number of letters in the buffer.
+ * @param word The word we correct.
+ * @param wordlen The length of the word.
+ * @param k The maximum number of different letters.
+ * @param found The number of words found.
+ * @param out The file where the words are printed.
+ */
+void t_search_kdiff(c_trie_t *base, t_pos_t *pos, char *buff, size_t bufflen,
+					char *word, size_t wordlen, unsigned int k,
+					unsigned int *found, FILE *out);
+
+/**
+ * @brief Gets the first word under a position, in lexicographic order.
+ *
+ * @param base The base of the position.
+ * @param pos The position, it must have live keys.
+ * @param buff A buffer, with the letters of the path to the position, where
+ * the word is completed.
+ * @param bufflen The number of letters in the buffer.
+ */
+void t_first_word(c_trie_t *base, t_pos_t *pos, char *buff, size_t bufflen);
+
+/**
+ * @brief Finds the shortest and the most frequent words under a position,
+ * with the same ties as parallel_searching: the first one in lexicographic
+ * order wins, even when all the scores decayed to 0. Only the words compete, never the prefix itself.
+ *
+ * @param base The base of the position.
+ * @param pos The position.
+ * @param buff A buffer, with the letters of the path to the position.
+ * @param bufflen The number of letters in the buffer.
+ * @param epoch The decay epoch.
+ * @param shortest The shortest word.
+ * @param shortest_len The length of the shortest word, INF at first.
+ * @param frequent The most frequent word, empty at first.
+ * @param max_score The score of the most frequent word.
+ */
+void t_best_words(c_trie_t *base, t_pos_t *pos, char *buff, size_t bufflen,
+				  unsigned int epoch, char *shortest, size_t *shortest_len,
+				  char *frequent, u64_t *max_score);
+
+/**
+ * @brief Gives the number of nodes and the memory of all the tiers.
+ *
+ * @param dict The dictionary.
+ * @param base_nodes Where to store the nodes of the base.
+ * @param delta_nodes Where to store the nodes of the deltas.
+ * @return u64_t The bytes of all the nodes.
+ */
+u64_t tiers_size(t_dict_t *dict, u64_t *base_nodes, u64_t *delta_nodes);
+
+#endif  // TIER_H_
@@ -19,5 +19,52 @@
 #define MAX_IN 20
 #define MAX_STR 100
 #define PTS 5
+#define SWEEP_THRESHOLD 1024
+#define SCORE_ONE 256
+#define PAR_MIN_KEYS 4096
+#define PAR_TASKS_PER_THREAD 8
+#define PAR_SPLIT_DEPTH 3
+#define J_GROUP 64
+#define J_RECORD_MAX (2 + MAX_BUFF + 4)
+#define J_CHECKPOINT_EVERY 65536
+#define J_JOURNAL_MAGIC "MKJOURN1"
+#define J_SNAPSHOT_MAGIC "MKSNAPS1"
+#define J_MAGIC_LEN 8
+#define FNV_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+#define EXIT_ID 6
+#define SRV_BACKLOG 1024
+#define SRV_EVENTS 256
+#define SRV_READ 4096
+#define SRV_LINE_MAX 512
+#define SRV_OUT_HIGH 65536
+#define LG_REQ_MAX 64
+#define KD_MAX_DIM 2
+#define SWIPE_RADIUS 1.0
+#define SWIPE_MAX_DEV 1.0
+#define SWIPE_BEAM 64
+#define SWIPE_MAX_PTS 256
+#define EVICT_SAMPLES 16
+#define EVICT_RECENT 8
+#define EVICT_SEED 0x9e3779b97f4a7c15UL
+#define LOOKUP_GROUP 32
+#define LOOKUP_GROUP_MAX 64
+#define TIER_DELTAS 2
+#define TIER_MERGE_BYTES (1UL << 20)
+#define OVERLAY_BUCKETS 1024
+#define OVERLAY_MIN_CAP 4
+#define MATCH_MAX_TOKENS 63
+#define MATCH_ALL_LETTERS ((1u << ALPH) - 1)
+#define SX_MIN_WORDS 64
+#define W_NO_ID 0xffffffffu
+#define W_BUCKET_KEYS 4
+#define W_SEED_TRIES 64
+#define W_HASH_BASIS 14695981039346656037UL
+#define W_HASH_PRIME 1099511628211UL
+#define W_SEED_STEP 0x9e3779b97f4a7c15UL
+#define CURSOR_BATCH 1024
+#define LOAD_CHUNK 4096
+#define PLAN_SCAN_KEYS 32
+#define PLAN_MIN_CAP 64
 
 #endif  // UTILS_H_
@@ -0,0 +1,352 @@
+#include "vtrie.h"
+
+v_trie_t *create_vtrie(void)
+{
+	v_trie_t *vtrie = calloc(1, sizeof(v_trie_t));
+	if (!vtrie)
+		return NULL;
+
+	pthread_mutex_init(&vtrie->pin_lock, NULL);
+	pthread_mutex_init(&vtrie->write_lock, NULL);
+
+	v_node_t *root = v_new_node(vtrie, NULL);
+	if (!root || v_publish(vtrie, root, 0) < 0) {
+		free_vtrie(vtrie);
+		return NULL;
+	}
+
+	return vtrie;
+}
+
+v_node_t *v_new_node(v_trie_t *vtrie, v_node_t *src)
+{
+	v_node_t *node = malloc(sizeof(v_node_t));
+	if (!node)
+		return NULL;
+
+	/**
+	 * The references of src may be dropped by a reader at the same time, so
+	 * they are not copied with the rest
+	 */
+	if (src) {
+		memcpy(node->children, src->children, sizeof(node->children));
+		node->freq = src->freq;
+		node->ending = src->ending;
+		node->children_num = src->children_num;
+
+		/**
+		 * The copy is one more parent for each of the shared children
+		 */
+		for (unsigned int i = 0; i < ALPH; i++) {
+			if (node->children[i])
+				__atomic_add_fetch(&node->children[i]->refs, 1,
+								   __ATOMIC_RELAXED);
+		}
+	} else {
+		memset(node, 0, sizeof(v_node_t));
+	}
+
+	node->refs = 1;
+	__atomic_add_fetch(&vtrie->nodes, 1, __ATOMIC_RELAXED);
+
+	return node;
+}
+
+void v_release(v_trie_t *vtrie, v_node_t *node)
+{
+	if (!node)
+		return;
+
+	/**
+	 * The versions may be released by readers while the writer copies the
+	 * paths, so the last one to leave is the one that frees the node
+	 */
+	if (__atomic_sub_fetch(&node->refs, 1, __ATOMIC_ACQ_REL) > 0)
+		return;
+
+	for (unsigned int i = 0; i < ALPH; i++)
+		v_release(vtrie, node->children[i]);
+
+	free(node);
+	__atomic_sub_fetch(&vtrie->nodes, 1, __ATOMIC_RELAXED);
+}
+
+v_node_t *v_find(v_node_t *root, const char *key)
+{
+	v_node_t *node = root;
+	for (; node && *key; key++)
+		node = node->children[*key - 'a'];
+
+	if (!node || !node->ending)
+		return NULL;
+
+	return node;
+}
+
+v_node_t *v_insert(v_trie_t *vtrie, v_node_t *node, const char *key,
+				   u64_t freq, u8_t *added)
+{
+	v_node_t *copy = v_new_node(vtrie, node);
+	if (!copy)
+		return NULL;
+
+	if (*key == '\0') {
+		if (!copy->ending)
+			*added = 1;
+
+		copy->ending = 1;
+		copy->freq = freq;
+		return copy;
+	}
+
+	unsigned int idx = *key - 'a';
+	v_node_t *child = v_insert(vtrie, copy->children[idx], key + 1, freq,
+							   added);
+	if (!child) {
+		v_release(vtrie, copy);
+		return NULL;
+	}
+
+	/**
+	 * The copy of the child replaces the shared one on the new path
+	 */
+	if (copy->children[idx])
+		v_release(vtrie, copy->children[idx]);
+	else
+		copy->children_num++;
+
+	copy->children[idx] = child;
+	return copy;
+}
+
+int v_remove(v_trie_t *vtrie, v_node_t *node, const char *key,
+			 v_node_t **ret)
+{
+	/**
+	 * A leaf that holds only the key isn't copied at all
+	 */
+	if (*key == '\0' && node->children_num == 0) {
+		*ret = NULL;
+		return 0;
+	}
+
+	v_node_t *copy = v_new_node(vtrie, node);
+	if (!copy)
+		return -1;
+
+	if (*key == '\0') {
+		copy->ending = 0;
+		copy->freq = 0;
+		*ret = copy;
+		return 0;
+	}
+
+	unsigned int idx = *key - 'a';
+	v_node_t *child;
+	if (v_remove(vtrie, copy->children[idx], key + 1, &child) < 0) {
+		v_release(vtrie, copy);
+		return -1;
+	}
+
+	v_release(vtrie, copy->children[idx]);
+	copy->children[idx] = child;
+
+	if (!child)
+		copy->children_num--;
+
+	/**
+	 * Drop the copies that were kept only for the removed key
+	 */
+	if (!copy->ending && copy->children_num == 0) {
+		v_release(vtrie, copy);
+		copy = NULL;
+	}
+
+	*ret = copy;
+	return 0;
+}
+
+int v_publish(v_trie_t *vtrie, v_node_t *root, u64_t keys_no)
+{
+	v_version_t *version = malloc(sizeof(v_version_t));
+	if (!version) {
+		v_release(vtrie, root);
+		return -1;
+	}
+
+	version->root = root;
+	version->keys_no = keys_no;
+	version->pins = 1;
+	__atomic_add_fetch(&vtrie->versions, 1, __ATOMIC_RELAXED);
+
+	pthread_mutex_lock(&vtrie->pin_lock);
+	v_version_t *old = vtrie->current;
+	version->id = old ? old->id + 1 : 0;
+	vtrie->current = version;
+	pthread_mutex_unlock(&vtrie->pin_lock);
+
+	/**
+	 * The old version isn't current anymore, but its readers may still hold
+	 * it
+	 */
+	if (old)
+		vtrie_unpin(vtrie, old);
+
+	return 0;
+}
+
+int vtrie_insert(v_trie_t *vtrie, const char *key, u64_t freq)
+{
+	pthread_mutex_lock(&vtrie->write_lock);
+
+	/**
+	 * Only the writer publishes versions, so the current one can be read
+	 * without pinning it
+	 */
+	v_version_t *version = vtrie->current;
+	u8_t added = 0;
+	v_node_t *root = v_insert(vtrie, version->root, key, freq, &added);
+
+	int ret = -1;
+	if (root)
+		ret = v_publish(vtrie, root, version->keys_no + added);
+
+	pthread_mutex_unlock(&vtrie->write_lock);
+	return ret;
+}
+
+int vtrie_remove(v_trie_t *vtrie, const char *key)
+{
+	pthread_mutex_lock(&vtrie->write_lock);
+
+	v_version_t *version = vtrie->current;
+	if (!v_find(version->root, key)) {
+		pthread_mutex_unlock(&vtrie->write_lock);
+		return 0;
+	}
+
+	v_node_t *root;
+	int ret = v_remove(vtrie, version->root, key, &root);
+
+	/**
+	 * The root stays, even when the last key is gone
+	 */
+	if (ret == 0 && !root) {
+		root = v_new_node(vtrie, NULL);
+		if (!root)
+			ret = -1;
+	}
+
+	if (ret == 0)
+		ret = v_publish(vtrie, root, version->keys_no - 1);
+
+	pthread_mutex_unlock(&vtrie->write_lock);
+	return ret;
+}
+
+v_node_t *v_copy_trie(v_trie_t *vtrie, g_node_t *root)
+{
+	v_node_t *copy = v_new_node(vtrie, NULL);
+	if (!copy)
+		return NULL;
+
+	key_t *key = (key_t *)root->data;
+	if (key->ending == END) {
+		copy->ending = 1;
+		copy->freq = key->freq;
+	}
+
+	for (unsigned int i = 0; i < ALPH; i++) {
+		if (!has_live_keys(root->children[i]))
+			continue;
+
+		copy->children[i] = v_copy_trie(vtrie, root->children[i]);
+		if (!copy->children[i]) {
+			v_release(vtrie, copy);
+			return NULL;
+		}
+
+		copy->children_num++;
+	}
+
+	return copy;
+}
+
+int vtrie_rebuild(v_trie_t *vtrie, g_tree_t *trie)
+{
+	pthread_mutex_lock(&vtrie->write_lock);
+
+	int ret = -1;
+	v_node_t *root = v_copy_trie(vtrie, trie->root);
+	if (root)
+		ret = v_publish(vtrie, root, trie->keys_no);
+
+	pthread_mutex_unlock(&vtrie->write_lock);
+	return ret;
+}
+
+v_version_t *vtrie_pin(v_trie_t *vtrie)
+{
+	pthread_mutex_lock(&vtrie->pin_lock);
+	v_version_t *version = vtrie->current;
+	version->pins++;
+	pthread_mutex_unlock(&vtrie->pin_lock);
+
+	return version;
+}
+
+void vtrie_unpin(v_trie_t *vtrie, v_version_t *version)
+{
+	pthread_mutex_lock(&vtrie->pin_lock);
+	u32_t pins = --version->pins;
+	pthread_mutex_unlock(&vtrie->pin_lock);
+
+	if (pins > 0)
+		return;
+
+	/**
+	 * Only the nodes that no other version shares are freed
+	 */
+	v_release(vtrie, version->root);
+	free(version);
+	__atomic_sub_fetch(&vtrie->versions, 1, __ATOMIC_RELAXED);
+}
+
+void v_search_kdiff(v_node_t *root, char *buff, size_t bufflen, char *word,
+					size_t wordlen, unsigned int k, unsigned int *found,
+					FILE *out)
+{
+	if (!k_different_word(buff, bufflen, word, wordlen, k))
+		return;
+
+	if (bufflen > wordlen)
+		return;
+
+	if (root->ending && bufflen == wordlen) {
+		buff[bufflen] = '\0';
+		fprintf(out, "%s\n", buff);
+		*found = *found + 1;
+		return;
+	}
+
+	/**
+	 * The versions have no dead branches, so every child leads to a key
+	 */
+	for (unsigned int i = 0; i < ALPH; i++) {
+		if (root->children[i]) {
+			buff[bufflen] = i + 'a';
+			v_search_kdiff(root->children[i], buff, bufflen + 1, word,
+						   wordlen, k, found, out);
+		}
+	}
+}
+
+void free_vtrie(v_trie_t *vtrie)
+{
+	if (vtrie->current)
+		vtrie_unpin(vtrie, vtrie->current);
+
+	pthread_mutex_destroy(&vtrie->pin_lock);
+	pthread_mutex_destroy(&vtrie->write_lock);
+	free(vtrie);
+}
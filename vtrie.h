@@ -0,0 +1,181 @@
+#ifndef VTRIE_H_
+#define VTRIE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+#include "structs.h"
+#include "utils.h"
+#include "magic_keyboard.h"
+
+/**
+ * A versioned trie never changes a node that a version can see. An update
+ * copies the nodes on the path from the root to the key, shares everything
+ * else with the previous version, and publishes the new root. A reader pins
+ * the current version and searches it without any lock, while the updates
+ * keep coming. A node counts the parents and versions that point to it, so
+ * it is freed when the last version that contains it is gone.
+ */
+
+/**
+ * @brief Creates a versioned trie, with an empty first version.
+ *
+ * @return v_trie_t* The trie, or NULL if there is no memory left.
+ */
+v_trie_t *create_vtrie(void);
+
+/**
+ * @brief Creates a node, as a copy of another one, or an empty one. The copy
+ * shares the children of the original, so it takes a reference to each.
+ *
+ * @param vtrie The trie.
+ * @param src The node we copy, or NULL for an empty node.
+ * @return v_node_t* The node, with a single reference, or NULL if there is no
+ * memory left.
+ */
+v_node_t *v_new_node(v_trie_t *vtrie, v_node_t *src);
+
+/**
+ * @brief Drops a reference to a node. The node is freed when nothing points
+ * to it anymore, and so are its children that were only its own.
+ *
+ * @param vtrie The trie.
+ * @param node The node, it can be NULL.
+ */
+void v_release(v_trie_t *vtrie, v_node_t *node);
+
+/**
+ * @brief Finds the ending node of a key in a version.
+ *
+ * @param root The root of the version.
+ * @param key The key.
+ * @return v_node_t* The ending node, or NULL if the key isn't there.
+ */
+v_node_t *v_find(v_node_t *root, const char *key);
+
+/**
+ * @brief Inserts a key by copying the path to it.
+ *
+ * @param vtrie The trie.
+ * @param node The node of the old version where the path continues, or NULL
+ * if the old version ends before it.
+ * @param key The rest of the key.
+ * @param freq The frequency the key will have.
+ * @param added Set to 1 if the key wasn't in the old version.
+ * @return v_node_t* The copy of node, or NULL if there is no memory left. In
+ * that case, the old version is untouched.
+ */
+v_node_t *v_insert(v_trie_t *vtrie, v_node_t *node, const char *key,
+				   u64_t freq, u8_t *added);
+
+/**
+ * @brief Removes a key by copying the path to it. The copies left without
+ * keys are dropped, so the new version has no dead branches.
+ *
+ * @param vtrie The trie.
+ * @param node The node of the old version where the path continues. The key
+ * must be in the old version.
+ * @param key The rest of the key.
+ * @param ret Where to store the copy of node, or NULL if nothing is left
+ * below it.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+int v_remove(v_trie_t *vtrie, v_node_t *node, const char *key,
+			 v_node_t **ret);
+
+/**
+ * @brief Makes a root the current version. The previous version is freed
+ * once its last reader unpins it.
+ *
+ * @param vtrie The trie.
+ * @param root The new root. Its reference is taken by the version.
+ * @param keys_no The number of keys in the new version.
+ * @return int Returns 0 on success, or -1 if there is no memory left. In that
+ * case, the root is released.
+ */
+int v_publish(v_trie_t *vtrie, v_node_t *root, u64_t keys_no);
+
+/**
+ * @brief Inserts a key with a given frequency, and publishes the new
+ * version.
+ *
+ * @param vtrie The trie.
+ * @param key The key.
+ * @param freq The frequency of the key.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+int vtrie_insert(v_trie_t *vtrie, const char *key, u64_t freq);
+
+/**
+ * @brief Removes a key, and publishes the new version. Nothing is published
+ * if the key isn't there.
+ *
+ * @param vtrie The trie.
+ * @param key The key.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+int vtrie_remove(v_trie_t *vtrie, const char *key);
+
+/**
+ * @brief Copies the live keys of a subtrie of a generic trie.
+ *
+ * @param vtrie The trie.
+ * @param root The root of the subtrie.
+ * @return v_node_t* The copy, or NULL if there is no memory left.
+ */
+v_node_t *v_copy_trie(v_trie_t *vtrie, g_node_t *root);
+
+/**
+ * @brief Publishes a copy of a whole generic trie as the next version. It is
+ * used after the bulk updates, that would copy most of the paths anyway.
+ *
+ * @param vtrie The trie.
+ * @param trie The generic trie.
+ * @return int Returns 0 on success, or -1 if there is no memory left.
+ */
+int vtrie_rebuild(v_trie_t *vtrie, g_tree_t *trie);
+
+/**
+ * @brief Pins the current version, so it stays alive while it is read. The
+ * lock is held only to count the reader, never while a path is copied.
+ *
+ * @param vtrie The trie.
+ * @return v_version_t* The version.
+ */
+v_version_t *vtrie_pin(v_trie_t *vtrie);
+
+/**
+ * @brief Unpins a version. The last one to leave an old version frees it.
+ *
+ * @param vtrie The trie.
+ * @param version The version.
+ */
+void vtrie_unpin(v_trie_t *vtrie, v_version_t *version);
+
+/**
+ * @brief The same search as search_kdiff_words, on a version.
+ *
+ * @param root The root of the version / subtrie.
+ * @param buff A temporary buffer, to store the words for printing.
+ * @param bufflen The number of letters in the buffer.
+ * @param word The word we want to find the k-different words.
+ * @param wordlen The word length.
+ * @param k The maximum number of different letters.
+ * @param found The number of words found.
+ * @param out The file where the words are printed.
+ */
+void v_search_kdiff(v_node_t *root, char *buff, size_t bufflen, char *word,
+					size_t wordlen, unsigned int k, unsigned int *found,
+					FILE *out);
+
+/**
+ * @brief Frees a versioned trie. No version may be pinned anymore.
+ *
+ * @param vtrie The trie.
+ */
+void free_vtrie(v_trie_t *vtrie);
+
+#endif  // VTRIE_H_
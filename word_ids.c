@@ -0,0 +1,386 @@
+#include "word_ids.h"
+
+/**
+ * @brief Hashes a word, with the 64-bit FNV-1a. The 32-bit one would have
+ * collisions in a big vocabulary, and 2 words with the same hash can't be
+ * told apart by any seed.
+ *
+ * @param word The word.
+ * @return u64_t The hash.
+ */
+static u64_t hash_word(char *word)
+{
+	u64_t hash = W_HASH_BASIS;
+
+	for (; *word != '\0'; word++) {
+		hash ^= (unsigned char)*word;
+		hash *= W_HASH_PRIME;
+	}
+
+	return hash;
+}
+
+/**
+ * @brief Gives the slot of a word for a seed.
+ *
+ * @param hash The hash of the word.
+ * @param seed The seed of its bucket.
+ * @param slots_no The number of slots.
+ * @return u32_t The slot.
+ */
+static u32_t hash_slot(u64_t hash, u32_t seed, u32_t slots_no)
+{
+	/**
+	 * The seed moves the hash, and the finaliser of MurmurHash3 spreads the
+	 * change over all the bits, so every seed gives an unrelated slot
+	 */
+	u64_t x = hash + (seed + 1UL) * W_SEED_STEP;
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdUL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53UL;
+	x ^= x >> 33;
+
+	return x % slots_no;
+}
+
+/**
+ * @brief Counts the keys of a subtrie, and the bytes of their words.
+ *
+ * @param root The root of the subtrie.
+ * @param depth The length of the path to root.
+ * @param words_no The number of keys found so far.
+ * @param bytes The bytes of their words so far, '\0' included.
+ */
+static void count_words(g_node_t *root, size_t depth, u64_t *words_no,
+						u64_t *bytes)
+{
+	if (((key_t *)root->data)->ending == END) {
+		(*words_no)++;
+		*bytes += depth + 1;
+	}
+
+	for (unsigned int i = 0; i < ALPH; i++) {
+		if (has_live_keys(root->children[i]))
+			count_words(root->children[i], depth + 1, words_no, bytes);
+	}
+}
+
+/**
+ * @brief Copies the keys of a subtrie into the words of the ids, in
+ * lexicographic order, with their ending nodes and their hashes.
+ *
+ * @param ids The ids.
+ * @param root The root of the subtrie.
+ * @param buff The letters of the path to root.
+ * @param depth The length of the path to root.
+ * @param nodes Where to store the ending nodes.
+ * @param hashes Where to store the hashes.
+ * @param starts Where to store where every word starts.
+ * @param count The number of keys copied so far.
+ * @param used The bytes of the words copied so far.
+ */
+static void collect_words(w_index_t *ids, g_node_t *root, char *buff,
+						  size_t depth, g_node_t **nodes, u64_t *hashes,
+						  u32_t *starts, u32_t *count, u64_t *used)
+{
+	if (((key_t *)root->data)->ending == END) {
+		buff[depth] = '\0';
+		memcpy(ids->words + *used, buff, depth + 1);
+
+		nodes[*count] = root;
+		hashes[*count] = hash_word(buff);
+		starts[*count] = *used;
+		(*count)++;
+		*used += depth + 1;
+	}
+
+	for (unsigned int i = 0; i < ALPH; i++) {
+		if (!has_live_keys(root->children[i]))
+			continue;
+
+		buff[depth] = i + 'a';
+		collect_words(ids, root->children[i], buff, depth + 1, nodes, hashes,
+					  starts, count, used);
+	}
+}
+
+/**
+ * @brief Compares 2 buckets, packed as their size and their index, so the
+ * biggest ones come first.
+ *
+ * @param a The first bucket.
+ * @param b The second bucket.
+ * @return int The order, for qsort.
+ */
+static int compare_buckets(const void *a, const void *b)
+{
+	u64_t x = *(const u64_t *)a, y = *(const u64_t *)b;
+
+	return x < y ? 1 : (x > y ? -1 : 0);
+}
+
+/**
+ * @brief Finds a seed for every bucket, so all the words land in different
+ * slots.
+ *
+ * @param ids The ids, with words_no and buckets_no set.
+ * @param hashes The hashes of the words.
+ * @return int Returns 0 on success, or -1 if there is no memory left, or if
+ * a bucket finds no seed.
+ */
+static int place_buckets(w_index_t *ids, u64_t *hashes)
+{
+	u32_t words_no = ids->words_no, buckets_no = ids->buckets_no;
+	u32_t *firsts = (u32_t *)calloc(buckets_no + 1, sizeof(u32_t));
+	u32_t *keys = (u32_t *)malloc(words_no * sizeof(u32_t));
+	u64_t *order = (u64_t *)malloc(buckets_no * sizeof(u64_t));
+	u32_t *slots = (u32_t *)malloc(words_no * sizeof(u32_t));
+	u8_t *taken = (u8_t *)calloc(words_no, sizeof(u8_t));
+	int ret = -1;
+
+	if (!firsts || !keys || !order || !slots || !taken)
+		goto out;
+
+	/**
+	 * Group the words by bucket, with a counting sort
+	 */
+	for (u32_t i = 0; i < words_no; i++)
+		firsts[hashes[i] % buckets_no + 1]++;
+	for (u32_t b = 0; b < buckets_no; b++)
+		firsts[b + 1] += firsts[b];
+	for (u32_t i = 0; i < words_no; i++) {
+		u32_t b = hashes[i] % buckets_no;
+		keys[firsts[b]] = i;
+		firsts[b]++;
+	}
+	for (u32_t b = buckets_no; b > 0; b--)
+		firsts[b] = firsts[b - 1];
+	firsts[0] = 0;
+
+	/**
+	 * The big buckets are the hardest to place, so they go first, while
+	 * most of the slots are still free
+	 */
+	for (u32_t b = 0; b < buckets_no; b++)
+		order[b] = (u64_t)(firsts[b + 1] - firsts[b]) << 32 | b;
+	qsort(order, buckets_no, sizeof(u64_t), compare_buckets);
+
+	/**
+	 * The last words have few free slots to hit, about words_no tries each,
+	 * so a bucket that needs many times more has words with equal hashes
+	 */
+	u64_t tries = W_SEED_TRIES * ((u64_t)words_no + 1);
+	for (u32_t i = 0; i < buckets_no; i++) {
+		u32_t b = order[i] & 0xffffffffu;
+		u32_t first = firsts[b], size = firsts[b + 1] - first;
+		if (size == 0)
+			break;
+
+		u64_t seed;
+		for (seed = 0; seed < tries; seed++) {
+			u32_t j;
+			for (j = 0; j < size; j++) {
+				u32_t slot = hash_slot(hashes[keys[first + j]], seed,
+									   words_no);
+				if (taken[slot])
+					break;
+
+				taken[slot] = 1;
+				slots[j] = slot;
+			}
+
+			if (j == size)
+				break;
+
+			while (j > 0) {
+				j--;
+				taken[slots[j]] = 0;
+			}
+		}
+
+		if (seed == tries)
+			goto out;
+
+		ids->seeds[b] = seed;
+	}
+
+	ret = 0;
+
+out:
+	free(firsts);
+	free(keys);
+	free(order);
+	free(slots);
+	free(taken);
+	return ret;
+}
+
+w_index_t *build_word_ids(g_tree_t *trie)
+{
+	u64_t words_no = 0, bytes = 0;
+	count_words(trie->root, 0, &words_no, &bytes);
+	if (words_no >= W_NO_ID || bytes > 0xffffffffUL)
+		return NULL;
+
+	w_index_t *ids = (w_index_t *)calloc(1, sizeof(w_index_t));
+	if (!ids)
+		return NULL;
+
+	ids->words_no = words_no;
+	ids->buckets_no = words_no / W_BUCKET_KEYS + 1;
+	ids->seeds = (u32_t *)calloc(ids->buckets_no, sizeof(u32_t));
+	ids->words = (char *)malloc(bytes + 1);
+	ids->offsets = (u32_t *)malloc((words_no + 1) * sizeof(u32_t));
+	ids->lens = (u8_t *)malloc(words_no + 1);
+	ids->freqs = (u64_t *)malloc((words_no + 1) * sizeof(u64_t));
+	ids->nodes = (g_node_t **)malloc((words_no + 1) * sizeof(g_node_t *));
+
+	g_node_t **nodes = (g_node_t **)malloc((words_no + 1) *
+										   sizeof(g_node_t *));
+	u64_t *hashes = (u64_t *)malloc((words_no + 1) * sizeof(u64_t));
+	u32_t *starts = (u32_t *)malloc((words_no + 1) * sizeof(u32_t));
+
+	if (!ids->seeds || !ids->words || !ids->offsets || !ids->lens ||
+		!ids->freqs || !ids->nodes || !nodes || !hashes || !starts)
+		goto fail;
+
+	char buff[MAX_BUFF];
+	u32_t count = 0;
+	u64_t used = 0;
+	collect_words(ids, trie->root, buff, 0, nodes, hashes, starts, &count,
+				  &used);
+
+	if (place_buckets(ids, hashes) < 0)
+		goto fail;
+
+	/**
+	 * The slot of every word is its id, so the arrays are filled in the
+	 * order of the slots
+	 */
+	for (u32_t i = 0; i < count; i++) {
+		u32_t id = hash_slot(hashes[i], ids->seeds[hashes[i] %
+												   ids->buckets_no],
+							 ids->words_no);
+		key_t *key = (key_t *)nodes[i]->data;
+
+		ids->offsets[id] = starts[i];
+		ids->lens[id] = strlen(ids->words + starts[i]);
+		ids->freqs[id] = key->freq;
+		ids->nodes[id] = nodes[i];
+		key->id = id;
+	}
+
+	ids->bytes = sizeof(w_index_t) + ids->buckets_no * sizeof(u32_t) +
+				 bytes + words_no * (sizeof(u32_t) + sizeof(u8_t) +
+									 sizeof(u64_t) + sizeof(g_node_t *));
+
+	free(nodes);
+	free(hashes);
+	free(starts);
+	return ids;
+
+fail:
+	free(nodes);
+	free(hashes);
+	free(starts);
+	free(ids->seeds);
+	free(ids->words);
+	free(ids->offsets);
+	free(ids->lens);
+	free(ids->freqs);
+	free(ids->nodes);
+	free(ids);
+	return NULL;
+}
+
+void w_unlink(w_index_t *ids)
+{
+	for (u32_t id = 0; id < ids->words_no; id++) {
+		if (!ids->nodes[id])
+			continue;
+
+		((key_t *)ids->nodes[id]->data)->id = W_NO_ID;
+		ids->nodes[id] = NULL;
+	}
+}
+
+void free_word_ids(w_index_t *ids)
+{
+	if (!ids)
+		return;
+
+	w_unlink(ids);
+
+	free(ids->seeds);
+	free(ids->words);
+	free(ids->offsets);
+	free(ids->lens);
+	free(ids->freqs);
+	free(ids->nodes);
+	free(ids);
+}
+
+u32_t w_find(w_index_t *ids, char *word)
+{
+	if (ids->words_no == 0)
+		return W_NO_ID;
+
+	u64_t hash = hash_word(word);
+	u32_t id = hash_slot(hash, ids->seeds[hash % ids->buckets_no],
+						 ids->words_no);
+
+	/**
+	 * Any word gets a slot, the ones outside the vocabulary too, so the
+	 * word of the slot has to be the same
+	 */
+	size_t len = strlen(word);
+	if (ids->lens[id] != len ||
+		memcmp(ids->words + ids->offsets[id], word, len) != 0)
+		return W_NO_ID;
+
+	return id;
+}
+
+void w_link(w_index_t *ids, g_node_t *node, char *word)
+{
+	key_t *key = (key_t *)node->data;
+	if (key->id != W_NO_ID)
+		return;
+
+	u32_t id = w_find(ids, word);
+	if (id == W_NO_ID)
+		return;
+
+	ids->nodes[id] = node;
+	key->id = id;
+}
+
+void w_sync(w_index_t *ids, g_node_t *node)
+{
+	key_t *key = (key_t *)node->data;
+
+	if (key->id != W_NO_ID)
+		ids->freqs[key->id] = key->freq;
+}
+
+void w_forget(w_index_t *ids, g_node_t *node)
+{
+	key_t *key = (key_t *)node->data;
+	if (key->id == W_NO_ID)
+		return;
+
+	ids->nodes[key->id] = NULL;
+	ids->freqs[key->id] = 0;
+	key->id = W_NO_ID;
+}
+
+void w_forget_subtrie(w_index_t *ids, g_node_t *root)
+{
+	w_forget(ids, root);
+
+	for (unsigned int i = 0; i < ALPH; i++) {
+		if (root->children[i])
+			w_forget_subtrie(ids, root->children[i]);
+	}
+}
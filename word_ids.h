@@ -0,0 +1,98 @@
+#ifndef WORD_IDS_H_
+#define WORD_IDS_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "structs.h"
+#include "utils.h"
+#include "generic_tree.h"
+
+/**
+ * The word ids give every key of a frozen vocabulary a dense 32-bit id, from
+ * a minimal perfect hash: the words are spread into small buckets, and every
+ * bucket gets a seed that sends all its words to free slots, so the slots
+ * are exactly the ids, without collisions and without holes. An exact lookup
+ * is then two hashes and a compare, instead of a walk down the trie. The
+ * uses and the lengths of the words live in arrays indexed by id, next to
+ * each other, and the ending nodes carry their id, so the trie and the
+ * arrays are kept in step by the updates. The words added after the freeze
+ * have no id, and they are found by the walk, like before.
+ */
+
+/**
+ * @brief Freezes the vocabulary of a trie: gives an id to every key, and
+ * stores it in its ending node.
+ *
+ * @param trie The trie, whose keys have no ids yet.
+ * @return w_index_t* The ids, or NULL if there is no memory left, or if the
+ * hash can't be built. In that case, the keys are left without ids.
+ */
+w_index_t *build_word_ids(g_tree_t *trie);
+
+/**
+ * @brief Frees the ids, and takes them back from the ending nodes that still
+ * have them.
+ *
+ * @param ids The ids, it can be NULL.
+ */
+void free_word_ids(w_index_t *ids);
+
+/**
+ * @brief Takes the ids back from the ending nodes, but keeps the words of
+ * the ids, so the next freeze can be built while they are still read.
+ *
+ * @param ids The ids.
+ */
+void w_unlink(w_index_t *ids);
+
+/**
+ * @brief Finds the id of a word.
+ *
+ * @param ids The ids.
+ * @param word The word.
+ * @return u32_t The id, or W_NO_ID if the word isn't in the frozen
+ * vocabulary.
+ */
+u32_t w_find(w_index_t *ids, char *word);
+
+/**
+ * @brief Gives its id to a new ending node of a frozen word, after the old
+ * node of the word was freed. Nothing happens for a word added after the
+ * freeze.
+ *
+ * @param ids The ids.
+ * @param node The ending node.
+ * @param word The word.
+ */
+void w_link(w_index_t *ids, g_node_t *node, char *word);
+
+/**
+ * @brief Copies the uses of a key into the array of its id, after they
+ * changed. Nothing happens for a key without id.
+ *
+ * @param ids The ids.
+ * @param node The ending node of the key.
+ */
+void w_sync(w_index_t *ids, g_node_t *node);
+
+/**
+ * @brief Takes the id back from a node that is about to be freed.
+ *
+ * @param ids The ids.
+ * @param node The node.
+ */
+void w_forget(w_index_t *ids, g_node_t *node);
+
+/**
+ * @brief Takes the ids back from all the nodes of a subtrie that is about to
+ * be freed.
+ *
+ * @param ids The ids.
+ * @param root The root of the subtrie.
+ */
+void w_forget_subtrie(w_index_t *ids, g_node_t *root);
+
+#endif  // WORD_IDS_H_